@@ -0,0 +1,353 @@
+#include "BitPack.h"
+
+#include <cstring>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            /**
+             * @brief Store a word in little endian
+             */
+            template <typename T>
+            void storeWord(std::byte *data, T x)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                if constexpr (sizeof(T) == 4)
+                {
+                    x = __builtin_bswap32(x);
+                }
+                else
+                {
+                    x = __builtin_bswap64(x);
+                }
+#endif
+                std::memcpy(data, &x, sizeof(T));
+            }
+
+            /**
+             * @brief Load a word stored in little endian
+             */
+            template <typename T>
+            T loadWord(const std::byte *data)
+            {
+                T x;
+                std::memcpy(&x, data, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                if constexpr (sizeof(T) == 4)
+                {
+                    x = __builtin_bswap32(x);
+                }
+                else
+                {
+                    x = __builtin_bswap64(x);
+                }
+#endif
+                return x;
+            }
+
+            /**
+             * @brief Mask of the `width` low bits of a value
+             */
+            template <typename T>
+            T lowBits(unsigned width)
+            {
+                return width == 8 * sizeof(T) ? ~T(0) : static_cast<T>((T(1) << width) - 1);
+            }
+
+            template <typename T>
+            void packScalar(std::byte *out, const T *in, T min, unsigned width)
+            {
+                constexpr std::size_t lanes = 16 / sizeof(T);
+                constexpr unsigned bits = 8 * sizeof(T);
+                if (width == 0)
+                {
+                    return;
+                }
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                {
+                    T word = 0;
+                    unsigned used = 0;
+                    std::size_t k = 0;
+                    for (std::size_t p = 0; p < BitPackBlock / lanes; ++p)
+                    {
+                        T delta = static_cast<T>(in[lanes * p + lane] - min);
+                        word |= static_cast<T>(delta << used);
+                        used += width;
+                        if (used >= bits)
+                        {
+                            storeWord(out + sizeof(T) * (lanes * k++ + lane), word);
+                            used -= bits;
+                            word = used > 0 ? static_cast<T>(delta >> (width - used)) : 0;
+                        }
+                    }
+                }
+            }
+
+            template <typename T>
+            void unpackScalar(T *out, const std::byte *in, T min, unsigned width)
+            {
+                constexpr std::size_t lanes = 16 / sizeof(T);
+                constexpr unsigned bits = 8 * sizeof(T);
+                if (width == 0)
+                {
+                    for (std::size_t i = 0; i < BitPackBlock; ++i)
+                    {
+                        out[i] = min;
+                    }
+                    return;
+                }
+                const T mask = lowBits<T>(width);
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                {
+                    T word = loadWord<T>(in + sizeof(T) * lane);
+                    unsigned used = 0;
+                    std::size_t k = 0;
+                    for (std::size_t p = 0; p < BitPackBlock / lanes; ++p)
+                    {
+                        T value = static_cast<T>(word >> used);
+                        used += width;
+                        if (used >= bits)
+                        {
+                            used -= bits;
+                            if (++k < width)
+                            {
+                                word = loadWord<T>(in + sizeof(T) * (lanes * k + lane));
+                                if (used > 0)
+                                {
+                                    value |= static_cast<T>(word << (width - used));
+                                }
+                            }
+                        }
+                        out[lanes * p + lane] = static_cast<T>(min + (value & mask));
+                    }
+                }
+            }
+
+            const BitPackKernels ScalarKernels = {
+                packScalar<uint32_t>,
+                unpackScalar<uint32_t>,
+                packScalar<uint64_t>,
+                unpackScalar<uint64_t>,
+            };
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  SSE2
+             ***********************************************************************************/
+
+            /**
+             * @brief Lane operations on 32 and 64-bit values
+             */
+            template <typename T>
+            struct Lanes;
+
+            template <>
+            struct Lanes<uint32_t>
+            {
+                __attribute__((target("sse2"))) static __m128i set1(uint32_t x) { return _mm_set1_epi32(static_cast<int>(x)); }
+                __attribute__((target("sse2"))) static __m128i add(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+                __attribute__((target("sse2"))) static __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+                __attribute__((target("sse2"))) static __m128i sll(__m128i a, unsigned n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n))); }
+                __attribute__((target("sse2"))) static __m128i srl(__m128i a, unsigned n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(static_cast<int>(n))); }
+            };
+
+            template <>
+            struct Lanes<uint64_t>
+            {
+                __attribute__((target("sse2"))) static __m128i set1(uint64_t x) { return _mm_set1_epi64x(static_cast<long long>(x)); }
+                __attribute__((target("sse2"))) static __m128i add(__m128i a, __m128i b) { return _mm_add_epi64(a, b); }
+                __attribute__((target("sse2"))) static __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+                __attribute__((target("sse2"))) static __m128i sll(__m128i a, unsigned n) { return _mm_sll_epi64(a, _mm_cvtsi32_si128(static_cast<int>(n))); }
+                __attribute__((target("sse2"))) static __m128i srl(__m128i a, unsigned n) { return _mm_srl_epi64(a, _mm_cvtsi32_si128(static_cast<int>(n))); }
+            };
+
+            /**
+             * @brief Pack the values one 128-bit word of all the lanes at a time
+             */
+            template <typename T>
+            __attribute__((target("sse2"))) void packSse2(std::byte *out, const T *in, T min, unsigned width)
+            {
+                using L = Lanes<T>;
+                constexpr std::size_t lanes = 16 / sizeof(T);
+                constexpr unsigned bits = 8 * sizeof(T);
+                if (width == 0)
+                {
+                    return;
+                }
+                const __m128i base = L::set1(min);
+                __m128i *words = reinterpret_cast<__m128i *>(out);
+                __m128i word = _mm_setzero_si128();
+                unsigned used = 0;
+                for (std::size_t p = 0; p < BitPackBlock / lanes; ++p)
+                {
+                    __m128i delta = L::sub(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + lanes * p)), base);
+                    word = _mm_or_si128(word, L::sll(delta, used));
+                    used += width;
+                    if (used >= bits)
+                    {
+                        _mm_storeu_si128(words++, word);
+                        used -= bits;
+                        word = used > 0 ? L::srl(delta, width - used) : _mm_setzero_si128();
+                    }
+                }
+            }
+
+            /**
+             * @brief Unpack the values one 128-bit word of all the lanes at a
+             * time
+             */
+            template <typename T>
+            __attribute__((target("sse2"))) void unpackSse2(T *out, const std::byte *in, T min, unsigned width)
+            {
+                using L = Lanes<T>;
+                constexpr std::size_t lanes = 16 / sizeof(T);
+                constexpr unsigned bits = 8 * sizeof(T);
+                const __m128i base = L::set1(min);
+                if (width == 0)
+                {
+                    for (std::size_t i = 0; i < BitPackBlock; i += lanes)
+                    {
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), base);
+                    }
+                    return;
+                }
+                const __m128i mask = L::set1(lowBits<T>(width));
+                const __m128i *words = reinterpret_cast<const __m128i *>(in);
+                __m128i word = _mm_loadu_si128(words);
+                unsigned used = 0;
+                std::size_t k = 0;
+                for (std::size_t p = 0; p < BitPackBlock / lanes; ++p)
+                {
+                    __m128i value = L::srl(word, used);
+                    used += width;
+                    if (used >= bits)
+                    {
+                        used -= bits;
+                        if (++k < width)
+                        {
+                            word = _mm_loadu_si128(words + k);
+                            if (used > 0)
+                            {
+                                value = _mm_or_si128(value, L::sll(word, width - used));
+                            }
+                        }
+                    }
+                    value = L::add(_mm_and_si128(value, mask), base);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + lanes * p), value);
+                }
+            }
+
+            const BitPackKernels Sse2Kernels = {
+                packSse2<uint32_t>,
+                unpackSse2<uint32_t>,
+                packSse2<uint64_t>,
+                unpackSse2<uint64_t>,
+            };
+#endif
+
+            /***********************************************************************************
+             *                                  Last block
+             ***********************************************************************************/
+
+            template <typename T>
+            std::size_t packBitsScalar(std::byte *out, const T *in, std::size_t count, T min, unsigned width)
+            {
+                std::size_t size = packedBitsSize(count, width);
+                if (size == 0)
+                {
+                    return 0;
+                }
+                std::memset(out, 0, size);
+                std::size_t bit = 0;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    T delta = static_cast<T>(in[i] - min);
+                    for (unsigned done = 0; done < width;)
+                    {
+                        unsigned offset = bit % 8;
+                        unsigned n = std::min(8 - offset, width - done);
+                        unsigned chunk = static_cast<unsigned>(delta >> done) & ((1u << n) - 1);
+                        out[bit / 8] |= static_cast<std::byte>(chunk << offset);
+                        done += n;
+                        bit += n;
+                    }
+                }
+                return size;
+            }
+
+            template <typename T>
+            void unpackBitsScalar(T *out, const std::byte *in, std::size_t count, T min, unsigned width)
+            {
+                std::size_t bit = 0;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    T delta = 0;
+                    for (unsigned done = 0; done < width;)
+                    {
+                        unsigned offset = bit % 8;
+                        unsigned n = std::min(8 - offset, width - done);
+                        unsigned chunk = (static_cast<unsigned>(in[bit / 8]) >> offset) & ((1u << n) - 1);
+                        delta |= static_cast<T>(static_cast<T>(chunk) << done);
+                        done += n;
+                        bit += n;
+                    }
+                    out[i] = static_cast<T>(min + delta);
+                }
+            }
+        }
+
+        std::size_t packBits(std::byte *out, const uint32_t *in, std::size_t count, uint32_t min, unsigned width)
+        {
+            return packBitsScalar(out, in, count, min, width);
+        }
+
+        std::size_t packBits(std::byte *out, const uint64_t *in, std::size_t count, uint64_t min, unsigned width)
+        {
+            return packBitsScalar(out, in, count, min, width);
+        }
+
+        void unpackBits(uint32_t *out, const std::byte *in, std::size_t count, uint32_t min, unsigned width)
+        {
+            unpackBitsScalar(out, in, count, min, width);
+        }
+
+        void unpackBits(uint64_t *out, const std::byte *in, std::size_t count, uint64_t min, unsigned width)
+        {
+            unpackBitsScalar(out, in, count, min, width);
+        }
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const BitPackKernels &bitPackKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            if (level != SimdLevel::Scalar)
+            {
+                return Sse2Kernels;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
@@ -0,0 +1,123 @@
+#ifndef BIT_PACK_H
+#define BIT_PACK_H
+
+#include "ByteSwap.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Number of values of a block of the bit-packing codec
+		 */
+		constexpr std::size_t BitPackBlock = 128;
+
+		/**
+		 * @brief Number of bits needed by the largest of the values whose
+		 * bits are ORed in `bits`
+		 */
+		inline unsigned bitWidth(uint32_t bits)
+		{
+			return bits == 0 ? 0 : 32 - static_cast<unsigned>(__builtin_clz(bits));
+		}
+
+		inline unsigned bitWidth(uint64_t bits)
+		{
+			return bits == 0 ? 0 : 64 - static_cast<unsigned>(__builtin_clzll(bits));
+		}
+
+		/**
+		 * @brief Number of bytes of a full block of values packed on `width`
+		 * bits
+		 */
+		constexpr std::size_t bitPackedSize(unsigned width)
+		{
+			return 16 * static_cast<std::size_t>(width);
+		}
+
+		/**
+		 * @brief Number of bytes of `count` values packed on `width` bits by
+		 * `packBits()`
+		 */
+		constexpr std::size_t packedBitsSize(std::size_t count, unsigned width)
+		{
+			return (count * width + 7) / 8;
+		}
+
+		/**
+		 * @brief Bit-packing kernels
+		 *
+		 * A kernel packs or unpacks a full block of `BitPackBlock` values, each
+		 * one stored as its difference with `min` on `width` bits. The block is
+		 * laid out as the 128-bit words of SIMD-BP128: the value `i` belongs to
+		 * the lane `i % lanes` of the words (4 lanes of 32 bits or 2 of 64 bits)
+		 * and the values of a lane are packed one after the other, from the low
+		 * bits, in the little endian words of the lane. A block takes
+		 * `bitPackedSize(width)` bytes, which need no alignment.
+		 */
+		struct BitPackKernels
+		{
+			void (*pack32)(std::byte *out, const uint32_t *in, uint32_t min, unsigned width);
+			void (*unpack32)(uint32_t *out, const std::byte *in, uint32_t min, unsigned width);
+			void (*pack64)(std::byte *out, const uint64_t *in, uint64_t min, unsigned width);
+			void (*unpack64)(uint64_t *out, const std::byte *in, uint64_t min, unsigned width);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`. The
+		 * vector kernels only need SSE2 and are used from the SSSE3 level up.
+		 */
+		const BitPackKernels &bitPackKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const BitPackKernels &bitPackKernels()
+		{
+			static const BitPackKernels &kernels = bitPackKernels(simdLevel());
+			return kernels;
+		}
+
+		inline void bitPack(std::byte *out, const uint32_t *in, uint32_t min, unsigned width)
+		{
+			bitPackKernels().pack32(out, in, min, width);
+		}
+
+		inline void bitPack(std::byte *out, const uint64_t *in, uint64_t min, unsigned width)
+		{
+			bitPackKernels().pack64(out, in, min, width);
+		}
+
+		inline void bitUnpack(uint32_t *out, const std::byte *in, uint32_t min, unsigned width)
+		{
+			bitPackKernels().unpack32(out, in, min, width);
+		}
+
+		inline void bitUnpack(uint64_t *out, const std::byte *in, uint64_t min, unsigned width)
+		{
+			bitPackKernels().unpack64(out, in, min, width);
+		}
+
+		/**
+		 * @brief Pack `count` values, fewer than a block, one after the other
+		 * from the low bits of the first byte
+		 *
+		 * Used for the last block of an array. Returns `packedBitsSize()`.
+		 */
+		std::size_t packBits(std::byte *out, const uint32_t *in, std::size_t count, uint32_t min, unsigned width);
+		std::size_t packBits(std::byte *out, const uint64_t *in, std::size_t count, uint64_t min, unsigned width);
+
+		/**
+		 * @brief Unpack `count` values packed by `packBits()`
+		 */
+		void unpackBits(uint32_t *out, const std::byte *in, std::size_t count, uint32_t min, unsigned width);
+		void unpackBits(uint64_t *out, const std::byte *in, std::size_t count, uint64_t min, unsigned width);
+	} // namespace detail
+} // namespace serial
+
+#endif // BIT_PACK_H
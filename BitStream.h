@@ -0,0 +1,175 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Writer of a stream of bits, most significant first
+		 *
+		 * The bits are gathered in a 64-bit word appended to a vector of bytes
+		 * in big endian when it is full.
+		 */
+		class BitWriter
+		{
+		private:
+			std::vector<std::byte> &m_out;
+			uint64_t m_word;
+			unsigned m_used;
+
+		public:
+			/**
+			 * @brief Constructor appending the bits to `out`
+			 */
+			explicit BitWriter(std::vector<std::byte> &out) noexcept
+				: m_out(out), m_word(0), m_used(0)
+			{
+			}
+
+			/**
+			 * @brief Write the `count` low bits of `bits`, which must be 0
+			 * above them, `count` being at most 64
+			 */
+			void write(uint64_t bits, unsigned count)
+			{
+				unsigned free = 64 - m_used;
+				if (count < free)
+				{
+					m_word = (m_word << count) | bits;
+					m_used += count;
+					return;
+				}
+				unsigned rest = count - free;
+				m_word = free == 64 ? bits : (m_word << free) | (bits >> rest);
+				append(m_word, 8);
+				m_word = rest == 0 ? 0 : bits & ((uint64_t(1) << rest) - 1);
+				m_used = rest;
+			}
+
+			/**
+			 * @brief Write a single bit
+			 */
+			void write(bool bit)
+			{
+				write(static_cast<uint64_t>(bit), 1);
+			}
+
+			/**
+			 * @brief Append the pending bits, the last byte padded with zeros
+			 */
+			void flush()
+			{
+				if (m_used > 0)
+				{
+					append(m_word << (64 - m_used), (m_used + 7) / 8);
+					m_word = 0;
+					m_used = 0;
+				}
+			}
+
+		private:
+			/**
+			 * @brief Append the `bytes` high bytes of `word`
+			 */
+			void append(uint64_t word, unsigned bytes)
+			{
+				std::byte b[8];
+				for (unsigned i = 0; i < 8; ++i)
+				{
+					b[i] = static_cast<std::byte>(word >> (56 - 8 * i));
+				}
+				m_out.insert(m_out.end(), b, b + bytes);
+			}
+		};
+
+		/**
+		 * @brief Reader of a stream of bits written by `BitWriter`
+		 *
+		 * Reading past the end of the stream gives zeros.
+		 */
+		class BitReader
+		{
+		private:
+			const std::byte *m_data;
+			const std::byte *m_end;
+			uint64_t m_word;
+			unsigned m_bits;
+
+		public:
+			/**
+			 * @brief Constructor reading the `size` bytes pointed by `data`
+			 */
+			BitReader(const std::byte *data, std::size_t size) noexcept
+				: m_data(data), m_end(data + size), m_word(0), m_bits(0)
+			{
+			}
+
+			/**
+			 * @brief Read `count` bits, at most 64, in the low bits of the
+			 * result
+			 */
+			uint64_t read(unsigned count)
+			{
+				if (count == 0)
+				{
+					return 0;
+				}
+				uint64_t result = 0;
+				if (count > m_bits)
+				{
+					unsigned first = m_bits;
+					result = first == 0 ? 0 : m_word >> (64 - first);
+					count -= first;
+					refill();
+					result = count == 64 ? 0 : result << count;
+				}
+				result |= m_word >> (64 - count);
+				m_word = count == 64 ? 0 : m_word << count;
+				m_bits -= count;
+				return result;
+			}
+
+			/**
+			 * @brief Read a single bit
+			 */
+			bool readBit()
+			{
+				return read(1) != 0;
+			}
+
+		private:
+			/**
+			 * @brief Load the next 8 bytes, zeros past the end
+			 */
+			void refill()
+			{
+				uint64_t word = 0;
+				if (m_end - m_data >= 8)
+				{
+					std::memcpy(&word, m_data, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+					word = __builtin_bswap64(word);
+#endif
+					m_data += 8;
+				}
+				else
+				{
+					for (unsigned i = 0; m_data < m_end; ++i)
+					{
+						word |= static_cast<uint64_t>(*m_data++) << (56 - 8 * i);
+					}
+				}
+				m_word = word;
+				m_bits = 64;
+			}
+		};
+	} // namespace detail
+} // namespace serial
+
+#endif // BIT_STREAM_H
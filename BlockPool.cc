@@ -0,0 +1,158 @@
+#include "BlockPool.h"
+
+#include <algorithm>
+
+namespace serial
+{
+    namespace detail
+    {
+        /**
+         * @brief Constructor
+         *
+         * Starts `threads` threads, at least one, running `work` on the
+         * submitted jobs.
+         */
+        BlockPool::BlockPool(Work work, std::size_t threads)
+        : m_work(std::move(work))
+        , m_stopping(false)
+        {
+            start(threads);
+        }
+
+        /**
+         * @brief Stops the threads, the pending jobs are dropped
+         */
+        BlockPool::~BlockPool()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Restart with `threads` threads, the pending jobs are kept
+         */
+        void BlockPool::resize(std::size_t threads)
+        {
+            if (std::max<std::size_t>(threads, 1) == m_threads.size())
+            {
+                return;
+            }
+            stop();
+            start(threads);
+        }
+
+        /**
+         * @brief A job to fill and submit
+         */
+        std::unique_ptr<BlockPool::Job> BlockPool::acquire()
+        {
+            if (m_free.empty())
+            {
+                return std::make_unique<Job>();
+            }
+            std::unique_ptr<Job> job = std::move(m_free.back());
+            m_free.pop_back();
+            job->in_size = 0;
+            job->out_size = 0;
+            job->error = nullptr;
+            return job;
+        }
+
+        /**
+         * @brief Queue `job` after the jobs submitted before
+         */
+        void BlockPool::submit(std::unique_ptr<Job> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                job->done = false;
+                m_queue.push_back(job.get());
+                m_order.push_back(std::move(job));
+            }
+            m_submitted.notify_one();
+        }
+
+        /**
+         * @brief Whether the oldest pending job is done
+         */
+        bool BlockPool::ready()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return !m_order.empty() && m_order.front()->done;
+        }
+
+        /**
+         * @brief The oldest pending job, once it is done
+         */
+        BlockPool::Job &BlockPool::front()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            Job &job = *m_order.front();
+            m_finished.wait(lock, [&]
+                            { return job.done; });
+            return job;
+        }
+
+        /**
+         * @brief Recycle the oldest pending job
+         */
+        void BlockPool::release()
+        {
+            m_free.push_back(std::move(m_order.front()));
+            m_order.pop_front();
+        }
+
+        /**
+         * @brief Loop of a thread, until the pool stops
+         */
+        void BlockPool::run()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true)
+            {
+                m_submitted.wait(lock, [&]
+                                 { return m_stopping || !m_queue.empty(); });
+                if (m_stopping){return;}
+                Job *job = m_queue.front();
+                m_queue.pop_front();
+                lock.unlock();
+                if (job->error == nullptr)
+                {
+                    try
+                    {
+                        m_work(*job);
+                    }
+                    catch (...)
+                    {
+                        job->error = std::current_exception();
+                    }
+                }
+                lock.lock();
+                job->done = true;
+                m_finished.notify_all();
+            }
+        }
+
+        void BlockPool::start(std::size_t threads)
+        {
+            m_stopping = false;
+            for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i)
+            {
+                m_threads.emplace_back(&BlockPool::run, this);
+            }
+        }
+
+        void BlockPool::stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_submitted.notify_all();
+            for (std::thread &thread : m_threads)
+            {
+                thread.join();
+            }
+            m_threads.clear();
+        }
+    } // namespace detail
+} // namespace serial
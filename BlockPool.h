@@ -0,0 +1,129 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Worker threads processing the blocks of an archive, whose
+		 * results are handed back in submission order
+		 *
+		 * Only the thread owning the pool calls its member functions. It
+		 * acquires a job, fills its input, submits it, and later takes the
+		 * oldest job back with `front()` and `release()`. Jobs are recycled
+		 * along with their buffers.
+		 */
+		class BlockPool
+		{
+		public:
+			struct Job
+			{
+				std::vector<std::byte> in;
+				std::size_t in_size = 0;
+
+				std::vector<std::byte> out;
+				std::size_t out_size = 0;
+
+				/**
+				 * @brief Exception thrown by the work, or set before the
+				 * submission to skip it
+				 */
+				std::exception_ptr error;
+
+				bool done = false;
+			};
+
+			using Work = std::function<void(Job &job)>;
+
+			/**
+			 * @brief Constructor
+			 *
+			 * Starts `threads` threads, at least one, running `work` on the
+			 * submitted jobs.
+			 */
+			BlockPool(Work work, std::size_t threads);
+
+			BlockPool(const BlockPool &) = delete;
+			BlockPool &operator=(const BlockPool &) = delete;
+
+			/**
+			 * @brief Stops the threads, the pending jobs are dropped
+			 */
+			~BlockPool();
+
+			/**
+			 * @brief Number of threads
+			 */
+			std::size_t threads() const noexcept
+			{
+				return m_threads.size();
+			}
+
+			/**
+			 * @brief Restart with `threads` threads, the pending jobs are kept
+			 */
+			void resize(std::size_t threads);
+
+			/**
+			 * @brief A job to fill and submit
+			 */
+			std::unique_ptr<Job> acquire();
+
+			/**
+			 * @brief Queue `job` after the jobs submitted before
+			 */
+			void submit(std::unique_ptr<Job> job);
+
+			/**
+			 * @brief Number of jobs submitted and not released yet
+			 */
+			std::size_t pending() const noexcept
+			{
+				return m_order.size();
+			}
+
+			/**
+			 * @brief Whether the oldest pending job is done
+			 */
+			bool ready();
+
+			/**
+			 * @brief The oldest pending job, once it is done
+			 */
+			Job &front();
+
+			/**
+			 * @brief Recycle the oldest pending job
+			 */
+			void release();
+
+		private:
+			void run();
+			void start(std::size_t threads);
+			void stop();
+
+			Work m_work;
+			std::vector<std::thread> m_threads;
+			std::mutex m_mutex;
+			std::condition_variable m_submitted;
+			std::condition_variable m_finished;
+			std::deque<Job *> m_queue;
+			std::deque<std::unique_ptr<Job>> m_order;
+			std::vector<std::unique_ptr<Job>> m_free;
+			bool m_stopping;
+		};
+	} // namespace detail
+} // namespace serial
+
+#endif // BLOCK_POOL_H
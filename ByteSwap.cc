@@ -0,0 +1,184 @@
+#include "ByteSwap.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            void swap16Scalar(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    uint16_t x;
+                    std::memcpy(&x, in + 2 * i, 2);
+                    x = __builtin_bswap16(x);
+                    std::memcpy(out + 2 * i, &x, 2);
+                }
+            }
+
+            void swap32Scalar(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    uint32_t x;
+                    std::memcpy(&x, in + 4 * i, 4);
+                    x = __builtin_bswap32(x);
+                    std::memcpy(out + 4 * i, &x, 4);
+                }
+            }
+
+            void swap64Scalar(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    uint64_t x;
+                    std::memcpy(&x, in + 8 * i, 8);
+                    x = __builtin_bswap64(x);
+                    std::memcpy(out + 8 * i, &x, 8);
+                }
+            }
+
+            const ByteSwapKernels ScalarKernels = {swap16Scalar, swap32Scalar, swap64Scalar};
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  SSSE3
+             ***********************************************************************************/
+
+            /**
+             * @brief Shuffle masks reversing the bytes of each lane of 16 bytes
+             */
+            template <std::size_t size>
+            __attribute__((target("ssse3"))) __m128i mask128()
+            {
+                if constexpr (size == 2)
+                {
+                    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+                }
+                else if constexpr (size == 4)
+                {
+                    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+                }
+                else
+                {
+                    return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+                }
+            }
+
+            template <std::size_t size, void (*tail)(std::byte *, const std::byte *, std::size_t)>
+            __attribute__((target("ssse3"))) void swapSsse3(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                const __m128i mask = mask128<size>();
+                std::size_t bytes = count * size;
+                std::size_t i = 0;
+                for (; i + 16 <= bytes; i += 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(v, mask));
+                }
+                tail(out + i, in + i, (bytes - i) / size);
+            }
+
+            const ByteSwapKernels Ssse3Kernels = {
+                swapSsse3<2, swap16Scalar>,
+                swapSsse3<4, swap32Scalar>,
+                swapSsse3<8, swap64Scalar>,
+            };
+
+            /***********************************************************************************
+             *                                  AVX2
+             ***********************************************************************************/
+
+            template <std::size_t size, void (*tail)(std::byte *, const std::byte *, std::size_t)>
+            __attribute__((target("avx2"))) void swapAvx2(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                const __m256i mask = _mm256_broadcastsi128_si256(mask128<size>());
+                std::size_t bytes = count * size;
+                std::size_t i = 0;
+                for (; i + 64 <= bytes; i += 64)
+                {
+                    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 32));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(v0, mask));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 32), _mm256_shuffle_epi8(v1, mask));
+                }
+                for (; i + 32 <= bytes; i += 32)
+                {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(v, mask));
+                }
+                tail(out + i, in + i, (bytes - i) / size);
+            }
+
+            const ByteSwapKernels Avx2Kernels = {
+                swapAvx2<2, swap16Scalar>,
+                swapAvx2<4, swap32Scalar>,
+                swapAvx2<8, swap64Scalar>,
+            };
+#endif
+        }
+
+        /**
+         * @brief Best instruction set supported by the processor
+         */
+        SimdLevel simdLevel()
+        {
+#ifdef SERIAL_X86
+            static const SimdLevel level = []
+            {
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                {
+                    return SimdLevel::AVX2;
+                }
+                if (__builtin_cpu_supports("ssse3"))
+                {
+                    return SimdLevel::SSSE3;
+                }
+                return SimdLevel::Scalar;
+            }();
+            return level;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const ByteSwapKernels &byteSwapKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            switch (level)
+            {
+            case SimdLevel::AVX2:
+                return Avx2Kernels;
+            case SimdLevel::SSSE3:
+                return Ssse3Kernels;
+            case SimdLevel::Scalar:
+                break;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
@@ -0,0 +1,80 @@
+#ifndef BYTE_SWAP_H
+#define BYTE_SWAP_H
+
+#include <cstddef>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief The instruction sets the kernels can use
+		 */
+		enum class SimdLevel
+		{
+			Scalar,
+			SSSE3,
+			AVX2,
+		};
+
+		/**
+		 * @brief Best instruction set supported by the processor
+		 *
+		 * Detected once with CPUID.
+		 */
+		SimdLevel simdLevel();
+
+		/**
+		 * @brief Byte swapping kernels
+		 *
+		 * Each kernel copies `count` values of 16, 32 or 64 bits from `in` to
+		 * `out` reversing the order of the bytes of each value. `in` and `out`
+		 * may be equal but must not otherwise overlap, and need no alignment.
+		 */
+		struct ByteSwapKernels
+		{
+			void (*swap16)(std::byte *out, const std::byte *in, std::size_t count);
+			void (*swap32)(std::byte *out, const std::byte *in, std::size_t count);
+			void (*swap64)(std::byte *out, const std::byte *in, std::size_t count);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`.
+		 */
+		const ByteSwapKernels &byteSwapKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const ByteSwapKernels &byteSwapKernels()
+		{
+			static const ByteSwapKernels &kernels = byteSwapKernels(simdLevel());
+			return kernels;
+		}
+
+		/**
+		 * @brief Byte-swap `count` values of `size` bytes from `in` to `out`
+		 */
+		template <std::size_t size>
+		inline void byteSwap(std::byte *out, const std::byte *in, std::size_t count)
+		{
+			static_assert(size == 2 || size == 4 || size == 8, "unsupported value size");
+			if constexpr (size == 2)
+			{
+				byteSwapKernels().swap16(out, in, count);
+			}
+			else if constexpr (size == 4)
+			{
+				byteSwapKernels().swap32(out, in, count);
+			}
+			else
+			{
+				byteSwapKernels().swap64(out, in, count);
+			}
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // BYTE_SWAP_H
@@ -0,0 +1,723 @@
+#include "Codec.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef SERIAL_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef SERIAL_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                    Lz
+             ***********************************************************************************/
+
+            /*
+             * A block is a sequence of commands. Each command is a token byte
+             * holding the number of literals in its high nibble and the length
+             * of the match minus 4 in its low nibble, 15 meaning that the
+             * length goes on in the next bytes, summed until one is not 255.
+             * The token is followed by the literals, the 16-bit little endian
+             * offset of the match and the rest of its length. The last command
+             * only has literals.
+             */
+
+            constexpr std::size_t MinMatch = 4;
+            constexpr std::size_t MaxOffset = 65535;
+            constexpr std::size_t LastLiterals = 5;
+            constexpr unsigned HashBits = 14;
+
+            uint32_t load32(const std::byte *b)
+            {
+                uint32_t x;
+                std::memcpy(&x, b, sizeof(x));
+                return x;
+            }
+
+            uint64_t load64(const std::byte *b)
+            {
+                uint64_t x;
+                std::memcpy(&x, b, sizeof(x));
+                return x;
+            }
+
+            uint32_t hash(const std::byte *b, unsigned bits = HashBits)
+            {
+                return (load32(b) * 2654435761u) >> (32 - bits);
+            }
+
+            /**
+             * @brief Number of equal bytes at `a` and `b`, up to `limit`
+             */
+            std::size_t matchLength(const std::byte *a, const std::byte *b, const std::byte *limit)
+            {
+                const std::byte *start = a;
+                while (a + 8 <= limit)
+                {
+                    uint64_t x = load64(a) ^ load64(b);
+                    if (x != 0)
+                    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                        return a - start + __builtin_clzll(x) / 8;
+#else
+                        return a - start + __builtin_ctzll(x) / 8;
+#endif
+                    }
+                    a += 8;
+                    b += 8;
+                }
+                while (a < limit && *a == *b)
+                {
+                    ++a;
+                    ++b;
+                }
+                return a - start;
+            }
+
+            std::byte *writeLength(std::byte *out, std::size_t length)
+            {
+                for (; length >= 255; length -= 255)
+                {
+                    *out++ = std::byte(255);
+                }
+                *out++ = static_cast<std::byte>(length);
+                return out;
+            }
+
+            /**
+             * @brief Write a command of `literals` literals pointed by `in`
+             * followed by a match of `length` bytes at `offset` if `length` is
+             * not 0
+             */
+            std::byte *writeCommand(std::byte *out, const std::byte *in, std::size_t literals,
+                                    std::size_t offset, std::size_t length)
+            {
+                std::byte *token = out++;
+                std::size_t match = length == 0 ? 0 : length - MinMatch;
+                *token = static_cast<std::byte>((std::min<std::size_t>(literals, 15) << 4) |
+                                                std::min<std::size_t>(match, 15));
+                if (literals >= 15)
+                {
+                    out = writeLength(out, literals - 15);
+                }
+                if (literals > 0)
+                {
+                    std::memcpy(out, in, literals);
+                    out += literals;
+                }
+                if (length == 0)
+                {
+                    return out;
+                }
+                *out++ = static_cast<std::byte>(offset);
+                *out++ = static_cast<std::byte>(offset >> 8);
+                if (match >= 15)
+                {
+                    out = writeLength(out, match - 15);
+                }
+                return out;
+            }
+
+            std::size_t lzBound(std::size_t size)
+            {
+                return size + size / 255 + 16;
+            }
+
+            /**
+             * @brief Greedy parse with a hash table of the last position of
+             * each 4-byte sequence, the search skipping faster and faster
+             * through the data that does not match
+             */
+            std::size_t lzCompress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size)
+            {
+                if (capacity < lzBound(size))
+                {
+                    return 0;
+                }
+                std::byte *op = out;
+                std::size_t anchor = 0;
+                if (size > LastLiterals + MinMatch)
+                {
+                    std::vector<uint32_t> table(std::size_t(1) << HashBits, 0);
+                    const std::byte *limit = in + size - LastLiterals;
+                    std::size_t ip = 0;
+                    while (ip + MinMatch <= size - LastLiterals)
+                    {
+                        uint32_t h = hash(in + ip);
+                        std::size_t candidate = table[h];
+                        table[h] = static_cast<uint32_t>(ip);
+                        if (candidate >= ip || ip - candidate > MaxOffset || load32(in + candidate) != load32(in + ip))
+                        {
+                            ip += 1 + ((ip - anchor) >> 6);
+                            continue;
+                        }
+                        std::size_t length = MinMatch + matchLength(in + ip + MinMatch, in + candidate + MinMatch, limit);
+                        while (ip > anchor && candidate > 0 && in[ip - 1] == in[candidate - 1])
+                        {
+                            --ip;
+                            --candidate;
+                            ++length;
+                        }
+                        op = writeCommand(op, in + anchor, ip - anchor, ip - candidate, length);
+                        ip += length;
+                        anchor = ip;
+                        if (ip + MinMatch <= size)
+                        {
+                            table[hash(in + ip - 2)] = static_cast<uint32_t>(ip - 2);
+                        }
+                    }
+                }
+                op = writeCommand(op, in + anchor, size - anchor, 0, 0);
+                return op - out;
+            }
+
+            bool readLength(const std::byte *&in, const std::byte *end, std::size_t &length)
+            {
+                std::byte b;
+                do
+                {
+                    if (in == end)
+                    {
+                        return false;
+                    }
+                    b = *in++;
+                    length += static_cast<std::size_t>(b);
+                } while (b == std::byte(255));
+                return true;
+            }
+
+            /**
+             * @brief Decompress a block whose matches may reach back in the
+             * `dictionary_size` bytes pointed by `dictionary`, as if they
+             * preceded `out`
+             */
+            bool lzDecode(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored,
+                          const std::byte *dictionary, std::size_t dictionary_size)
+            {
+                const std::byte *ip = in;
+                const std::byte *iend = in + stored;
+                std::byte *op = out;
+                std::byte *oend = out + size;
+                while (ip < iend)
+                {
+                    unsigned token = static_cast<unsigned>(*ip++);
+                    std::size_t literals = token >> 4;
+                    if (literals == 15 && !readLength(ip, iend, literals))
+                    {
+                        return false;
+                    }
+                    if (literals > static_cast<std::size_t>(iend - ip) || literals > static_cast<std::size_t>(oend - op))
+                    {
+                        return false;
+                    }
+                    if (literals <= 16 && iend - ip >= 16 && oend - op >= 16)
+                    {
+                        // Copy a whole word, the extra bytes are overwritten
+                        // by the next ones
+                        std::memcpy(op, ip, 16);
+                    }
+                    else if (literals > 0)
+                    {
+                        std::memcpy(op, ip, literals);
+                    }
+                    ip += literals;
+                    op += literals;
+                    if (ip == iend)
+                    {
+                        return op == oend;
+                    }
+                    if (iend - ip < 2)
+                    {
+                        return false;
+                    }
+                    std::size_t offset = static_cast<std::size_t>(ip[0]) | static_cast<std::size_t>(ip[1]) << 8;
+                    ip += 2;
+                    std::size_t length = token & 15;
+                    if (length == 15 && !readLength(ip, iend, length))
+                    {
+                        return false;
+                    }
+                    length += MinMatch;
+                    if (offset == 0 || offset > static_cast<std::size_t>(op - out) + dictionary_size ||
+                        length > static_cast<std::size_t>(oend - op))
+                    {
+                        return false;
+                    }
+                    std::byte *end = op + length;
+                    if (offset > static_cast<std::size_t>(op - out))
+                    {
+                        // The match starts in the dictionary and may go on at
+                        // the beginning of the output
+                        std::size_t back = offset - (op - out);
+                        std::size_t head = std::min(length, back);
+                        std::memcpy(op, dictionary + dictionary_size - back, head);
+                        for (std::size_t i = head; i < length; ++i)
+                        {
+                            op[i] = out[i - head];
+                        }
+                        op = end;
+                        continue;
+                    }
+                    if (static_cast<std::size_t>(oend - op) >= length + 8)
+                    {
+                        // Copy by words, the extra bytes being overwritten by
+                        // the next ones. A match closer than a word repeats
+                        // its first bytes one by one, then the multiple of its
+                        // offset of at least a word repeats the same pattern
+                        std::size_t distance = offset;
+                        std::byte *p = op;
+                        if (offset < 8)
+                        {
+                            for (; p < op + 8; ++p)
+                            {
+                                *p = *(p - offset);
+                            }
+                            distance = offset * ((8 + offset - 1) / offset);
+                        }
+                        for (; p < end; p += 8)
+                        {
+                            std::memcpy(p, p - distance, 8);
+                        }
+                        op = end;
+                        continue;
+                    }
+                    if (offset >= length)
+                    {
+                        std::memcpy(op, op - offset, length);
+                        op = end;
+                        continue;
+                    }
+                    for (; op < end; ++op)
+                    {
+                        *op = *(op - offset);
+                    }
+                }
+                return false;
+            }
+
+            bool lzDecompress(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored)
+            {
+                return lzDecode(out, size, in, stored, nullptr, 0);
+            }
+
+            const Codec LzCodec = {
+                "lz",
+                lzBound,
+                lzCompress,
+                lzDecompress,
+            };
+
+            /**
+             * @brief Number of previous positions of a 4-byte sequence that
+             * the slower parse looks at, and length of a match long enough to
+             * stop looking
+             */
+            constexpr std::size_t ChainDepth = 16;
+            constexpr std::size_t NiceLength = 64;
+            constexpr unsigned ChainHashBits = 16;
+            constexpr uint32_t NoPosition = UINT32_MAX;
+
+            /**
+             * @brief Lazy parse with hash chains of the previous positions of
+             * each 4-byte sequence in reach, the longest of their matches
+             * being taken unless the next position has a longer one
+             *
+             * Writes the format of `lzCompress()`, in several times its time.
+             */
+            std::size_t lzHighCompress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size)
+            {
+                if (capacity < lzBound(size))
+                {
+                    return 0;
+                }
+                std::byte *op = out;
+                std::size_t anchor = 0;
+                if (size > LastLiterals + MinMatch)
+                {
+                    std::vector<uint32_t> heads(std::size_t(1) << ChainHashBits, NoPosition);
+                    std::vector<uint32_t> chains(MaxOffset + 1);
+                    const std::byte *limit = in + size - LastLiterals;
+                    std::size_t end = size - LastLiterals;
+                    std::size_t inserted = 0;
+                    // Longest match at `ip`, after the positions before it
+                    // are inserted in the chains
+                    auto find = [&](std::size_t ip, std::size_t &candidate)
+                    {
+                        for (; inserted < ip; ++inserted)
+                        {
+                            uint32_t h = hash(in + inserted, ChainHashBits);
+                            chains[inserted & MaxOffset] = heads[h];
+                            heads[h] = static_cast<uint32_t>(inserted);
+                        }
+                        std::size_t best = 0;
+                        uint32_t position = heads[hash(in + ip, ChainHashBits)];
+                        for (std::size_t depth = 0; depth < ChainDepth && position != NoPosition && ip - position <= MaxOffset; ++depth)
+                        {
+                            if (load32(in + position) == load32(in + ip))
+                            {
+                                std::size_t length = MinMatch + matchLength(in + ip + MinMatch, in + position + MinMatch, limit);
+                                if (length > best)
+                                {
+                                    best = length;
+                                    candidate = position;
+                                    if (length >= NiceLength)
+                                    {
+                                        break;
+                                    }
+                                }
+                            }
+                            position = chains[position & MaxOffset];
+                        }
+                        return best;
+                    };
+                    std::size_t ip = 0;
+                    while (ip + MinMatch <= end)
+                    {
+                        std::size_t candidate = 0;
+                        std::size_t length = find(ip, candidate);
+                        if (length == 0)
+                        {
+                            ++ip;
+                            continue;
+                        }
+                        // A longer match at the next position is worth one
+                        // more literal
+                        std::size_t next_candidate = 0;
+                        while (ip + 1 + MinMatch <= end)
+                        {
+                            std::size_t next = find(ip + 1, next_candidate);
+                            if (next <= length)
+                            {
+                                break;
+                            }
+                            ++ip;
+                            length = next;
+                            candidate = next_candidate;
+                        }
+                        op = writeCommand(op, in + anchor, ip - anchor, ip - candidate, length);
+                        ip += length;
+                        anchor = ip;
+                    }
+                }
+                op = writeCommand(op, in + anchor, size - anchor, 0, 0);
+                return op - out;
+            }
+
+            const Codec LzHighCodec = {
+                "lzhigh",
+                lzBound,
+                lzHighCompress,
+                lzDecompress,
+            };
+
+#ifdef SERIAL_HAVE_LZ4
+            /***********************************************************************************
+             *                                    LZ4
+             ***********************************************************************************/
+
+            std::size_t lz4Bound(std::size_t size)
+            {
+                return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(size)));
+            }
+
+            std::size_t lz4Compress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size)
+            {
+                if (size > LZ4_MAX_INPUT_SIZE || capacity > INT_MAX)
+                {
+                    return 0;
+                }
+                int stored = LZ4_compress_default(reinterpret_cast<const char *>(in), reinterpret_cast<char *>(out),
+                                                  static_cast<int>(size), static_cast<int>(capacity));
+                return stored > 0 ? static_cast<std::size_t>(stored) : 0;
+            }
+
+            bool lz4Decompress(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored)
+            {
+                if (size > INT_MAX || stored > INT_MAX)
+                {
+                    return false;
+                }
+                int count = LZ4_decompress_safe(reinterpret_cast<const char *>(in), reinterpret_cast<char *>(out),
+                                                static_cast<int>(stored), static_cast<int>(size));
+                return count >= 0 && static_cast<std::size_t>(count) == size;
+            }
+
+            const Codec Lz4Codec = {
+                "lz4",
+                lz4Bound,
+                lz4Compress,
+                lz4Decompress,
+            };
+#endif
+
+#ifdef SERIAL_HAVE_ZSTD
+            /***********************************************************************************
+             *                                 Zstandard
+             ***********************************************************************************/
+
+            constexpr int ZstdLevel = 3;
+
+            std::size_t zstdBound(std::size_t size)
+            {
+                return ZSTD_compressBound(size);
+            }
+
+            std::size_t zstdCompress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size)
+            {
+                std::size_t stored = ZSTD_compress(out, capacity, in, size, ZstdLevel);
+                return ZSTD_isError(stored) ? 0 : stored;
+            }
+
+            bool zstdDecompress(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored)
+            {
+                std::size_t count = ZSTD_decompress(out, size, in, stored);
+                return !ZSTD_isError(count) && count == size;
+            }
+
+            const Codec ZstdCodec = {
+                "zstd",
+                zstdBound,
+                zstdCompress,
+                zstdDecompress,
+            };
+#endif
+        }
+
+        /***********************************************************************************
+         *                                 Dictionaries
+         ***********************************************************************************/
+
+        /**
+         * @brief Hash table of the last position of each 4-byte sequence of
+         * the dictionary
+         */
+        std::vector<uint32_t> lzDictionaryTable(const std::byte *dictionary, std::size_t size)
+        {
+            std::vector<uint32_t> table(std::size_t(1) << HashBits, 0);
+            for (std::size_t i = 0; i + MinMatch <= size; ++i)
+            {
+                table[hash(dictionary + i)] = static_cast<uint32_t>(i);
+            }
+            return table;
+        }
+
+        /**
+         * @brief Greedy parse looking for matches in the data first, with a
+         * hash table sized for it, then in the dictionary
+         */
+        std::size_t lzCompressWithDictionary(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size,
+                                             const std::byte *dictionary, std::size_t dictionary_size,
+                                             const uint32_t *dictionary_table)
+        {
+            if (dictionary_size < MinMatch)
+            {
+                return lzCompress(out, capacity, in, size);
+            }
+            if (capacity < lzBound(size))
+            {
+                return 0;
+            }
+            std::byte *op = out;
+            std::size_t anchor = 0;
+            if (size > LastLiterals + MinMatch)
+            {
+                unsigned bits = 8;
+                while (bits < HashBits && (std::size_t(1) << bits) < size)
+                {
+                    ++bits;
+                }
+                std::vector<uint32_t> table(std::size_t(1) << bits, 0);
+                const std::byte *limit = in + size - LastLiterals;
+                std::size_t ip = 0;
+                while (ip + MinMatch <= size - LastLiterals)
+                {
+                    uint32_t h = hash(in + ip);
+                    uint32_t local = h >> (HashBits - bits);
+                    std::size_t candidate = table[local];
+                    table[local] = static_cast<uint32_t>(ip);
+                    std::size_t length = 0;
+                    std::size_t offset = 0;
+                    if (candidate < ip && ip - candidate <= MaxOffset && load32(in + candidate) == load32(in + ip))
+                    {
+                        length = MinMatch + matchLength(in + ip + MinMatch, in + candidate + MinMatch, limit);
+                        while (ip > anchor && candidate > 0 && in[ip - 1] == in[candidate - 1])
+                        {
+                            --ip;
+                            --candidate;
+                            ++length;
+                        }
+                        offset = ip - candidate;
+                    }
+                    else
+                    {
+                        std::size_t d = dictionary_table[h];
+                        if (ip + dictionary_size - d <= MaxOffset && load32(dictionary + d) == load32(in + ip))
+                        {
+                            // Up to the end of the dictionary, then on at the
+                            // beginning of the data
+                            const std::byte *bound = std::min(limit, in + ip + (dictionary_size - d));
+                            length = matchLength(in + ip, dictionary + d, bound);
+                            if (in + ip + length == bound && bound != limit)
+                            {
+                                length += matchLength(in + ip + length, in, limit);
+                            }
+                            while (ip > anchor && d > 0 && in[ip - 1] == dictionary[d - 1])
+                            {
+                                --ip;
+                                --d;
+                                ++length;
+                            }
+                            offset = ip + dictionary_size - d;
+                        }
+                    }
+                    if (length == 0)
+                    {
+                        ip += 1 + ((ip - anchor) >> 6);
+                        continue;
+                    }
+                    op = writeCommand(op, in + anchor, ip - anchor, offset, length);
+                    ip += length;
+                    anchor = ip;
+                    if (ip + MinMatch <= size)
+                    {
+                        table[hash(in + ip - 2, bits)] = static_cast<uint32_t>(ip - 2);
+                    }
+                }
+            }
+            op = writeCommand(op, in + anchor, size - anchor, 0, 0);
+            return op - out;
+        }
+
+        bool lzDecompressWithDictionary(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored,
+                                        const std::byte *dictionary, std::size_t dictionary_size)
+        {
+            return lzDecode(out, size, in, stored, dictionary, dictionary_size);
+        }
+
+        /***********************************************************************************
+         *                                   Selection
+         ***********************************************************************************/
+
+        namespace
+        {
+            /**
+             * @brief A block is sampled by chunks spread over it
+             */
+            constexpr std::size_t SampleChunks = 16;
+            constexpr std::size_t SampleChunkSize = 256;
+
+            /**
+             * @brief Entropies above which a block is stored raw, and below
+             * which it is worth the strong codec
+             */
+            constexpr double RawEntropy = 7.5;
+            constexpr double StrongEntropy = 6.0;
+        }
+
+        /**
+         * @brief Entropy in bits per byte of the histogram of a sample of the
+         * `size` bytes pointed by `data`
+         */
+        double sampleEntropy(const std::byte *data, std::size_t size)
+        {
+            uint32_t counts[256] = {};
+            std::size_t total = 0;
+            auto count = [&](const std::byte *chunk, std::size_t length)
+            {
+                for (std::size_t i = 0; i < length; ++i)
+                {
+                    ++counts[static_cast<uint8_t>(chunk[i])];
+                }
+                total += length;
+            };
+            if (size <= SampleChunks * SampleChunkSize)
+            {
+                count(data, size);
+            }
+            else
+            {
+                std::size_t stride = (size - SampleChunkSize) / (SampleChunks - 1);
+                for (std::size_t i = 0; i < SampleChunks; ++i)
+                {
+                    count(data + i * stride, SampleChunkSize);
+                }
+            }
+            double entropy = 0;
+            for (uint32_t c : counts)
+            {
+                if (c != 0)
+                {
+                    double p = static_cast<double>(c) / total;
+                    entropy -= p * std::log2(p);
+                }
+            }
+            return entropy;
+        }
+
+        /**
+         * @brief Codec of `Compression::Auto` for the `size` bytes pointed by
+         * `data`
+         *
+         * `Compression::None` when the sample looks incompressible, the
+         * strong codec, `Zstd` or else `LzHigh`, when it is very redundant,
+         * and the fast one, `Lz4` or else `Lz`, in between.
+         */
+        Compression selectCompression(const std::byte *data, std::size_t size)
+        {
+            double entropy = sampleEntropy(data, size);
+            if (entropy >= RawEntropy)
+            {
+                return Compression::None;
+            }
+            if (entropy < StrongEntropy)
+            {
+                return compressionAvailable(Compression::Zstd) ? Compression::Zstd : Compression::LzHigh;
+            }
+            return compressionAvailable(Compression::Lz4) ? Compression::Lz4 : Compression::Lz;
+        }
+
+        /**
+         * @brief The codec `compression`, or `nullptr` if it is not built in
+         */
+        const Codec *findCodec(Compression compression)
+        {
+            switch (compression)
+            {
+            case Compression::Lz:
+                return &LzCodec;
+            case Compression::LzHigh:
+                return &LzHighCodec;
+#ifdef SERIAL_HAVE_LZ4
+            case Compression::Lz4:
+                return &Lz4Codec;
+#endif
+#ifdef SERIAL_HAVE_ZSTD
+            case Compression::Zstd:
+                return &ZstdCodec;
+#endif
+            default:
+                return nullptr;
+            }
+        }
+    } // namespace detail
+
+    /**
+     * @brief Whether the codec `compression` is built in this library
+     */
+    bool compressionAvailable(Compression compression)
+    {
+        return compression == Compression::Auto || detail::findCodec(compression) != nullptr;
+    }
+} // namespace serial
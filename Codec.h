@@ -0,0 +1,105 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace serial
+{
+	/**
+	 * @brief Codecs compressing the blocks of an archive
+	 *
+	 * `Lz` and `LzHigh`, a slower parse in the format of `Lz`, are always
+	 * built in, `Lz4` and `Zstd` only when the libraries were found when the
+	 * project was configured. `Auto` picks the codec of each block from a
+	 * sample of it.
+	 */
+	enum class Compression : uint8_t
+	{
+		None = 0,
+		Lz = 1,
+		Lz4 = 2,
+		Zstd = 3,
+		LzHigh = 4,
+		Auto = 15,
+	};
+
+	/**
+	 * @brief Whether the codec `compression` is built in this library,
+	 * always true for `Auto`
+	 */
+	bool compressionAvailable(Compression compression);
+
+	namespace detail
+	{
+		/**
+		 * @brief A block compression codec
+		 *
+		 * `compress` compresses the `size` bytes pointed by `in` in the
+		 * `capacity` bytes pointed by `out`, which must hold at least
+		 * `bound(size)` bytes, and returns the compressed size, or 0 in case
+		 * of error. `decompress` decompresses the `stored` bytes pointed by
+		 * `in` in exactly `size` bytes pointed by `out`, and returns false if
+		 * they are corrupted.
+		 */
+		struct Codec
+		{
+			const char *name;
+			std::size_t (*bound)(std::size_t size);
+			std::size_t (*compress)(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size);
+			bool (*decompress)(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored);
+		};
+
+		/**
+		 * @brief The codec `compression`, or `nullptr` if it is not built in
+		 * this library or is `Compression::None` or `Compression::Auto`
+		 */
+		const Codec *findCodec(Compression compression);
+
+		/**
+		 * @brief Entropy in bits per byte of the histogram of a sample of the
+		 * `size` bytes pointed by `data`, 16 chunks of 256 bytes spread over
+		 * them
+		 */
+		double sampleEntropy(const std::byte *data, std::size_t size);
+
+		/**
+		 * @brief Codec of `Compression::Auto` for the `size` bytes pointed by
+		 * `data`
+		 *
+		 * `Compression::None` when their sample has 7.5 bits of entropy per
+		 * byte or more and looks incompressible, the strong codec, `Zstd` or
+		 * else `LzHigh`, below 6 bits where they are redundant enough to pay
+		 * for it, and the fast one, `Lz4` or else `Lz`, in between.
+		 */
+		Compression selectCompression(const std::byte *data, std::size_t size);
+
+		/**
+		 * @brief Hash table of a dictionary of the `Lz` codec, made once for
+		 * `lzCompressWithDictionary()`
+		 */
+		std::vector<uint32_t> lzDictionaryTable(const std::byte *dictionary, std::size_t size);
+
+		/**
+		 * @brief Compress with the `Lz` codec, the matches reaching back in the
+		 * `dictionary_size` bytes pointed by `dictionary` as if they preceded
+		 * the data
+		 *
+		 * `dictionary_table` is the table of the dictionary. Works as
+		 * `Codec::compress` otherwise, with the same bound.
+		 */
+		std::size_t lzCompressWithDictionary(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size,
+											 const std::byte *dictionary, std::size_t dictionary_size,
+											 const uint32_t *dictionary_table);
+
+		/**
+		 * @brief Decompress a block compressed by `lzCompressWithDictionary()`
+		 * with the same dictionary
+		 */
+		bool lzDecompressWithDictionary(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored,
+										const std::byte *dictionary, std::size_t dictionary_size);
+	} // namespace detail
+} // namespace serial
+
+#endif // CODEC_H
@@ -0,0 +1,148 @@
+#include "Crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            /**
+             * @brief The Castagnoli polynomial, bits reversed
+             */
+            constexpr uint32_t Polynomial = 0x82F63B78;
+
+            using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+            /**
+             * @brief `Tables[k][b]` is the checksum of the byte `b` followed by
+             * `k` zero bytes, so that 8 bytes are folded with 8 lookups
+             */
+            constexpr Tables makeTables()
+            {
+                Tables tables{};
+                for (uint32_t b = 0; b < 256; ++b)
+                {
+                    uint32_t crc = b;
+                    for (int bit = 0; bit < 8; ++bit)
+                    {
+                        crc = (crc >> 1) ^ ((crc & 1) != 0 ? Polynomial : 0);
+                    }
+                    tables[0][b] = crc;
+                }
+                for (std::size_t k = 1; k < 8; ++k)
+                {
+                    for (uint32_t b = 0; b < 256; ++b)
+                    {
+                        uint32_t previous = tables[k - 1][b];
+                        tables[k][b] = (previous >> 8) ^ tables[0][previous & 0xFF];
+                    }
+                }
+                return tables;
+            }
+
+            constexpr Tables CrcTables = makeTables();
+
+            uint32_t updateByte(uint32_t crc, std::byte b)
+            {
+                return (crc >> 8) ^ CrcTables[0][(crc ^ static_cast<uint32_t>(b)) & 0xFF];
+            }
+
+            uint32_t loadLittle32(const std::byte *b)
+            {
+                return static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8 |
+                       static_cast<uint32_t>(b[2]) << 16 | static_cast<uint32_t>(b[3]) << 24;
+            }
+
+            uint32_t updateScalar(uint32_t crc, const std::byte *data, std::size_t size)
+            {
+                crc = ~crc;
+                for (; size >= 8; size -= 8, data += 8)
+                {
+                    uint32_t low = loadLittle32(data) ^ crc;
+                    uint32_t high = loadLittle32(data + 4);
+                    crc = CrcTables[7][low & 0xFF] ^ CrcTables[6][(low >> 8) & 0xFF] ^
+                          CrcTables[5][(low >> 16) & 0xFF] ^ CrcTables[4][low >> 24] ^
+                          CrcTables[3][high & 0xFF] ^ CrcTables[2][(high >> 8) & 0xFF] ^
+                          CrcTables[1][(high >> 16) & 0xFF] ^ CrcTables[0][high >> 24];
+                }
+                for (; size > 0; --size, ++data)
+                {
+                    crc = updateByte(crc, *data);
+                }
+                return ~crc;
+            }
+
+            const Crc32cKernels ScalarKernels = {
+                updateScalar,
+            };
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  SSE 4.2
+             ***********************************************************************************/
+
+            __attribute__((target("sse4.2"))) uint32_t updateSse42(uint32_t crc, const std::byte *data, std::size_t size)
+            {
+                crc = ~crc;
+#ifdef __x86_64__
+                uint64_t crc64 = crc;
+                for (; size >= 8; size -= 8, data += 8)
+                {
+                    uint64_t word;
+                    std::memcpy(&word, data, sizeof(word));
+                    crc64 = _mm_crc32_u64(crc64, word);
+                }
+                crc = static_cast<uint32_t>(crc64);
+#endif
+                for (; size >= 4; size -= 4, data += 4)
+                {
+                    uint32_t word;
+                    std::memcpy(&word, data, sizeof(word));
+                    crc = _mm_crc32_u32(crc, word);
+                }
+                for (; size > 0; --size, ++data)
+                {
+                    crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*data));
+                }
+                return ~crc;
+            }
+
+            const Crc32cKernels Sse42Kernels = {
+                updateSse42,
+            };
+#endif
+        }
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const Crc32cKernels &crc32cKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            if (level >= SimdLevel::SSSE3 && __builtin_cpu_supports("sse4.2"))
+            {
+                return Sse42Kernels;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
@@ -0,0 +1,54 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include "ByteSwap.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief CRC32C (Castagnoli) checksum kernels
+		 *
+		 * `update` extends the checksum `crc` of some bytes with the `size`
+		 * bytes pointed by `data`, which need no alignment. The checksum of no
+		 * bytes is 0.
+		 */
+		struct Crc32cKernels
+		{
+			uint32_t (*update)(uint32_t crc, const std::byte *data, std::size_t size);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`.
+		 * There are kernels using the `crc32` instruction of SSE 4.2, selected
+		 * from the SSSE3 level when the processor has it, and slicing-by-8
+		 * scalar kernels.
+		 */
+		const Crc32cKernels &crc32cKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const Crc32cKernels &crc32cKernels()
+		{
+			static const Crc32cKernels &kernels = crc32cKernels(simdLevel());
+			return kernels;
+		}
+
+		/**
+		 * @brief Checksum of the `size` bytes pointed by `data`
+		 */
+		inline uint32_t crc32c(const std::byte *data, std::size_t size)
+		{
+			return crc32cKernels().update(0, data, size);
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // CRC32C_H
@@ -0,0 +1,208 @@
+#include "Dictionary.h"
+
+#include "Codec.h"
+#include "Crc32c.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace serial
+{
+    namespace
+    {
+        /**
+         * @brief Length of the segments a trained dictionary is made of
+         */
+        constexpr std::size_t SegmentSize = 64;
+
+        /**
+         * @brief Length of the sequences counted in the samples
+         */
+        constexpr std::size_t SequenceSize = 8;
+
+        uint64_t sequenceAt(const std::byte *b)
+        {
+            uint64_t x;
+            std::memcpy(&x, b, sizeof(x));
+            return x;
+        }
+
+        struct Segment
+        {
+            const std::byte *data;
+            std::size_t size;
+            uint64_t score;
+        };
+    }
+
+    /**
+     * @brief Constructor of the empty dictionary
+     */
+    Dictionary::Dictionary()
+    : m_id(0)
+    {
+    }
+
+    /**
+     * @brief Constructor
+     *
+     * Uses `content` as dictionary, or throws a `std::runtime_error` if it is
+     * larger than `MaxCapacity`.
+     */
+    Dictionary::Dictionary(std::vector<std::byte> content)
+    : m_content(std::move(content))
+    {
+        if (m_content.size() > MaxCapacity)
+        {
+            throw std::runtime_error("Error while loading the dictionary!");
+        }
+        m_id = detail::crc32c(m_content.data(), m_content.size());
+        m_table = detail::lzDictionaryTable(m_content.data(), m_content.size());
+    }
+
+    /**
+     * @brief Train a dictionary of at most `capacity` bytes on `samples`
+     *
+     * In the manner of the COVER algorithm of Zstandard: the samples are split
+     * in as many epochs as the dictionary has segments, and the segment of
+     * each epoch whose sequences are in the most samples is kept. Its
+     * sequences then count for nothing, so that the segments do not repeat
+     * each other.
+     */
+    Dictionary Dictionary::train(const std::vector<std::vector<std::byte>> &samples, std::size_t capacity)
+    {
+        capacity = std::min(capacity, MaxCapacity);
+        std::size_t total = 0;
+        for (const std::vector<std::byte> &sample : samples)
+        {
+            total += sample.size();
+        }
+        std::vector<std::byte> content;
+        if (total <= capacity)
+        {
+            for (const std::vector<std::byte> &sample : samples)
+            {
+                content.insert(content.end(), sample.begin(), sample.end());
+            }
+            return Dictionary(std::move(content));
+        }
+
+        // Number of samples each sequence is in
+        std::unordered_map<uint64_t, uint32_t> frequencies;
+        std::vector<uint64_t> sequences;
+        for (const std::vector<std::byte> &sample : samples)
+        {
+            sequences.clear();
+            for (std::size_t i = 0; i + SequenceSize <= sample.size(); ++i)
+            {
+                sequences.push_back(sequenceAt(sample.data() + i));
+            }
+            std::sort(sequences.begin(), sequences.end());
+            sequences.erase(std::unique(sequences.begin(), sequences.end()), sequences.end());
+            for (uint64_t sequence : sequences)
+            {
+                ++frequencies[sequence];
+            }
+        }
+        // Only the sequences shared by several samples are worth anything
+        auto worth = [&](const std::byte *b) -> uint64_t
+        {
+            auto it = frequencies.find(sequenceAt(b));
+            return it != frequencies.end() && it->second > 1 ? it->second : 0;
+        };
+
+        std::size_t epochs = std::max<std::size_t>(capacity / SegmentSize, 1);
+        std::size_t epoch_size = (total + epochs - 1) / epochs;
+        std::vector<Segment> segments;
+        std::size_t next = 0;
+        while (next < samples.size())
+        {
+            // Best window of the samples of the epoch, scored by the sum of
+            // the worth of its sequences
+            Segment best = {nullptr, 0, 0};
+            std::size_t size = 0;
+            for (; next < samples.size() && size < epoch_size; ++next)
+            {
+                const std::vector<std::byte> &sample = samples[next];
+                size += sample.size();
+                if (sample.size() < SequenceSize)
+                {
+                    continue;
+                }
+                std::size_t window = std::min(SegmentSize, sample.size()) - SequenceSize + 1;
+                uint64_t score = 0;
+                for (std::size_t i = 0; i < window; ++i)
+                {
+                    score += worth(sample.data() + i);
+                }
+                std::size_t length = std::min(SegmentSize, sample.size());
+                for (std::size_t start = 0;; ++start)
+                {
+                    if (score > best.score)
+                    {
+                        best = {sample.data() + start, length, score};
+                    }
+                    if (start + length >= sample.size())
+                    {
+                        break;
+                    }
+                    score -= worth(sample.data() + start);
+                    score += worth(sample.data() + start + window);
+                }
+            }
+            if (best.score == 0)
+            {
+                continue;
+            }
+            segments.push_back(best);
+            for (std::size_t i = 0; i + SequenceSize <= best.size; ++i)
+            {
+                frequencies.erase(sequenceAt(best.data + i));
+            }
+        }
+
+        // The best segments last, closest to the records
+        std::stable_sort(segments.begin(), segments.end(), [](const Segment &a, const Segment &b)
+                         { return a.score < b.score; });
+        std::size_t used = 0;
+        std::size_t first = segments.size();
+        while (first > 0 && used + segments[first - 1].size <= capacity)
+        {
+            --first;
+            used += segments[first].size;
+        }
+        for (std::size_t i = first; i < segments.size(); ++i)
+        {
+            content.insert(content.end(), segments[i].data, segments[i].data + segments[i].size);
+        }
+        return Dictionary(std::move(content));
+    }
+
+    /**
+     * @brief Capacity needed to compress `size` bytes
+     */
+    std::size_t Dictionary::bound(std::size_t size) const
+    {
+        return detail::findCodec(Compression::Lz)->bound(size);
+    }
+
+    /**
+     * @brief Compress the `size` bytes pointed by `in` in the `capacity` bytes
+     * pointed by `out`
+     */
+    std::size_t Dictionary::compress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size) const
+    {
+        return detail::lzCompressWithDictionary(out, capacity, in, size, m_content.data(), m_content.size(), m_table.data());
+    }
+
+    /**
+     * @brief Decompress the `stored` bytes pointed by `in` in exactly `size`
+     * bytes pointed by `out`
+     */
+    bool Dictionary::decompress(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored) const
+    {
+        return detail::lzDecompressWithDictionary(out, size, in, stored, m_content.data(), m_content.size());
+    }
+} // namespace serial
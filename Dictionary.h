@@ -0,0 +1,103 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace serial
+{
+	/**
+	 * @brief Bytes that small records are compressed against
+	 *
+	 * Small records compress poorly on their own since the codec has no
+	 * history to find their repeated fields in. With a dictionary holding the
+	 * sequences common to the records, each one is compressed with the `Lz`
+	 * codec as if it followed the dictionary, and stays decompressible on its
+	 * own. A dictionary is identified by the CRC32C of its content.
+	 */
+	class Dictionary
+	{
+	private:
+		std::vector<std::byte> m_content;
+		uint32_t m_id;
+		std::vector<uint32_t> m_table;
+
+	public:
+		/**
+		 * @brief Default size of a trained dictionary
+		 */
+		static constexpr std::size_t DefaultCapacity = 16 * 1024;
+
+		/**
+		 * @brief Largest dictionary, so that the whole of it is in reach of
+		 * the records of up to 32 KiB
+		 */
+		static constexpr std::size_t MaxCapacity = 32 * 1024;
+
+		/**
+		 * @brief Constructor of the empty dictionary
+		 */
+		Dictionary();
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Uses `content` as dictionary, or throws a `std::runtime_error` if it
+		 * is larger than `MaxCapacity`.
+		 */
+		explicit Dictionary(std::vector<std::byte> content);
+
+		/**
+		 * @brief Train a dictionary of at most `capacity` bytes on `samples`
+		 *
+		 * The samples are records of the kind the dictionary will compress.
+		 * The dictionary is made of the segments of the samples whose 8-byte
+		 * sequences are in the most samples, the best ones last since they
+		 * are the cheapest to reach.
+		 */
+		static Dictionary train(const std::vector<std::vector<std::byte>> &samples,
+								std::size_t capacity = DefaultCapacity);
+
+		/**
+		 * @brief Identifier of the dictionary, the CRC32C of its content
+		 */
+		uint32_t id() const noexcept
+		{
+			return m_id;
+		}
+
+		/**
+		 * @brief Content of the dictionary
+		 */
+		const std::vector<std::byte> &content() const noexcept
+		{
+			return m_content;
+		}
+
+		/**
+		 * @brief Capacity needed to compress `size` bytes
+		 */
+		std::size_t bound(std::size_t size) const;
+
+		/**
+		 * @brief Compress the `size` bytes pointed by `in` in the `capacity`
+		 * bytes pointed by `out`
+		 *
+		 * Returns the compressed size, or 0 if `capacity` is below
+		 * `bound(size)`.
+		 */
+		std::size_t compress(std::byte *out, std::size_t capacity, const std::byte *in, std::size_t size) const;
+
+		/**
+		 * @brief Decompress the `stored` bytes pointed by `in` in exactly
+		 * `size` bytes pointed by `out`
+		 *
+		 * Returns false if they are corrupted. Bytes compressed against
+		 * another dictionary decompress to garbage.
+		 */
+		bool decompress(std::byte *out, std::size_t size, const std::byte *in, std::size_t stored) const;
+	};
+} // namespace serial
+
+#endif // DICTIONARY_H
@@ -0,0 +1,160 @@
+#include "Gorilla.h"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /**
+             * @brief Fields of the codec for values of `T`
+             */
+            template <typename T>
+            struct GorillaTraits
+            {
+                using Bits = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+                static constexpr unsigned Width = 8 * sizeof(T);
+                static constexpr unsigned LeadingBits = 5;
+                static constexpr unsigned MaxLeading = (1u << LeadingBits) - 1;
+                static constexpr unsigned LengthBits = sizeof(T) == 8 ? 6 : 5;
+            };
+
+            template <typename Bits>
+            unsigned leadingZeros(Bits x)
+            {
+                if constexpr (sizeof(Bits) == 8)
+                {
+                    return static_cast<unsigned>(__builtin_clzll(x));
+                }
+                else
+                {
+                    return static_cast<unsigned>(__builtin_clz(x));
+                }
+            }
+
+            template <typename Bits>
+            unsigned trailingZeros(Bits x)
+            {
+                if constexpr (sizeof(Bits) == 8)
+                {
+                    return static_cast<unsigned>(__builtin_ctzll(x));
+                }
+                else
+                {
+                    return static_cast<unsigned>(__builtin_ctz(x));
+                }
+            }
+
+            template <typename T>
+            void encode(BitWriter &out, const T *in, std::size_t count)
+            {
+                using Traits = GorillaTraits<T>;
+                using Bits = typename Traits::Bits;
+                if (count == 0)
+                {
+                    return;
+                }
+                Bits previous;
+                std::memcpy(&previous, in, sizeof(T));
+                out.write(previous, Traits::Width);
+                // No window before the first meaningful XOR
+                unsigned leading = Traits::Width;
+                unsigned trailing = 0;
+                for (std::size_t i = 1; i < count; ++i)
+                {
+                    Bits value;
+                    std::memcpy(&value, in + i, sizeof(T));
+                    Bits x = value ^ previous;
+                    previous = value;
+                    if (x == 0)
+                    {
+                        out.write(false);
+                        continue;
+                    }
+                    unsigned lead = leadingZeros(x);
+                    unsigned trail = trailingZeros(x);
+                    if (lead > Traits::MaxLeading)
+                    {
+                        lead = Traits::MaxLeading;
+                    }
+                    if (lead >= leading && trail >= trailing)
+                    {
+                        out.write(uint64_t(0b10), 2);
+                        out.write(x >> trailing, Traits::Width - leading - trailing);
+                        continue;
+                    }
+                    leading = lead;
+                    trailing = trail;
+                    unsigned meaningful = Traits::Width - lead - trail;
+                    out.write(uint64_t(0b11), 2);
+                    out.write(lead, Traits::LeadingBits);
+                    out.write(meaningful == Traits::Width ? 0 : meaningful, Traits::LengthBits);
+                    out.write(x >> trail, meaningful);
+                }
+            }
+
+            template <typename T>
+            void decode(T *out, BitReader &in, std::size_t count)
+            {
+                using Traits = GorillaTraits<T>;
+                using Bits = typename Traits::Bits;
+                if (count == 0)
+                {
+                    return;
+                }
+                Bits previous = static_cast<Bits>(in.read(Traits::Width));
+                std::memcpy(out, &previous, sizeof(T));
+                unsigned leading = 0;
+                unsigned trailing = 0;
+                for (std::size_t i = 1; i < count; ++i)
+                {
+                    if (in.readBit())
+                    {
+                        if (in.readBit())
+                        {
+                            leading = static_cast<unsigned>(in.read(Traits::LeadingBits));
+                            unsigned meaningful = static_cast<unsigned>(in.read(Traits::LengthBits));
+                            if (meaningful == 0)
+                            {
+                                meaningful = Traits::Width;
+                            }
+                            // A corrupted window is clamped to the value
+                            if (leading + meaningful > Traits::Width)
+                            {
+                                meaningful = Traits::Width - leading;
+                            }
+                            trailing = Traits::Width - leading - meaningful;
+                        }
+                        Bits x = static_cast<Bits>(in.read(Traits::Width - leading - trailing));
+                        previous ^= trailing == Traits::Width ? 0 : static_cast<Bits>(x << trailing);
+                    }
+                    std::memcpy(out + i, &previous, sizeof(T));
+                }
+            }
+        }
+
+        void encodeGorilla(BitWriter &out, const double *in, std::size_t count)
+        {
+            encode(out, in, count);
+        }
+
+        void encodeGorilla(BitWriter &out, const float *in, std::size_t count)
+        {
+            encode(out, in, count);
+        }
+
+        void decodeGorilla(double *out, BitReader &in, std::size_t count)
+        {
+            decode(out, in, count);
+        }
+
+        void decodeGorilla(float *out, BitReader &in, std::size_t count)
+        {
+            decode(out, in, count);
+        }
+    } // namespace detail
+} // namespace serial
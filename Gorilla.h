@@ -0,0 +1,41 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include "BitStream.h"
+
+#include <cstddef>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Number of values of a block of the Gorilla codec
+		 */
+		constexpr std::size_t GorillaBlock = 4096;
+
+		/**
+		 * @brief Encode `count` floating point numbers with the XOR codec of
+		 * Facebook's Gorilla
+		 *
+		 * The first value is written raw. Each next one is XORed with the
+		 * previous one: a zero XOR takes a single 0 bit, otherwise a 1 bit is
+		 * followed either by a 0 bit and the meaningful bits of the XOR when
+		 * they fit in the window of the previous XOR, or by a 1 bit, the number
+		 * of leading zeros (5 bits), the number of meaningful bits (6 bits for
+		 * doubles, 5 for floats, 0 standing for all of them) and the meaningful
+		 * bits.
+		 */
+		void encodeGorilla(BitWriter &out, const double *in, std::size_t count);
+		void encodeGorilla(BitWriter &out, const float *in, std::size_t count);
+
+		/**
+		 * @brief Decode `count` floating point numbers encoded by
+		 * `encodeGorilla()`
+		 */
+		void decodeGorilla(double *out, BitReader &in, std::size_t count);
+		void decodeGorilla(float *out, BitReader &in, std::size_t count);
+	} // namespace detail
+} // namespace serial
+
+#endif // GORILLA_H
@@ -0,0 +1,231 @@
+#include "Half.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            uint32_t floatBits(float x)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+                return bits;
+            }
+
+            float bitsFloat(uint32_t bits)
+            {
+                float x;
+                std::memcpy(&x, &bits, sizeof(x));
+                return x;
+            }
+
+            uint16_t toHalf(float x)
+            {
+                uint32_t bits = floatBits(x);
+                uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+                uint32_t abs = bits & 0x7FFFFFFF;
+                if (abs > 0x7F800000)
+                {
+                    return static_cast<uint16_t>(sign | 0x7E00 | ((abs >> 13) & 0x3FF));
+                }
+                // From halfway between the largest half and 2^16, infinity
+                if (abs >= 0x477FF000)
+                {
+                    return static_cast<uint16_t>(sign | 0x7C00);
+                }
+                if (abs < 0x38800000)
+                {
+                    // Subnormal: adding 0.5 leaves the value in units of
+                    // 2^-24 in the low bits, rounded by the processor
+                    return static_cast<uint16_t>(sign | (floatBits(bitsFloat(abs) + 0.5f) - 0x3F000000));
+                }
+                abs -= 0x38000000;
+                return static_cast<uint16_t>(sign | ((abs + 0xFFF + ((abs >> 13) & 1)) >> 13));
+            }
+
+            float fromHalf(uint16_t h)
+            {
+                uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+                uint32_t exponent = (h >> 10) & 0x1F;
+                uint32_t mantissa = h & 0x3FF;
+                if (exponent == 0x1F)
+                {
+                    return bitsFloat(sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0));
+                }
+                if (exponent == 0)
+                {
+                    return bitsFloat(sign | floatBits(static_cast<float>(mantissa) * 0x1p-24f));
+                }
+                return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+            }
+
+            uint16_t toBfloat16(float x)
+            {
+                uint32_t bits = floatBits(x);
+                if ((bits & 0x7FFFFFFF) > 0x7F800000)
+                {
+                    return static_cast<uint16_t>((bits >> 16) | 0x40);
+                }
+                return static_cast<uint16_t>((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+            }
+
+            float fromBfloat16(uint16_t b)
+            {
+                return bitsFloat(static_cast<uint32_t>(b) << 16);
+            }
+
+            template <uint16_t (*narrow)(float)>
+            void narrowScalar(std::byte *out, const float *in, std::size_t count, std::size_t start)
+            {
+                for (std::size_t i = start; i < count; ++i)
+                {
+                    uint16_t value = narrow(in[i]);
+                    std::memcpy(out + 2 * i, &value, 2);
+                }
+            }
+
+            template <float (*widen)(uint16_t)>
+            void widenScalar(float *out, const std::byte *in, std::size_t count, std::size_t start)
+            {
+                for (std::size_t i = start; i < count; ++i)
+                {
+                    uint16_t value;
+                    std::memcpy(&value, in + 2 * i, 2);
+                    out[i] = widen(value);
+                }
+            }
+
+            void toHalfScalar(std::byte *out, const float *in, std::size_t count)
+            {
+                narrowScalar<toHalf>(out, in, count, 0);
+            }
+
+            void fromHalfScalar(float *out, const std::byte *in, std::size_t count)
+            {
+                widenScalar<fromHalf>(out, in, count, 0);
+            }
+
+            void toBfloat16Scalar(std::byte *out, const float *in, std::size_t count)
+            {
+                narrowScalar<toBfloat16>(out, in, count, 0);
+            }
+
+            void fromBfloat16Scalar(float *out, const std::byte *in, std::size_t count)
+            {
+                widenScalar<fromBfloat16>(out, in, count, 0);
+            }
+
+            const HalfKernels ScalarKernels = {
+                toHalfScalar,
+                fromHalfScalar,
+                toBfloat16Scalar,
+                fromBfloat16Scalar,
+            };
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  AVX2
+             ***********************************************************************************/
+
+            __attribute__((target("avx2,f16c"))) void toHalfAvx2(std::byte *out, const float *in, std::size_t count)
+            {
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), h);
+                }
+                narrowScalar<toHalf>(out, in, count, i);
+            }
+
+            __attribute__((target("avx2,f16c"))) void fromHalfAvx2(float *out, const std::byte *in, std::size_t count)
+            {
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+                    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+                }
+                widenScalar<fromHalf>(out, in, count, i);
+            }
+
+            /**
+             * @brief Round the floats to their high halves with integer
+             * additions, NaNs being made quiet instead
+             */
+            __attribute__((target("avx2"))) void toBfloat16Avx2(std::byte *out, const float *in, std::size_t count)
+            {
+                const __m256i bias = _mm256_set1_epi32(0x7FFF);
+                const __m256i one = _mm256_set1_epi32(1);
+                const __m256i quiet = _mm256_set1_epi32(0x40);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256 v = _mm256_loadu_ps(in + i);
+                    __m256i bits = _mm256_castps_si256(v);
+                    __m256i high = _mm256_srli_epi32(bits, 16);
+                    __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(bias, _mm256_and_si256(high, one)));
+                    rounded = _mm256_srli_epi32(rounded, 16);
+                    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+                    rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(high, quiet), nan);
+                    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(rounded, rounded), 0xD8);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm256_castsi256_si128(packed));
+                }
+                narrowScalar<toBfloat16>(out, in, count, i);
+            }
+
+            __attribute__((target("avx2"))) void fromBfloat16Avx2(float *out, const std::byte *in, std::size_t count)
+            {
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+                    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(b), 16);
+                    _mm256_storeu_ps(out + i, _mm256_castsi256_ps(bits));
+                }
+                widenScalar<fromBfloat16>(out, in, count, i);
+            }
+
+            const HalfKernels Avx2Kernels = {
+                toHalfAvx2,
+                fromHalfAvx2,
+                toBfloat16Avx2,
+                fromBfloat16Avx2,
+            };
+#endif
+        }
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const HalfKernels &halfKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            if (level == SimdLevel::AVX2 && __builtin_cpu_supports("f16c"))
+            {
+                return Avx2Kernels;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
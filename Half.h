@@ -0,0 +1,49 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include "ByteSwap.h"
+
+#include <cstddef>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Conversion kernels between floats and 16-bit floating point
+		 * numbers
+		 *
+		 * `toHalf` and `toBfloat16` narrow `count` floats from `in` to IEEE
+		 * binary16 and to bfloat16 values in host order in `out`, rounding to
+		 * nearest even; NaNs stay quiet NaNs. `fromHalf` and `fromBfloat16`
+		 * widen them back exactly. The 16-bit values need no alignment.
+		 */
+		struct HalfKernels
+		{
+			void (*toHalf)(std::byte *out, const float *in, std::size_t count);
+			void (*fromHalf)(float *out, const std::byte *in, std::size_t count);
+			void (*toBfloat16)(std::byte *out, const float *in, std::size_t count);
+			void (*fromBfloat16)(float *out, const std::byte *in, std::size_t count);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`.
+		 * There are AVX2 kernels, which also need F16C, and scalar kernels
+		 * only.
+		 */
+		const HalfKernels &halfKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const HalfKernels &halfKernels()
+		{
+			static const HalfKernels &kernels = halfKernels(simdLevel());
+			return kernels;
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // HALF_H
@@ -1,66 +1,1090 @@
 #include "Serial.h"
 
+#include "BlockPool.h"
+#include "Crc32c.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace serial
 {
+    namespace
+    {
+        /**
+         * @brief Make sure that the bytes [from, to) of the file are allocated
+         *
+         * Falls back to growing the file when the file system cannot
+         * preallocate. Returns false in case of error.
+         */
+        bool preallocate(int fd, std::size_t from, std::size_t to)
+        {
+            if (fallocate(fd, 0, from, to - from) == 0)
+            {
+                return true;
+            }
+            return ftruncate(fd, to) == 0;
+        }
+
+        /**
+         * @brief First bytes of the archives that have a header
+         *
+         * The first bytes of an archive without header are usually a big
+         * endian length, the leading 0x89 makes a collision very unlikely.
+         */
+        constexpr std::byte HeaderMagic[8] = {
+            std::byte(0x89), std::byte('S'), std::byte('R'), std::byte('L'),
+            std::byte('\r'), std::byte('\n'), std::byte(0x1A), std::byte('\n'),
+        };
+
+        /**
+         * @brief The header is the magic followed by the option flags
+         */
+        constexpr std::size_t HeaderSize = sizeof(HeaderMagic) + 4;
+
+        constexpr uint32_t LittleEndianFlag = 1u << 0;
+        constexpr uint32_t CompactIntegersFlag = 1u << 1;
+        constexpr uint32_t DeltaKeysFlag = 1u << 2;
+        constexpr uint32_t BitPackingFlag = 1u << 3;
+        constexpr uint32_t StringDictionaryFlag = 1u << 4;
+        constexpr uint32_t FloatXorFlag = 1u << 5;
+        constexpr uint32_t ByteShuffleFlag = 1u << 6;
+        constexpr uint32_t ChecksumsFlag = 1u << 7;
+        constexpr uint32_t KnownFlags = LittleEndianFlag | CompactIntegersFlag | DeltaKeysFlag | BitPackingFlag |
+                                        StringDictionaryFlag | FloatXorFlag | ByteShuffleFlag | ChecksumsFlag;
+
+        /**
+         * @brief The codec of a compressed archive is recorded in bits 8 to 11
+         * of the flags
+         */
+        constexpr uint32_t CompressionShift = 8;
+        constexpr uint32_t CompressionMask = 0xFu << CompressionShift;
+
+        /**
+         * @brief Each block of an archive stored by blocks starts with the
+         * codec of its payload, `Compression::None` when it is stored raw,
+         * followed by its size and the size of its payload in big endian
+         */
+        constexpr std::size_t BlockHeaderSize = 1 + 4 + 4;
+
+        /**
+         * @brief In archives with checksums, the header of a block goes on
+         * with the big endian CRC32C of its decompressed content
+         */
+        constexpr std::size_t ChecksumSize = 4;
+
+        std::size_t blockHeaderSize(const Format &format)
+        {
+            return BlockHeaderSize + (format.checksums ? ChecksumSize : 0);
+        }
+
+        /**
+         * @brief Whether the options `format` store the archive by blocks
+         */
+        bool isBlocked(const Format &format)
+        {
+            return format.compression != Compression::None || format.checksums;
+        }
+
+        /**
+         * @brief Largest block, larger sizes in a block header are corrupted
+         */
+        constexpr std::size_t MaxBlockSize = std::size_t(1) << 30;
+
+        /**
+         * @brief First bytes of the files of records
+         *
+         * They are followed by the flags of the options of the records, the
+         * identifier of the dictionary and the size of its content in big
+         * endian, then by the content when it is embedded, the records, their
+         * index and the footer.
+         */
+        constexpr std::byte RecordMagic[8] = {
+            std::byte(0x89), std::byte('S'), std::byte('R'), std::byte('C'),
+            std::byte('\r'), std::byte('\n'), std::byte(0x1A), std::byte('\n'),
+        };
+
+        constexpr std::size_t RecordHeaderSize = sizeof(RecordMagic) + 4 + 4 + 4;
+
+        /**
+         * @brief Each record starts with its size and the size of its
+         * payload in big endian, equal when it is stored raw
+         */
+        constexpr std::size_t RecordPrefixSize = 4 + 4;
+
+        /**
+         * @brief The index is the big endian offset of each record in the
+         * file, followed by a footer with the offset of the index and the
+         * number of records
+         */
+        constexpr std::size_t RecordFooterSize = 8 + 8;
+
+        /**
+         * @brief Throws a `std::runtime_error` if the options `format` need
+         * a writer storing the archive by blocks
+         */
+        void checkUnblocked(const Format &format)
+        {
+            if (isBlocked(format))
+            {
+                throw std::runtime_error("Unsupported archive format!");
+            }
+        }
+
+        /**
+         * @brief Store the `used` bytes pointed by `data` as a block in
+         * `packed`, compressed by `codec` if it is not `nullptr`, or by the
+         * codec picked from a sample of them with `Compression::Auto`
+         *
+         * Returns the size of the block.
+         */
+        std::size_t packBlock(const Format &format, const detail::Codec *codec, const std::byte *data,
+                              std::size_t used, std::vector<std::byte> &packed)
+        {
+            Compression method = format.compression;
+            if (method == Compression::Auto)
+            {
+                method = detail::selectCompression(data, used);
+                codec = detail::findCodec(method);
+            }
+            std::size_t header_size = blockHeaderSize(format);
+            packed.resize(header_size + (codec != nullptr ? codec->bound(used) : used));
+            std::byte *payload = packed.data() + header_size;
+            std::size_t stored = 0;
+            if (codec != nullptr)
+            {
+                stored = codec->compress(payload, packed.size() - header_size, data, used);
+            }
+            if (stored == 0 || stored >= used)
+            {
+                method = Compression::None;
+                stored = used;
+                std::memcpy(payload, data, used);
+            }
+            packed[0] = static_cast<std::byte>(method);
+            detail::storeBigEndian(packed.data() + 1, static_cast<uint32_t>(used));
+            detail::storeBigEndian(packed.data() + 5, static_cast<uint32_t>(stored));
+            if (format.checksums)
+            {
+                detail::storeBigEndian(packed.data() + BlockHeaderSize, detail::crc32c(data, used));
+            }
+            return header_size + stored;
+        }
+
+        /**
+         * @brief Count the block starting at `header` in `stats`
+         */
+        void countBlock(BlockStats &stats, const std::byte *header)
+        {
+            switch (static_cast<Compression>(header[0]))
+            {
+            case Compression::None:
+                ++stats.raw;
+                break;
+            case Compression::LzHigh:
+            case Compression::Zstd:
+                ++stats.strong;
+                break;
+            default:
+                ++stats.fast;
+                break;
+            }
+        }
+
+        /**
+         * @brief Decompress the block starting at `header`, whose header was
+         * checked, in the `size` bytes pointed by `data`
+         *
+         * Throws a `std::runtime_error` if the block is corrupted.
+         */
+        void unpackBlock(const Format &format, const std::byte *header, std::byte *data, std::size_t size)
+        {
+            Compression method = static_cast<Compression>(header[0]);
+            std::size_t stored = detail::loadBigEndian<uint32_t>(header + 5);
+            const std::byte *payload = header + blockHeaderSize(format);
+            if (method == Compression::None)
+            {
+                std::memcpy(data, payload, size);
+            }
+            else if (!detail::findCodec(method)->decompress(data, size, payload, stored))
+            {
+                throw std::runtime_error("Error while reading a compressed block!");
+            }
+            if (format.checksums &&
+                detail::crc32c(data, size) != detail::loadBigEndian<uint32_t>(header + BlockHeaderSize))
+            {
+                throw std::runtime_error("Error while reading a corrupted block!");
+            }
+        }
+
+        /**
+         * @brief Capacity of the buffer of a writer asked for `buffer_size`
+         * bytes, which holds a whole block when the archive is stored by
+         * blocks
+         */
+        std::size_t writeBufferSize(const Format &format, std::size_t buffer_size)
+        {
+            if (!isBlocked(format))
+            {
+                return buffer_size;
+            }
+            if (format.compression != Compression::None && !compressionAvailable(format.compression))
+            {
+                throw std::runtime_error("Unsupported archive format!");
+            }
+            if (buffer_size == 0)
+            {
+                return OBinaryFile::DefaultBufferSize;
+            }
+            return std::min(buffer_size, MaxBlockSize);
+        }
+
+        /**
+         * @brief Flags recording the options `format` in a header
+         */
+        uint32_t formatFlags(const Format &format)
+        {
+            uint32_t flags = 0;
+            if (format.byte_order == Format::LittleEndian)
+            {
+                flags |= LittleEndianFlag;
+            }
+            if (format.compact_integers)
+            {
+                flags |= CompactIntegersFlag;
+            }
+            if (format.delta_keys)
+            {
+                flags |= DeltaKeysFlag;
+            }
+            if (format.bit_packing)
+            {
+                flags |= BitPackingFlag;
+            }
+            if (format.string_dictionary)
+            {
+                flags |= StringDictionaryFlag;
+            }
+            if (format.float_xor)
+            {
+                flags |= FloatXorFlag;
+            }
+            if (format.byte_shuffle)
+            {
+                flags |= ByteShuffleFlag;
+            }
+            if (format.checksums)
+            {
+                flags |= ChecksumsFlag;
+            }
+            flags |= static_cast<uint32_t>(format.compression) << CompressionShift;
+            return flags;
+        }
+
+        /**
+         * @brief Options recorded by the flags of a header
+         *
+         * Throws a `std::runtime_error` if the flags have unknown options or a
+         * codec that is not built in this library.
+         */
+        Format formatFromFlags(uint32_t flags)
+        {
+            if ((flags & ~(KnownFlags | CompressionMask)) != 0)
+            {
+                throw std::runtime_error("Unsupported archive format!");
+            }
+            Format format;
+            format.byte_order = (flags & LittleEndianFlag) != 0 ? Format::LittleEndian : Format::BigEndian;
+            format.compact_integers = (flags & CompactIntegersFlag) != 0;
+            format.delta_keys = (flags & DeltaKeysFlag) != 0;
+            format.bit_packing = (flags & BitPackingFlag) != 0;
+            format.string_dictionary = (flags & StringDictionaryFlag) != 0;
+            format.float_xor = (flags & FloatXorFlag) != 0;
+            format.byte_shuffle = (flags & ByteShuffleFlag) != 0;
+            format.checksums = (flags & ChecksumsFlag) != 0;
+            format.compression = static_cast<Compression>((flags & CompressionMask) >> CompressionShift);
+            if (format.compression != Compression::None && !compressionAvailable(format.compression))
+            {
+                throw std::runtime_error("Unsupported archive format!");
+            }
+            return format;
+        }
+
+        /**
+         * @brief Throws a `std::runtime_error` if the archive starting with
+         * the `size` bytes pointed by `data` was not written with the options
+         * `format`, an archive without header having the default ones
+         */
+        void checkAppendable(const Format &format, const std::byte *data, std::size_t size)
+        {
+            Format archive;
+            if (size >= HeaderSize && std::memcmp(data, HeaderMagic, sizeof(HeaderMagic)) == 0)
+            {
+                archive = formatFromFlags(detail::loadBigEndian<uint32_t>(data + sizeof(HeaderMagic)));
+            }
+            if (archive != format)
+            {
+                throw std::runtime_error("Error while appending to an archive of another format!");
+            }
+        }
+    }
+
+    /***********************************************************************************
+     *                                  OBinaryFile
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Opens the file for writing or throws a `std::runtime_error` in case of
+     * error.
+     */
+    OBinaryFile::OBinaryFile(const std::string &filename, Mode mode, std::size_t buffer_size)
+    : OBinaryFile(filename, Format(), mode, buffer_size)
+    {
+    }
+
+    /**
+     * @brief Constructor
+     *
+     * Opens the file for writing with the options `format` or throws a
+     * `std::runtime_error` in case of error.
+     */
+    OBinaryFile::OBinaryFile(const std::string &filename, const Format &format, Mode mode, std::size_t buffer_size)
+    : m_buffer(writeBufferSize(format, buffer_size))
+    , m_cursor(m_buffer.data())
+    , m_limit(m_buffer.data() + m_buffer.size())
+    , m_blocks(false)
+    , m_codec(nullptr)
+    , m_threads(1)
+    {
+        // Appending needs to read the header of the archive
+        const char *opening_mode = (mode == Mode::Append ? "a+b" : "wb");
+        m_file = (fopen(filename.c_str(), opening_mode));
+        if (m_file == NULL)
+        {
+            throw std::runtime_error("Error while opening the file!");
+        }
+        if (!m_buffer.empty())
+        {
+            // Our own buffer replaces the one of stdio
+            setvbuf(m_file, nullptr, _IONBF, 0);
+        }
+        if (fseek(m_file, 0, SEEK_END) == 0 && ftell(m_file) == 0)
+        {
+            writeHeader(format);
+            return;
+        }
+        std::byte header[HeaderSize];
+        std::size_t count = fseek(m_file, 0, SEEK_SET) == 0 ? fread(header, sizeof(std::byte), HeaderSize, m_file) : 0;
+        try
+        {
+            checkAppendable(format, header, count);
+        }
+        catch (...)
+        {
+            fclose(m_file);
+            throw;
+        }
+        appendWith(format);
+    }
+
+    /**
+     * @brief Constructor for writers that are not backed by a `FILE`
+     */
+    OBinaryFile::OBinaryFile() noexcept
+    : m_file(nullptr)
+    , m_cursor(nullptr)
+    , m_limit(nullptr)
+    , m_blocks(false)
+    , m_codec(nullptr)
+    , m_threads(1)
+    {
+    }
+
+    /**
+     * @brief Move constructor
+     */
+    OBinaryFile::OBinaryFile(OBinaryFile &&other) noexcept
+    : m_file(std::exchange(other.m_file, nullptr))
+    , m_buffer(std::move(other.m_buffer))
+    , m_cursor(std::exchange(other.m_cursor, nullptr))
+    , m_limit(std::exchange(other.m_limit, nullptr))
+    , m_format(other.m_format)
+    , m_blocks(std::exchange(other.m_blocks, false))
+    , m_codec(std::exchange(other.m_codec, nullptr))
+    , m_packed(std::move(other.m_packed))
+    , m_threads(std::exchange(other.m_threads, 1))
+    , m_pool(std::move(other.m_pool))
+    , m_stats(std::exchange(other.m_stats, BlockStats()))
+    {
+    }
+
+    /**
+     * @brief Move assignment
+     */
+    OBinaryFile &OBinaryFile::operator=(OBinaryFile &&other) noexcept
+    {
+        std::swap(m_file, other.m_file);
+        std::swap(m_buffer, other.m_buffer);
+        std::swap(m_cursor, other.m_cursor);
+        std::swap(m_limit, other.m_limit);
+        std::swap(m_format, other.m_format);
+        std::swap(m_blocks, other.m_blocks);
+        std::swap(m_codec, other.m_codec);
+        std::swap(m_packed, other.m_packed);
+        std::swap(m_threads, other.m_threads);
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_stats, other.m_stats);
+        return *this;
+    }
+
+    /**
+     * @brief Flushes and closes the file
+     */
+    OBinaryFile::~OBinaryFile()
+    {
+        if (m_file == nullptr){return;}
+        finish();
+        fclose(m_file);
+    }
+
+    /**
+     * @brief Use the options `format` and record them at the current position
+     * if they are not the default ones
+     */
+    void OBinaryFile::writeHeader(const Format &format)
+    {
+        m_format = format;
+        if (format == Format())
+        {
+            return;
+        }
+        std::byte header[HeaderSize];
+        std::memcpy(header, HeaderMagic, sizeof(HeaderMagic));
+        detail::storeBigEndian(header + sizeof(HeaderMagic), formatFlags(format));
+        write(header, HeaderSize);
+        startBlocks();
+    }
+
+    /**
+     * @brief Use the options `format` for writes appended to an archive
+     * written with them, whose header, if any, is already written
+     */
+    void OBinaryFile::appendWith(const Format &format)
+    {
+        m_format = format;
+        startBlocks();
+    }
+
+    /**
+     * @brief Store the next writes by blocks if the archive is compressed or
+     * has checksums
+     *
+     * The header before them stays raw.
+     */
+    void OBinaryFile::startBlocks()
+    {
+        if (!isBlocked(m_format))
+        {
+            return;
+        }
+        drain();
+        m_blocks = true;
+        m_codec = detail::findCodec(m_format.compression);
+    }
+
+    /**
+     * @brief Write `size` bytes when they do not fit in the internal buffer
+     *
+     * Returns the number of bytes actually written
+     */
+    std::size_t OBinaryFile::writeSlow(const std::byte *data, std::size_t size)
+    {
+        if (m_blocks)
+        {
+            return writeBlocks(data, size);
+        }
+        if (!drain())
+        {
+            return 0;
+        }
+        if (size >= m_buffer.size())
+        {
+            return fwrite(data, sizeof(std::byte), size, m_file);
+        }
+        std::memcpy(m_cursor, data, size);
+        m_cursor += size;
+        return size;
+    }
+
+    /**
+     * @brief Write `size` bytes of an archive stored by blocks through the
+     * internal buffer, which is written as a block each time it is full
+     *
+     * Returns the number of bytes actually written
+     */
+    std::size_t OBinaryFile::writeBlocks(const std::byte *data, std::size_t size)
+    {
+        std::size_t done = 0;
+        while (true)
+        {
+            std::size_t count = std::min(static_cast<std::size_t>(m_limit - m_cursor), size - done);
+            if (count > 0)
+            {
+                std::memcpy(m_cursor, data + done, count);
+                m_cursor += count;
+                done += count;
+            }
+            if (done == size || !drain())
+            {
+                return done;
+            }
+        }
+    }
+
+    /**
+     * @brief Reserve `size` bytes when they do not fit in the internal buffer
+     *
+     * Returns `nullptr` if they are larger than the buffer.
+     */
+    std::byte *OBinaryFile::reserveSlow(std::size_t size)
+    {
+        if (size > m_buffer.size() || !drain())
+        {
+            return nullptr;
+        }
+        std::byte *data = m_cursor;
+        m_cursor += size;
+        return data;
+    }
+
+    /**
+     * @brief Write the content of the internal buffer to the file
+     *
+     * The buffer of an archive stored by blocks is written as a block, raw if
+     * it is not compressed or does not shrink, or handed to the workers when
+     * there are several threads. Returns false if the buffer could not be
+     * entirely written
+     */
+    bool OBinaryFile::drain()
+    {
+        if (m_file == nullptr){return false;}
+        std::size_t used = m_cursor - m_buffer.data();
+        if (used == 0){return true;}
+        m_cursor = m_buffer.data();
+        if (!m_blocks)
+        {
+            return fwrite(m_buffer.data(), sizeof(std::byte), used, m_file) == used;
+        }
+        if (m_threads > 1)
+        {
+            return submitBlock(used);
+        }
+        std::size_t size = packBlock(m_format, m_codec, m_buffer.data(), used, m_packed);
+        countBlock(m_stats, m_packed.data());
+        return fwrite(m_packed.data(), sizeof(std::byte), size, m_file) == size;
+    }
+
+    /**
+     * @brief Hand the `used` bytes of the internal buffer to the workers as
+     * a block, and continue in a fresh buffer
+     *
+     * Returns false if the blocks written meanwhile could not be entirely
+     * written.
+     */
+    bool OBinaryFile::submitBlock(std::size_t used)
+    {
+        if (m_pool == nullptr)
+        {
+            Format format = m_format;
+            const detail::Codec *codec = m_codec;
+            m_pool = std::make_unique<detail::BlockPool>([format, codec](detail::BlockPool::Job &job)
+                                                         { job.out_size = packBlock(format, codec, job.in.data(), job.in_size, job.out); },
+                                                         m_threads);
+        }
+        std::unique_ptr<detail::BlockPool::Job> job = m_pool->acquire();
+        job->in.swap(m_buffer);
+        job->in_size = used;
+        m_buffer.resize(job->in.size());
+        setWindow(m_buffer.data(), m_buffer.size());
+        m_pool->submit(std::move(job));
+        return collect(false);
+    }
+
+    /**
+     * @brief Write the blocks compressed by the workers, in order
+     *
+     * Writes them all if `all` is true, otherwise the ones already compressed
+     * and as many as needed to leave at most two blocks per thread in flight.
+     * Returns false if they could not be entirely written.
+     */
+    bool OBinaryFile::collect(bool all)
+    {
+        if (m_pool == nullptr){return true;}
+        bool ok = true;
+        while (m_pool->pending() > 0 && (all || m_pool->pending() > 2 * m_pool->threads() || m_pool->ready()))
+        {
+            detail::BlockPool::Job &job = m_pool->front();
+            if (job.error == nullptr)
+            {
+                countBlock(m_stats, job.out.data());
+            }
+            ok = job.error == nullptr && fwrite(job.out.data(), sizeof(std::byte), job.out_size, m_file) == job.out_size && ok;
+            m_pool->release();
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Write the content of the internal buffer and the blocks still
+     * compressed by the workers to the file
+     *
+     * Returns false in case of error.
+     */
+    bool OBinaryFile::complete()
+    {
+        bool ok = drain();
+        return collect(true) && ok;
+    }
+
+    /**
+     * @brief Compress the blocks of the archive with `threads` threads
+     *
+     * Throws a `std::runtime_error` if the pending blocks cannot be written.
+     */
+    void OBinaryFile::setThreads(std::size_t threads)
+    {
+        bool ok = collect(true);
+        m_pool.reset();
+        m_threads = std::max<std::size_t>(threads, 1);
+        if (!ok)
+        {
+            throw std::runtime_error("Error while flushing the file!");
+        }
+    }
+
+    /**
+     * @brief Write the content of the internal buffer to the file, followed
+     * by the empty block that ends an archive with checksums
+     *
+     * Returns false in case of error.
+     */
+    bool OBinaryFile::finish()
+    {
+        if (!complete()){return false;}
+        if (!m_blocks || !m_format.checksums){return true;}
+        // Raw, empty, and the checksum of no bytes is 0
+        std::byte end[BlockHeaderSize + ChecksumSize] = {};
+        return fwrite(end, sizeof(std::byte), sizeof(end), m_file) == sizeof(end);
+    }
+
+    /**
+     * @brief Write the content of the internal buffer to the file
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void OBinaryFile::flush()
+    {
+        if (m_file == nullptr)
+        {
+            throw std::runtime_error("Error while flushing a closed file!");
+        }
+        if (!complete() || fflush(m_file) == EOF)
+        {
+            throw std::runtime_error("Error while flushing the file!");
+        }
+    }
+
+    /**
+     * @brief Flushes and closes the file
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void OBinaryFile::close()
+    {
+        if (m_file == nullptr){return;}
+        bool drained = finish();
+        int ret = fclose(m_file);
+        m_file = nullptr;
+        setWindow(nullptr, 0);
+        if (!drained || ret == EOF)
+        {
+            throw std::runtime_error("Error while closing the file!");
+        }
+    }
+
+    /***********************************************************************************
+     *                               MappedOBinaryFile
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Opens and maps the file for writing or throws a `std::runtime_error` in
+     * case of error.
+     */
+    MappedOBinaryFile::MappedOBinaryFile(const std::string &filename, Mode mode, std::size_t capacity)
+    : MappedOBinaryFile(filename, Format(), mode, capacity)
+    {
+    }
+
+    /**
+     * @brief Constructor
+     *
+     * Opens and maps the file for writing with the options `format` or throws
+     * a `std::runtime_error` in case of error.
+     */
+    MappedOBinaryFile::MappedOBinaryFile(const std::string &filename, const Format &format, Mode mode, std::size_t capacity)
+    : m_fd(-1)
+    , m_mapping(nullptr)
+    , m_capacity(0)
+    {
+        checkUnblocked(format);
+        int flags = O_RDWR | O_CREAT | (mode == Mode::Append ? 0 : O_TRUNC);
+        m_fd = ::open(filename.c_str(), flags, 0666);
+        if (m_fd == -1)
+        {
+            throw std::runtime_error("Error while opening the file!");
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) == -1)
+        {
+            ::close(m_fd);
+            throw std::runtime_error("Error while opening the file!");
+        }
+        std::size_t used = static_cast<std::size_t>(st.st_size);
+        if (used > 0)
+        {
+            std::byte header[HeaderSize];
+            ssize_t count = pread(m_fd, header, HeaderSize, 0);
+            try
+            {
+                checkAppendable(format, header, count > 0 ? static_cast<std::size_t>(count) : 0);
+            }
+            catch (...)
+            {
+                ::close(m_fd);
+                throw;
+            }
+        }
+        m_capacity = used + std::max<std::size_t>(capacity, 1);
+        if (!preallocate(m_fd, used, m_capacity))
+        {
+            ::close(m_fd);
+            throw std::runtime_error("Error while allocating the file!");
+        }
+        void *mapping = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            ftruncate(m_fd, used);
+            ::close(m_fd);
+            throw std::runtime_error("Error while mapping the file!");
+        }
+        madvise(mapping, m_capacity, MADV_SEQUENTIAL);
+        m_mapping = static_cast<std::byte *>(mapping);
+        setWindow(m_mapping + used, m_capacity - used);
+        if (used == 0)
+        {
+            writeHeader(format);
+        }
+        else
+        {
+            appendWith(format);
+        }
+    }
+
+    /**
+     * @brief Move constructor
+     */
+    MappedOBinaryFile::MappedOBinaryFile(MappedOBinaryFile &&other) noexcept
+    : OBinaryFile(std::move(other))
+    , m_fd(std::exchange(other.m_fd, -1))
+    , m_mapping(std::exchange(other.m_mapping, nullptr))
+    , m_capacity(std::exchange(other.m_capacity, 0))
+    {
+    }
+
+    /**
+     * @brief Move assignment
+     */
+    MappedOBinaryFile &MappedOBinaryFile::operator=(MappedOBinaryFile &&other) noexcept
+    {
+        OBinaryFile::operator=(std::move(other));
+        std::swap(m_fd, other.m_fd);
+        std::swap(m_mapping, other.m_mapping);
+        std::swap(m_capacity, other.m_capacity);
+        return *this;
+    }
+
+    /**
+     * @brief Truncates and closes the file
+     */
+    MappedOBinaryFile::~MappedOBinaryFile()
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+    }
+
+    /**
+     * @brief Grow the file and the mapping so that `size` more bytes fit
+     *
+     * Returns false in case of error.
+     */
+    bool MappedOBinaryFile::grow(std::size_t size)
+    {
+        if (m_mapping == nullptr){return false;}
+        std::size_t used = cursor() - m_mapping;
+        std::size_t capacity = std::max(2 * m_capacity, used + size);
+        if (!preallocate(m_fd, m_capacity, capacity))
+        {
+            return false;
+        }
+        void *mapping = mremap(m_mapping, m_capacity, capacity, MREMAP_MAYMOVE);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        m_mapping = static_cast<std::byte *>(mapping);
+        m_capacity = capacity;
+        setWindow(m_mapping + used, capacity - used);
+        return true;
+    }
+
+    /**
+     * @brief Grow the file and the mapping when the write does not fit
+     *
+     * Returns the number of bytes actually written
+     */
+    std::size_t MappedOBinaryFile::writeSlow(const std::byte *data, std::size_t size)
+    {
+        std::byte *destination = reserveSlow(size);
+        if (destination == nullptr){return 0;}
+        std::memcpy(destination, data, size);
+        return size;
+    }
+
+    /**
+     * @brief Grow the file and the mapping when the bytes do not fit
+     *
+     * Returns `nullptr` in case of error.
+     */
+    std::byte *MappedOBinaryFile::reserveSlow(std::size_t size)
+    {
+        if (!grow(size)){return nullptr;}
+        return reserve(size);
+    }
+
+    /**
+     * @brief Schedule the write-back of the mapping
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void MappedOBinaryFile::flush()
+    {
+        if (m_mapping == nullptr)
+        {
+            throw std::runtime_error("Error while flushing a closed file!");
+        }
+        if (msync(m_mapping, m_capacity, MS_ASYNC) == -1)
+        {
+            throw std::runtime_error("Error while flushing the file!");
+        }
+    }
+
+    /**
+     * @brief Truncates the file to the bytes written and closes it
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void MappedOBinaryFile::close()
+    {
+        if (m_mapping == nullptr){return;}
+        std::size_t used = cursor() - m_mapping;
+        bool ok = munmap(m_mapping, m_capacity) == 0;
+        ok = ftruncate(m_fd, used) == 0 && ok;
+        ok = ::close(m_fd) == 0 && ok;
+        m_fd = -1;
+        m_mapping = nullptr;
+        m_capacity = 0;
+        setWindow(nullptr, 0);
+        if (!ok)
+        {
+            throw std::runtime_error("Error while closing the file!");
+        }
+    }
 
     /***********************************************************************************
-     *                                  OBinaryFile
+     *                                 OBinaryBuffer
      ***********************************************************************************/
 
     /**
      * @brief Constructor
      *
-     * Opens the file for writing or throws a `std::runtime_error` in case of
-     * error.
+     * Appends the bytes to `buffer`.
      */
-    OBinaryFile::OBinaryFile(const std::string &filename, Mode mode)
+    OBinaryBuffer::OBinaryBuffer(std::vector<std::byte> &buffer, const Format &format)
+    : OBinaryBuffer(buffer, format, true)
     {
-        const char *opening_mode = (mode == Mode::Append ? "a" : "w");
-        m_file = (fopen(filename.c_str(), opening_mode));
-        if (m_file == NULL)
+    }
+
+    /**
+     * @brief Constructor
+     *
+     * Appends the bytes to `buffer`, with a header if `header` is true and
+     * `buffer` is empty.
+     */
+    OBinaryBuffer::OBinaryBuffer(std::vector<std::byte> &buffer, const Format &format, bool header)
+    : m_vector(&buffer)
+    , m_data(nullptr)
+    , m_capacity(0)
+    {
+        checkUnblocked(format);
+        std::size_t used = buffer.size();
+        if (header && used > 0)
         {
-            throw std::runtime_error("Error while opening the file!");
+            checkAppendable(format, buffer.data(), used);
+        }
+        buffer.resize(std::max<std::size_t>(2 * used, 64));
+        m_data = buffer.data();
+        m_capacity = buffer.size();
+        setWindow(m_data + used, m_capacity - used);
+        if (header && used == 0)
+        {
+            writeHeader(format);
         }
+        else
+        {
+            appendWith(format);
+        }
+    }
+
+    /**
+     * @brief Constructor
+     *
+     * Stores the bytes in the `size` bytes pointed by `data`.
+     */
+    OBinaryBuffer::OBinaryBuffer(std::byte *data, std::size_t size, const Format &format)
+    : m_vector(nullptr)
+    , m_data(data)
+    , m_capacity(size)
+    {
+        checkUnblocked(format);
+        setWindow(data, size);
+        writeHeader(format);
     }
 
     /**
      * @brief Move constructor
      */
-    OBinaryFile::OBinaryFile(OBinaryFile &&other) noexcept
-    : m_file(std::exchange(other.m_file, nullptr))
+    OBinaryBuffer::OBinaryBuffer(OBinaryBuffer &&other) noexcept
+    : OBinaryFile(std::move(other))
+    , m_vector(std::exchange(other.m_vector, nullptr))
+    , m_data(std::exchange(other.m_data, nullptr))
+    , m_capacity(std::exchange(other.m_capacity, 0))
     {
     }
 
     /**
      * @brief Move assignment
      */
-    OBinaryFile &OBinaryFile::operator=(OBinaryFile &&other) noexcept
+    OBinaryBuffer &OBinaryBuffer::operator=(OBinaryBuffer &&other) noexcept
     {
-        std::swap(m_file, other.m_file);
+        OBinaryFile::operator=(std::move(other));
+        std::swap(m_vector, other.m_vector);
+        std::swap(m_data, other.m_data);
+        std::swap(m_capacity, other.m_capacity);
         return *this;
     }
 
     /**
-     * @brief Closes the file
+     * @brief Closes the buffer
      */
-    OBinaryFile::~OBinaryFile()
+    OBinaryBuffer::~OBinaryBuffer()
     {
-        if (m_file == nullptr){return;}
-        int ret = fclose(m_file);
-        if (ret == EOF)
+        close();
+    }
+
+    /**
+     * @brief Grow the vector so that `size` more bytes fit
+     *
+     * Returns false for fixed-size buffers.
+     */
+    bool OBinaryBuffer::grow(std::size_t size)
+    {
+        if (m_vector == nullptr){return false;}
+        std::size_t used = cursor() - m_data;
+        m_vector->resize(std::max(2 * m_vector->size(), used + size));
+        m_data = m_vector->data();
+        m_capacity = m_vector->size();
+        setWindow(m_data + used, m_capacity - used);
+        return true;
+    }
+
+    /**
+     * @brief Grow the vector when the write does not fit
+     *
+     * Fixed-size buffers store the bytes that fit. Returns the number of bytes
+     * actually written.
+     */
+    std::size_t OBinaryBuffer::writeSlow(const std::byte *data, std::size_t size)
+    {
+        if (!grow(size))
         {
-            throw std::runtime_error("Error while closing the file!\n");
+            std::size_t used = cursor() - m_data;
+            std::size_t count = m_capacity - used;
+            if (count > 0)
+            {
+                std::memcpy(m_data + used, data, count);
+            }
+            setWindow(m_data + m_capacity, 0);
+            return count;
         }
+        std::memcpy(reserve(size), data, size);
+        return size;
     }
 
     /**
-     * @brief Write `size` bytes pointed by `data` in the file
+     * @brief Grow the vector when the bytes do not fit
      *
-     * Returns the number of bytes actually written
+     * Returns `nullptr` for fixed-size buffers.
+     */
+    std::byte *OBinaryBuffer::reserveSlow(std::size_t size)
+    {
+        if (!grow(size)){return nullptr;}
+        return reserve(size);
+    }
+
+    /**
+     * @brief Shrink the vector to the bytes written
+     */
+    void OBinaryBuffer::flush()
+    {
+        if (m_vector == nullptr){return;}
+        std::size_t used = size();
+        m_vector->resize(used);
+        m_capacity = used;
+        setWindow(m_data + used, 0);
+    }
+
+    /**
+     * @brief Shrink the vector to the bytes written and detach from it
      */
-    std::size_t OBinaryFile::write(const std::byte *data, std::size_t size)
+    void OBinaryBuffer::close()
     {
-        return fwrite(data, sizeof(std::byte), size, m_file);
+        flush();
+        m_vector = nullptr;
+        m_data = nullptr;
+        m_capacity = 0;
+        setWindow(nullptr, 0);
     }
 
     /***********************************************************************************
@@ -70,16 +1094,49 @@ namespace serial
     /**
      * @brief Constructor
      *
-     * Opens the file for writing or throws a `std::runtime_error` in case of
+     * Opens the file for reading or throws a `std::runtime_error` in case of
      * error.
      */
-    IBinaryFile::IBinaryFile(const std::string &filename)
+    IBinaryFile::IBinaryFile(const std::string &filename, std::size_t buffer_size)
     : m_file(fopen(filename.c_str(), "r"))
+    , m_buffer(buffer_size)
+    , m_cursor(m_buffer.data())
+    , m_end(m_buffer.data())
+    , m_read_ahead(buffer_size > 0)
+    , m_blocks(false)
+    , m_ended(false)
+    , m_codec(nullptr)
+    , m_packed_cursor(nullptr)
+    , m_packed_end(nullptr)
+    , m_threads(1)
     {
         if (m_file == NULL)
         {
             throw std::runtime_error("Error while opening the file!");
         }
+        if (buffer_size > 0)
+        {
+            // Our own buffer replaces the one of stdio
+            setvbuf(m_file, nullptr, _IONBF, 0);
+        }
+        readHeader();
+    }
+
+    /**
+     * @brief Constructor for readers that are not backed by a `FILE`
+     */
+    IBinaryFile::IBinaryFile() noexcept
+    : m_file(nullptr)
+    , m_cursor(nullptr)
+    , m_end(nullptr)
+    , m_read_ahead(false)
+    , m_blocks(false)
+    , m_ended(false)
+    , m_codec(nullptr)
+    , m_packed_cursor(nullptr)
+    , m_packed_end(nullptr)
+    , m_threads(1)
+    {
     }
 
     /**
@@ -87,6 +1144,19 @@ namespace serial
      */
     IBinaryFile::IBinaryFile(IBinaryFile &&other) noexcept
     : m_file(std::exchange(other.m_file, nullptr))
+    , m_buffer(std::move(other.m_buffer))
+    , m_cursor(std::exchange(other.m_cursor, nullptr))
+    , m_end(std::exchange(other.m_end, nullptr))
+    , m_read_ahead(std::exchange(other.m_read_ahead, false))
+    , m_format(other.m_format)
+    , m_blocks(std::exchange(other.m_blocks, false))
+    , m_ended(std::exchange(other.m_ended, false))
+    , m_codec(std::exchange(other.m_codec, nullptr))
+    , m_block(std::move(other.m_block))
+    , m_packed_cursor(std::exchange(other.m_packed_cursor, nullptr))
+    , m_packed_end(std::exchange(other.m_packed_end, nullptr))
+    , m_threads(std::exchange(other.m_threads, 1))
+    , m_pool(std::move(other.m_pool))
     {
     }
 
@@ -96,6 +1166,19 @@ namespace serial
     IBinaryFile &IBinaryFile::operator=(IBinaryFile &&other) noexcept
     {
         std::swap(m_file, other.m_file);
+        std::swap(m_buffer, other.m_buffer);
+        std::swap(m_cursor, other.m_cursor);
+        std::swap(m_end, other.m_end);
+        std::swap(m_read_ahead, other.m_read_ahead);
+        std::swap(m_format, other.m_format);
+        std::swap(m_blocks, other.m_blocks);
+        std::swap(m_ended, other.m_ended);
+        std::swap(m_codec, other.m_codec);
+        std::swap(m_block, other.m_block);
+        std::swap(m_packed_cursor, other.m_packed_cursor);
+        std::swap(m_packed_end, other.m_packed_end);
+        std::swap(m_threads, other.m_threads);
+        std::swap(m_pool, other.m_pool);
         return *this;
     }
 
@@ -105,280 +1188,776 @@ namespace serial
     IBinaryFile::~IBinaryFile()
     {
         if (m_file == nullptr){return;}
-        int ret = fclose(m_file);
-        if (ret == EOF)
+        fclose(m_file);
+    }
+
+    /**
+     * @brief Read the options of the archive from its header, if any
+     *
+     * Throws a `std::runtime_error` if the header has unknown options.
+     */
+    void IBinaryFile::readHeader()
+    {
+        const std::byte *header = peek(HeaderSize);
+        if (header == nullptr || std::memcmp(header, HeaderMagic, sizeof(HeaderMagic)) != 0)
+        {
+            return;
+        }
+        m_format = formatFromFlags(detail::loadBigEndian<uint32_t>(header + sizeof(HeaderMagic)));
+        skip(HeaderSize);
+        if (isBlocked(m_format))
         {
-            throw std::runtime_error("Error while closing the file!\n");
+            // The bytes after the header are blocks, the window now serves
+            // their decompressed content
+            m_blocks = true;
+            m_codec = detail::findCodec(m_format.compression);
+            m_packed_cursor = m_cursor;
+            m_packed_end = m_end;
+            m_block.resize(DefaultBufferSize);
+            m_cursor = m_end = m_block.data();
         }
     }
 
     /**
-     * @brief Read `size` bytes from the file and store them in the buffer
-     * pointed by `data`.
+     * @brief Read an archive without header written with the options
+     * `format`, which do not store it by blocks
+     */
+    void IBinaryFile::readWith(const Format &format)
+    {
+        checkUnblocked(format);
+        m_format = format;
+    }
+
+    /**
+     * @brief Read `size` bytes when they are not all buffered
      *
      * Returns the number of bytes actually read.
      */
-    std::size_t IBinaryFile::read(std::byte *data, std::size_t size)
+    std::size_t IBinaryFile::readSlow(std::byte *data, std::size_t size)
     {
-        return fread(data, sizeof(std::byte), size, m_file);
+        if (m_blocks)
+        {
+            return readBlocks(data, size);
+        }
+        std::size_t available = m_end - m_cursor;
+        if (available > 0)
+        {
+            std::memcpy(data, m_cursor, available);
+        }
+        m_cursor = m_end;
+        if (m_file == nullptr){return available;}
+        m_cursor = m_end = m_buffer.data();
+        std::size_t missing = size - available;
+        if (missing >= m_buffer.size() || !m_read_ahead)
+        {
+            return available + fread(data + available, sizeof(std::byte), missing, m_file);
+        }
+        m_end += fread(m_buffer.data(), sizeof(std::byte), m_buffer.size(), m_file);
+        std::size_t copied = std::min(missing, static_cast<std::size_t>(m_end - m_cursor));
+        std::memcpy(data + available, m_cursor, copied);
+        m_cursor += copied;
+        return available + copied;
     }
 
-    /***********************************************************************************
-     *                            Serialization operators
-     ***********************************************************************************/
-
-    OBinaryFile &operator<<(OBinaryFile &file, uint8_t x)
+    /**
+     * @brief Refill the window until at least `size` bytes are available
+     *
+     * Returns false if the end of the file is reached before.
+     */
+    bool IBinaryFile::fill(std::size_t size)
     {
-        std::byte b = std::byte(x);
-        file.write(&b, 1);
-        return file;
+        if (m_blocks)
+        {
+            return fillBlocks(size);
+        }
+        return readAhead(m_cursor, m_end, size);
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, int8_t x)
+    /**
+     * @brief Refill the buffer holding the bytes from `cursor` to `end` until
+     * at least `size` bytes are available, and no more without read-ahead
+     *
+     * Returns false if the end of the file is reached before.
+     */
+    bool IBinaryFile::readAhead(const std::byte *&cursor, const std::byte *&end, std::size_t size)
     {
-        std::byte b = std::byte(x);
-        file.write(&b, 1);
-        return file;
+        if (m_file == nullptr){return false;}
+        std::size_t available = end - cursor;
+        if (m_buffer.size() < size)
+        {
+            std::vector<std::byte> buffer(size);
+            if (available > 0)
+            {
+                std::memcpy(buffer.data(), cursor, available);
+            }
+            m_buffer.swap(buffer);
+        }
+        else if (available > 0)
+        {
+            std::memmove(m_buffer.data(), cursor, available);
+        }
+        cursor = m_buffer.data();
+        end = cursor + available;
+        std::byte *last = m_buffer.data() + available;
+        std::size_t wanted = m_read_ahead ? m_buffer.size() : size;
+        while (available < size)
+        {
+            std::size_t count = fread(last, sizeof(std::byte), wanted - available, m_file);
+            if (count == 0){break;}
+            available += count;
+            last += count;
+        }
+        end = last;
+        return available >= size;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, uint16_t x)
+    /**
+     * @brief Parse the header of the next block of an archive stored by
+     * blocks and peek the whole block
+     *
+     * Returns the size of the block once decompressed, 0 at the end of the
+     * archive or if the block is truncated. Throws a `std::runtime_error` if
+     * the header is corrupted, or if the archive has checksums and is
+     * truncated.
+     */
+    std::size_t IBinaryFile::openBlock()
     {
-        std::byte b[2];
-        // Big endian serialization
-        b[0] = static_cast<std::byte>(x >> 8);
-        b[1] = static_cast<std::byte>(x);
-        file.write(b, 2);
-        return file;
+        std::size_t header_size = blockHeaderSize(m_format);
+        while (true)
+        {
+            if (header_size > static_cast<std::size_t>(m_packed_end - m_packed_cursor) &&
+                !readAhead(m_packed_cursor, m_packed_end, header_size))
+            {
+                if (m_format.checksums && (!m_ended || m_packed_cursor != m_packed_end))
+                {
+                    throw std::runtime_error("Error while reading a truncated archive!");
+                }
+                return 0;
+            }
+            const std::byte *header = m_packed_cursor;
+            Compression method = static_cast<Compression>(header[0]);
+            std::size_t size = detail::loadBigEndian<uint32_t>(header + 1);
+            std::size_t stored = detail::loadBigEndian<uint32_t>(header + 5);
+            const detail::Codec *codec = detail::findCodec(method);
+            bool valid = method == Compression::None ? stored == size : codec != nullptr && stored <= codec->bound(size);
+            if (!valid || size > MaxBlockSize)
+            {
+                throw std::runtime_error("Error while reading a compressed block!");
+            }
+            if (header_size + stored > static_cast<std::size_t>(m_packed_end - m_packed_cursor) &&
+                !readAhead(m_packed_cursor, m_packed_end, header_size + stored))
+            {
+                if (m_format.checksums)
+                {
+                    throw std::runtime_error("Error while reading a truncated archive!");
+                }
+                m_packed_cursor = m_packed_end;
+                return 0;
+            }
+            // Only the empty block written when the archive is closed ends
+            // it, more blocks follow when it was appended to
+            m_ended = size == 0;
+            if (size > 0)
+            {
+                return size;
+            }
+            m_packed_cursor += header_size + stored;
+        }
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, int16_t x)
+    /**
+     * @brief Decompress the `size` bytes of the block just opened in the
+     * buffer pointed by `data`
+     *
+     * Blocks are checked here, when they are first read from, rather than
+     * when the archive is opened. Throws a `std::runtime_error` if the block
+     * is corrupted.
+     */
+    void IBinaryFile::decodeBlock(std::byte *data, std::size_t size)
     {
-        std::byte b[2];
-        // Big endian serialization
-        b[0] = static_cast<std::byte>(x >> 8);
-        b[1] = static_cast<std::byte>(x);
-        file.write(b, 2);
-        return file;
+        const std::byte *header = m_packed_cursor;
+        m_packed_cursor += blockHeaderSize(m_format) + detail::loadBigEndian<uint32_t>(header + 5);
+        unpackBlock(m_format, header, data, size);
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, uint32_t x)
+    /**
+     * @brief Hand the next blocks to the workers until two blocks per thread
+     * are in flight
+     *
+     * The blocks are copied, the read-ahead buffer being refilled in place.
+     * An error on a block header is kept in a job and thrown when it is
+     * reached.
+     */
+    void IBinaryFile::prefetch()
     {
-        std::byte b[4];
-        // Big endian serialization
-        for (int i = 0; i < 4; ++i)
+        while (m_pool->pending() < 2 * m_pool->threads())
         {
-            b[i] = static_cast<std::byte>(x >> ((3 - i) * 8));
+            std::unique_ptr<detail::BlockPool::Job> job = m_pool->acquire();
+            try
+            {
+                std::size_t size = openBlock();
+                if (size == 0){return;}
+                std::size_t length = blockHeaderSize(m_format) + detail::loadBigEndian<uint32_t>(m_packed_cursor + 5);
+                job->in.assign(m_packed_cursor, m_packed_cursor + length);
+                job->in_size = length;
+                job->out_size = size;
+                m_packed_cursor += length;
+            }
+            catch (...)
+            {
+                job->error = std::current_exception();
+                m_pool->submit(std::move(job));
+                return;
+            }
+            m_pool->submit(std::move(job));
         }
-        file.write(b, 4);
-        return file;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, int32_t x)
+    /**
+     * @brief Size of the next block once decompressed, decompressed ahead by
+     * the workers when there are several threads
+     *
+     * Returns 0 at the end of the archive. Throws a `std::runtime_error` if
+     * the block is corrupted.
+     */
+    std::size_t IBinaryFile::nextBlock()
     {
-        std::byte b[4];
-        // Big endian serialization
-        for (int i = 0; i < 4; ++i)
+        if (m_threads > 1)
+        {
+            if (m_pool == nullptr)
+            {
+                Format format = m_format;
+                m_pool = std::make_unique<detail::BlockPool>([format](detail::BlockPool::Job &job)
+                                                             {
+                                                                 if (job.out.size() < job.out_size)
+                                                                 {
+                                                                     job.out.resize(job.out_size);
+                                                                 }
+                                                                 unpackBlock(format, job.in.data(), job.out.data(), job.out_size);
+                                                             },
+                                                             m_threads);
+            }
+            prefetch();
+        }
+        if (m_pool == nullptr || m_pool->pending() == 0)
+        {
+            return m_threads > 1 ? 0 : openBlock();
+        }
+        detail::BlockPool::Job &job = m_pool->front();
+        if (job.error != nullptr)
         {
-            b[i] = static_cast<std::byte>(x >> ((3 - i) * 8));
+            std::exception_ptr error = job.error;
+            m_pool->release();
+            std::rethrow_exception(error);
         }
-        file.write(b, 4);
-        return file;
+        return job.out_size;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, uint64_t x)
+    /**
+     * @brief Store the `size` bytes of the block returned by `nextBlock()` in
+     * the buffer pointed by `data`
+     */
+    void IBinaryFile::takeBlock(std::byte *data, std::size_t size)
     {
-        std::byte b[8];
-        // Big endian serialization
-        for (int i = 0; i < 8; ++i)
+        if (m_pool == nullptr || m_pool->pending() == 0)
         {
-            b[i] = static_cast<std::byte>(x >> ((7 - i) * 8));
+            decodeBlock(data, size);
+            return;
         }
-        file.write(b, 8);
-        return file;
+        std::memcpy(data, m_pool->front().out.data(), size);
+        m_pool->release();
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, int64_t x)
+    /**
+     * @brief Decompress the blocks of the archive with `threads` threads
+     *
+     * The blocks already in flight are kept.
+     */
+    void IBinaryFile::setThreads(std::size_t threads)
     {
-        std::byte b[8];
-        // Big endian serialization
-        for (int i = 0; i < 8; ++i)
+        m_threads = std::max<std::size_t>(threads, 1);
+        if (m_pool == nullptr){return;}
+        if (m_threads > 1)
         {
-            b[i] = static_cast<std::byte>(x >> ((7 - i) * 8));
+            m_pool->resize(m_threads);
+        }
+        else if (m_pool->pending() == 0)
+        {
+            m_pool.reset();
         }
-        file.write(b, 8);
-        return file;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, char x)
+    /**
+     * @brief Decompress blocks after the bytes left in the window until at
+     * least `size` bytes are available
+     *
+     * Returns false if the end of the archive is reached before.
+     */
+    bool IBinaryFile::fillBlocks(std::size_t size)
     {
-        std::byte b = std::byte(x);
-        file.write(&b, 1);
-        return file;
+        std::size_t available = m_end - m_cursor;
+        if (available > 0 && m_cursor != m_block.data())
+        {
+            std::memmove(m_block.data(), m_cursor, available);
+        }
+        m_cursor = m_block.data();
+        m_end = m_cursor + available;
+        while (available < size)
+        {
+            std::size_t block = nextBlock();
+            if (block == 0){break;}
+            if (m_block.size() < available + block)
+            {
+                m_block.resize(available + block);
+                m_cursor = m_block.data();
+                m_end = m_cursor + available;
+            }
+            takeBlock(m_block.data() + available, block);
+            available += block;
+            m_end = m_cursor + available;
+        }
+        return available >= size;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, float x)
+    /**
+     * @brief Read `size` bytes of an archive stored by blocks when they are
+     * not all in the window
+     *
+     * The blocks that fit are decompressed straight into `data`. Returns the
+     * number of bytes actually read.
+     */
+    std::size_t IBinaryFile::readBlocks(std::byte *data, std::size_t size)
     {
-        std::byte b[4];
-        std::memcpy(b, &x, 4);
-        file.write(b, 4);
-        return file;
+        std::size_t done = m_end - m_cursor;
+        if (done > 0)
+        {
+            std::memcpy(data, m_cursor, done);
+        }
+        m_cursor = m_end;
+        while (done < size)
+        {
+            std::size_t block = nextBlock();
+            if (block == 0){break;}
+            if (block <= size - done)
+            {
+                takeBlock(data + done, block);
+                done += block;
+                continue;
+            }
+            if (m_block.size() < block)
+            {
+                m_block.resize(block);
+            }
+            m_cursor = m_end = m_block.data();
+            takeBlock(m_block.data(), block);
+            std::size_t count = size - done;
+            std::memcpy(data + done, m_block.data(), count);
+            m_cursor = m_block.data() + count;
+            m_end = m_block.data() + block;
+            done = size;
+        }
+        return done;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, double x)
+    /***********************************************************************************
+     *                               MappedIBinaryFile
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Maps the file for reading or throws a `std::runtime_error` in case of
+     * error.
+     */
+    MappedIBinaryFile::MappedIBinaryFile(const std::string &filename)
+    : m_mapping(nullptr)
+    , m_length(0)
     {
-        std::byte b[8];
-        std::memcpy(b, &x, 8);
-        file.write(b, 8);
-        return file;
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            throw std::runtime_error("Error while opening the file!");
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            ::close(fd);
+            throw std::runtime_error("Error while opening the file!");
+        }
+        m_length = static_cast<std::size_t>(st.st_size);
+        if (m_length > 0)
+        {
+            m_mapping = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if (m_mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("Error while mapping the file!");
+        }
+        if (m_mapping != nullptr)
+        {
+            // Only hints, the reads are correct even if they fail
+            madvise(m_mapping, m_length, MADV_SEQUENTIAL);
+            madvise(m_mapping, m_length, MADV_WILLNEED);
+        }
+        setWindow(static_cast<const std::byte *>(m_mapping), m_length);
+        readHeader();
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, bool x)
+    /**
+     * @brief Move constructor
+     */
+    MappedIBinaryFile::MappedIBinaryFile(MappedIBinaryFile &&other) noexcept
+    : IBinaryFile(std::move(other))
+    , m_mapping(std::exchange(other.m_mapping, nullptr))
+    , m_length(std::exchange(other.m_length, 0))
     {
-        std::byte b = std::byte(x);
-        file.write(&b, 1);
-        return file;
     }
 
-    OBinaryFile &operator<<(OBinaryFile &file, const std::string &x)
+    /**
+     * @brief Move assignment
+     */
+    MappedIBinaryFile &MappedIBinaryFile::operator=(MappedIBinaryFile &&other) noexcept
     {
-        file << x.size();
-        for (char letter : x)
-        {
-            file << letter;
-        }
-        return file;
+        IBinaryFile::operator=(std::move(other));
+        std::swap(m_mapping, other.m_mapping);
+        std::swap(m_length, other.m_length);
+        return *this;
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, int8_t &x)
+    /**
+     * @brief Unmaps the file
+     */
+    MappedIBinaryFile::~MappedIBinaryFile()
     {
-        std::byte read{};
-        file.read(&read, 1);
-        x = static_cast<int8_t>(read);
-        return file;
+        if (m_mapping == nullptr){return;}
+        munmap(m_mapping, m_length);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, uint8_t &x)
+    /***********************************************************************************
+     *                                 IBinaryBuffer
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Reads the `size` bytes pointed by `data`.
+     */
+    IBinaryBuffer::IBinaryBuffer(const std::byte *data, std::size_t size)
     {
-        std::byte read{};
-        file.read(&read, 1);
-        x = static_cast<uint8_t>(read);
-        return file;
+        setWindow(data, size);
+        readHeader();
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, int16_t &x)
+    /**
+     * @brief Constructor
+     *
+     * Reads the bytes of `buffer`.
+     */
+    IBinaryBuffer::IBinaryBuffer(const std::vector<std::byte> &buffer)
     {
-        std::byte read[2];
-        file.read(read, 2);
-        // Big endian deserialization
-        x = static_cast<int16_t>(read[0]) << 8 |
-            static_cast<int16_t>(read[1]);
-        return file;
+        setWindow(buffer.data(), buffer.size());
+        readHeader();
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, uint16_t &x)
+    /**
+     * @brief Constructor
+     *
+     * Reads the bytes of `buffer`, written with the options `format` and
+     * without header.
+     */
+    IBinaryBuffer::IBinaryBuffer(const std::vector<std::byte> &buffer, const Format &format)
     {
-        std::byte read[2];
-        file.read(read, 2);
-        // Big endian deserialization
-        x = static_cast<uint16_t>(read[0]) << 8 |
-            static_cast<uint16_t>(read[1]);
-        return file;
+        setWindow(buffer.data(), buffer.size());
+        readWith(format);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, int32_t &x)
+    namespace detail
+    {
+        /**
+         * @brief Writer of a record of a record file, appending to `buffer`
+         * with the options `format` of the file and without header
+         */
+        OBinaryBuffer recordWriter(std::vector<std::byte> &buffer, const Format &format)
+        {
+            return OBinaryBuffer(buffer, format, false);
+        }
+
+        /**
+         * @brief Reader of a record written by `recordWriter()` with the
+         * options `format`, from the bytes of `buffer`
+         */
+        IBinaryBuffer recordReader(const std::vector<std::byte> &buffer, const Format &format)
+        {
+            return IBinaryBuffer(buffer, format);
+        }
+    } // namespace detail
+
+    /***********************************************************************************
+     *                                  ORecordFile
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Opens the file for writing the records with the options `format`
+     * against `dictionary`, or throws a `std::runtime_error` in case of error.
+     */
+    ORecordFile::ORecordFile(const std::string &filename, const Dictionary &dictionary, const Format &format,
+                             bool embed_dictionary)
+    : m_file(filename)
+    , m_dictionary(dictionary)
+    , m_format(format)
+    , m_offset(0)
+    , m_closed(false)
     {
-        std::byte read[4];
-        file.read(read, 4);
-        // Big endian deserialization
-        x = 0;
-        for (int i = 0; i < 4; ++i)
+        checkUnblocked(format);
+        std::byte header[RecordHeaderSize];
+        std::memcpy(header, RecordMagic, sizeof(RecordMagic));
+        std::size_t embedded = embed_dictionary ? dictionary.content().size() : 0;
+        detail::storeBigEndian(header + sizeof(RecordMagic), formatFlags(format));
+        detail::storeBigEndian(header + sizeof(RecordMagic) + 4, dictionary.id());
+        detail::storeBigEndian(header + sizeof(RecordMagic) + 8, static_cast<uint32_t>(embedded));
+        if (m_file.write(header, RecordHeaderSize) != RecordHeaderSize ||
+            m_file.write(dictionary.content().data(), embedded) != embedded)
         {
-            x |= static_cast<int32_t>(read[i]) << ((3 - i) * 8);
+            throw std::runtime_error("Error while writing the file!");
         }
-        return file;
+        m_offset = RecordHeaderSize + embedded;
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, uint32_t &x)
+    /**
+     * @brief Writes the index and closes the file
+     */
+    ORecordFile::~ORecordFile()
     {
-        std::byte read[4];
-        file.read(read, 4);
-        // Big endian deserialization
-        x = 0;
-        for (int i = 0; i < 4; ++i)
+        try
+        {
+            close();
+        }
+        catch (const std::runtime_error &)
         {
-            x |= static_cast<uint32_t>(read[i]) << ((3 - i) * 8);
         }
-        return file;
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, int64_t &x)
+    /**
+     * @brief Write the `size` bytes pointed by `data` as the next record
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void ORecordFile::writeRecord(const std::byte *data, std::size_t size)
     {
-        std::byte read[8];
-        file.read(read, 8);
-        // Big endian deserialization
-        x = 0;
-        for (int i = 0; i < 8; ++i)
+        if (m_closed || size > MaxBlockSize)
+        {
+            throw std::runtime_error("Error while writing a record!");
+        }
+        m_packed.resize(RecordPrefixSize + m_dictionary.bound(size));
+        std::byte *payload = m_packed.data() + RecordPrefixSize;
+        std::size_t stored = m_dictionary.compress(payload, m_packed.size() - RecordPrefixSize, data, size);
+        if (stored == 0 || stored >= size)
+        {
+            stored = size;
+            if (size > 0)
+            {
+                std::memcpy(payload, data, size);
+            }
+        }
+        detail::storeBigEndian(m_packed.data(), static_cast<uint32_t>(size));
+        detail::storeBigEndian(m_packed.data() + 4, static_cast<uint32_t>(stored));
+        std::size_t length = RecordPrefixSize + stored;
+        if (m_file.write(m_packed.data(), length) != length)
         {
-            x |= static_cast<int64_t>(read[i]) << ((7 - i) * 8);
+            throw std::runtime_error("Error while writing a record!");
         }
-        return file;
+        m_offsets.push_back(m_offset);
+        m_offset += length;
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, uint64_t &x)
+    /**
+     * @brief Writes the index and closes the file
+     *
+     * Throws a `std::runtime_error` in case of error.
+     */
+    void ORecordFile::close()
     {
-        std::byte read[8];
-        file.read(read, 8);
-        // Big endian deserialization
-        x = 0;
-        for (int i = 0; i < 8; ++i)
+        if (m_closed){return;}
+        m_closed = true;
+        std::vector<std::byte> index(8 * m_offsets.size() + RecordFooterSize);
+        for (std::size_t i = 0; i < m_offsets.size(); ++i)
+        {
+            detail::storeBigEndian(index.data() + 8 * i, m_offsets[i]);
+        }
+        std::byte *footer = index.data() + 8 * m_offsets.size();
+        detail::storeBigEndian(footer, m_offset);
+        detail::storeBigEndian(footer + 8, static_cast<uint64_t>(m_offsets.size()));
+        bool written = m_file.write(index.data(), index.size()) == index.size();
+        m_file.close();
+        if (!written)
         {
-            x |= static_cast<uint64_t>(read[i]) << ((7 - i) * 8);
+            throw std::runtime_error("Error while closing the file!");
         }
-        return file;
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, char &x)
+    /***********************************************************************************
+     *                                  IRecordFile
+     ***********************************************************************************/
+
+    /**
+     * @brief Constructor
+     *
+     * Maps the file and loads the dictionary embedded in it, or throws a
+     * `std::runtime_error` in case of error.
+     */
+    IRecordFile::IRecordFile(const std::string &filename)
+    : m_mapping(nullptr)
+    , m_length(0)
+    , m_index(nullptr)
+    , m_count(0)
     {
-        std::byte read{};
-        file.read(&read, 1);
-        x = static_cast<char>(read);
-        return file;
+        open(filename, nullptr);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, float &x)
+    /**
+     * @brief Constructor
+     *
+     * Maps the file, whose records were compressed against `dictionary`, or
+     * throws a `std::runtime_error` in case of error.
+     */
+    IRecordFile::IRecordFile(const std::string &filename, const Dictionary &dictionary)
+    : m_mapping(nullptr)
+    , m_length(0)
+    , m_index(nullptr)
+    , m_count(0)
     {
-        std::byte read[4];
-        file.read(read, 4);
-        std::memcpy(&x, read, sizeof(float));
-        return file;
+        open(filename, &dictionary);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, double &x)
+    /**
+     * @brief Unmaps the file
+     */
+    IRecordFile::~IRecordFile()
     {
-        std::byte read[8];
-        file.read(read, 8);
-        std::memcpy(&x, read, sizeof(double));
-        return file;
+        if (m_mapping == nullptr){return;}
+        munmap(m_mapping, m_length);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, bool &x)
+    /**
+     * @brief Map the file and read its header and index, the dictionary
+     * being `dictionary` if it is not `nullptr`, the embedded one otherwise
+     */
+    void IRecordFile::open(const std::string &filename, const Dictionary *dictionary)
     {
-        std::byte read{};
-        file.read(&read, 1);
-        x = static_cast<bool>(read);
-        return file;
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            throw std::runtime_error("Error while opening the file!");
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            ::close(fd);
+            throw std::runtime_error("Error while opening the file!");
+        }
+        m_length = static_cast<std::size_t>(st.st_size);
+        if (m_length > 0)
+        {
+            m_mapping = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (m_mapping == MAP_FAILED)
+        {
+            m_mapping = nullptr;
+            throw std::runtime_error("Error while mapping the file!");
+        }
+        try
+        {
+            const std::byte *data = static_cast<const std::byte *>(m_mapping);
+            if (m_length < RecordHeaderSize + RecordFooterSize ||
+                std::memcmp(data, RecordMagic, sizeof(RecordMagic)) != 0)
+            {
+                throw std::runtime_error("Unsupported archive format!");
+            }
+            m_format = formatFromFlags(detail::loadBigEndian<uint32_t>(data + sizeof(RecordMagic)));
+            checkUnblocked(m_format);
+            uint32_t id = detail::loadBigEndian<uint32_t>(data + sizeof(RecordMagic) + 4);
+            std::size_t embedded = detail::loadBigEndian<uint32_t>(data + sizeof(RecordMagic) + 8);
+            const std::byte *footer = data + m_length - RecordFooterSize;
+            uint64_t index = detail::loadBigEndian<uint64_t>(footer);
+            uint64_t count = detail::loadBigEndian<uint64_t>(footer + 8);
+            std::size_t records = RecordHeaderSize + embedded;
+            if (embedded > Dictionary::MaxCapacity || index < records || index > m_length - RecordFooterSize ||
+                count != (m_length - RecordFooterSize - index) / 8 || (m_length - RecordFooterSize - index) % 8 != 0)
+            {
+                throw std::runtime_error("Error while reading the record index!");
+            }
+            if (dictionary != nullptr)
+            {
+                m_dictionary = *dictionary;
+            }
+            else if (embedded > 0 || id == 0)
+            {
+                m_dictionary = Dictionary(std::vector<std::byte>(data + RecordHeaderSize, data + records));
+            }
+            if (m_dictionary.id() != id)
+            {
+                throw std::runtime_error("Error while loading the dictionary!");
+            }
+            m_index = data + index;
+            m_count = static_cast<std::size_t>(count);
+        }
+        catch (const std::runtime_error &)
+        {
+            if (m_mapping != nullptr)
+            {
+                munmap(m_mapping, m_length);
+            }
+            m_mapping = nullptr;
+            throw;
+        }
+        // Only a hint, the reads are correct even if it fails
+        madvise(m_mapping, m_length, MADV_RANDOM);
     }
 
-    IBinaryFile &operator>>(IBinaryFile &file, std::string &x)
+    /**
+     * @brief Bytes of the record `index`
+     *
+     * Throws a `std::runtime_error` if there is no such record or if it is
+     * corrupted.
+     */
+    const std::vector<std::byte> &IRecordFile::readRecord(std::size_t index)
     {
-        size_t size_string;
-        file >> size_string;
-        for (size_t i = 0; i < size_string; i++)
+        if (index >= m_count)
+        {
+            throw std::runtime_error("Error while reading a record!");
+        }
+        const std::byte *data = static_cast<const std::byte *>(m_mapping);
+        std::size_t end = m_index - data;
+        uint64_t offset = detail::loadBigEndian<uint64_t>(m_index + 8 * index);
+        if (offset > end || end - offset < RecordPrefixSize)
+        {
+            throw std::runtime_error("Error while reading a record!");
+        }
+        const std::byte *prefix = data + offset;
+        std::size_t size = detail::loadBigEndian<uint32_t>(prefix);
+        std::size_t stored = detail::loadBigEndian<uint32_t>(prefix + 4);
+        if (stored > end - offset - RecordPrefixSize || stored > size || size > MaxBlockSize)
+        {
+            throw std::runtime_error("Error while reading a record!");
+        }
+        m_record.resize(size);
+        const std::byte *payload = prefix + RecordPrefixSize;
+        if (stored == size)
+        {
+            if (size > 0)
+            {
+                std::memcpy(m_record.data(), payload, size);
+            }
+        }
+        else if (!m_dictionary.decompress(m_record.data(), size, payload, stored))
         {
-            char c;
-            file >> c;
-            x.push_back(c);
+            throw std::runtime_error("Error while reading a record!");
         }
-        return file;
+        return m_record;
     }
-}
\ No newline at end of file
+}
@@ -1,21 +1,172 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
+#include "BitPack.h"
+#include "ByteSwap.h"
+#include "Codec.h"
+#include "Dictionary.h"
+#include "Gorilla.h"
+#include "Half.h"
+#include "Shuffle.h"
+#include "StreamVByte.h"
+#include "VarInt.h"
+
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 
+#include <algorithm>
 #include <array>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace serial
 {
+	namespace detail
+	{
+		class BlockPool;
+	} // namespace detail
+
+	/**
+	 * @brief Encoding options of an archive
+	 *
+	 * Archives with the default options have no header, which keeps them
+	 * readable by any version of the library. Other options are recorded in a
+	 * header at the beginning of the archive and readers detect it. Writers
+	 * only write the header when they start at the beginning of their output:
+	 * appending to an archive requires the options it was created with.
+	 */
+	struct Format
+	{
+		/**
+		 * @brief The order of the bytes of numbers
+		 */
+		enum ByteOrder : uint8_t
+		{
+			/**
+			 * Integers in big endian, floating point numbers in host order
+			 */
+			BigEndian,
+			/**
+			 * Integers and floating point numbers in little endian
+			 */
+			LittleEndian,
+		};
+
+		ByteOrder byte_order = BigEndian;
+
+		/**
+		 * @brief Store integers of 16 bits and more, including every length
+		 * prefix, as LEB128 varints, signed integers being ZigZag-mapped first
+		 */
+		bool compact_integers = false;
+
+		/**
+		 * @brief Store the integer keys of sets and maps as the first key
+		 * followed by the varint gaps between consecutive keys
+		 */
+		bool delta_keys = false;
+
+		/**
+		 * @brief Store vectors and arrays of 32 and 64-bit integers by blocks
+		 * of 128 values packed on the bits of their differences with the
+		 * minimum of the block
+		 */
+		bool bit_packing = false;
+
+		/**
+		 * @brief Store vectors of strings as their distinct strings followed
+		 * by the varint code of each element in that dictionary
+		 */
+		bool string_dictionary = false;
+
+		/**
+		 * @brief Store vectors and arrays of floating point numbers with the
+		 * XOR codec of Gorilla, which packs slowly changing series in a few
+		 * bits per value
+		 */
+		bool float_xor = false;
+
+		/**
+		 * @brief Store vectors and arrays of floating point numbers with their
+		 * bytes shuffled by weight, by chunks of 16 KiB, which makes them much
+		 * easier to compress
+		 */
+		bool byte_shuffle = false;
+
+		/**
+		 * @brief Compress the archive after its header by blocks of the size
+		 * of the write buffer, each one stored raw when it does not shrink
+		 *
+		 * With `Compression::Auto`, each block is stored raw or compressed
+		 * with a fast or a strong codec depending on the entropy of a sample
+		 * of it, the choice being recorded in its header.
+		 *
+		 * Only `OBinaryFile` writes compressed archives, every reader reads
+		 * them.
+		 */
+		Compression compression = Compression::None;
+
+		/**
+		 * @brief Store the archive after its header by blocks, compressed or
+		 * not, each one with the CRC32C of its content, and end it with an
+		 * empty block
+		 *
+		 * Readers check each block when they first read from it and throw a
+		 * `std::runtime_error` if it is corrupted or if the archive is
+		 * truncated. Only `OBinaryFile` writes archives with checksums.
+		 */
+		bool checksums = false;
+
+		bool operator==(const Format &other) const
+		{
+			return byte_order == other.byte_order && compact_integers == other.compact_integers &&
+				   delta_keys == other.delta_keys && bit_packing == other.bit_packing &&
+				   string_dictionary == other.string_dictionary && float_xor == other.float_xor &&
+				   byte_shuffle == other.byte_shuffle && compression == other.compression &&
+				   checksums == other.checksums;
+		}
+
+		bool operator!=(const Format &other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	/**
+	 * @brief Number of blocks of an archive written so far, by the way they
+	 * are stored
+	 */
+	struct BlockStats
+	{
+		/**
+		 * @brief Blocks stored raw, not compressed, looking incompressible
+		 * or which did not shrink
+		 */
+		std::size_t raw = 0;
+
+		/**
+		 * @brief Blocks compressed with a fast codec, `Lz` or `Lz4`
+		 */
+		std::size_t fast = 0;
+
+		/**
+		 * @brief Blocks compressed with a strong codec, `LzHigh` or `Zstd`
+		 */
+		std::size_t strong = 0;
+	};
+
 	/**
 	 * @brief A file to be written
 	 */
@@ -23,8 +174,23 @@ namespace serial
 	{
 	private:
 		FILE *m_file;
+		std::vector<std::byte> m_buffer;
+		std::byte *m_cursor;
+		std::byte *m_limit;
+		Format m_format;
+		bool m_blocks;
+		const detail::Codec *m_codec;
+		std::vector<std::byte> m_packed;
+		std::size_t m_threads;
+		std::unique_ptr<detail::BlockPool> m_pool;
+		BlockStats m_stats;
 
 	public:
+		/**
+		 * @brief Default capacity of the internal write buffer
+		 */
+		static constexpr std::size_t DefaultBufferSize = 64 * 1024;
+
 		/**
 		 * @brief The mode for opening the file
 		 */
@@ -38,9 +204,23 @@ namespace serial
 		 * @brief Constructor
 		 *
 		 * Opens the file for writing or throws a `std::runtime_error` in case of
-		 * error.
+		 * error. Written bytes are gathered in an internal buffer of
+		 * `buffer_size` bytes, a size of 0 disables buffering. Compressed
+		 * archives and archives with checksums are stored by blocks of the
+		 * size of the buffer, of `DefaultBufferSize` bytes if it is disabled.
+		 */
+		OBinaryFile(const std::string &filename, Mode mode = Truncate,
+					std::size_t buffer_size = DefaultBufferSize);
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Opens the file for writing with the options `format` or throws a
+		 * `std::runtime_error` in case of error, or if the file is appended
+		 * to and holds an archive of other options.
 		 */
-		OBinaryFile(const std::string &filename, Mode mode = Truncate);
+		OBinaryFile(const std::string &filename, const Format &format, Mode mode = Truncate,
+					std::size_t buffer_size = DefaultBufferSize);
 
 		OBinaryFile(const OBinaryFile &) = delete;
 		OBinaryFile(OBinaryFile &&other) noexcept;
@@ -49,16 +229,156 @@ namespace serial
 		OBinaryFile &operator=(OBinaryFile &&other) noexcept;
 
 		/**
-		 * @brief Closes the file
+		 * @brief Flushes and closes the file
+		 *
+		 * Errors are silently ignored, call `close()` to observe them.
 		 */
-		~OBinaryFile();
+		virtual ~OBinaryFile();
 
 		/**
 		 * @brief Write `size` bytes pointed by `data` in the file
 		 *
+		 * Small writes are appended to the internal buffer, writes larger than
+		 * the buffer go straight to the file, or through the buffer by blocks
+		 * when the archive is compressed or has checksums.
+		 *
+		 * Returns the number of bytes actually written
+		 */
+		std::size_t write(const std::byte *data, std::size_t size)
+		{
+			if (size <= static_cast<std::size_t>(m_limit - m_cursor))
+			{
+				std::memcpy(m_cursor, data, size);
+				m_cursor += size;
+				return size;
+			}
+			return writeSlow(data, size);
+		}
+
+		/**
+		 * @brief Encoding options of the file
+		 */
+		const Format &format() const noexcept
+		{
+			return m_format;
+		}
+
+		/**
+		 * @brief Reserve the next `size` bytes of the file
+		 *
+		 * Returns a pointer to the bytes, which the caller must fill before the
+		 * next call to any other member function, or `nullptr` if they cannot
+		 * be reserved.
+		 */
+		std::byte *reserve(std::size_t size)
+		{
+			if (size <= static_cast<std::size_t>(m_limit - m_cursor))
+			{
+				std::byte *data = m_cursor;
+				m_cursor += size;
+				return data;
+			}
+			return reserveSlow(size);
+		}
+
+		/**
+		 * @brief Compress the blocks of the archive with `threads` threads
+		 *
+		 * With more than one thread, each full block is handed to a worker
+		 * and the next writes go to a fresh buffer; at most two blocks per
+		 * thread are in flight and they are written in order. With one
+		 * thread, the default, blocks are compressed in the calling thread.
+		 * Pending blocks are written first, throws a `std::runtime_error` in
+		 * case of error.
+		 */
+		void setThreads(std::size_t threads);
+
+		/**
+		 * @brief Number of blocks written to the file so far, by the way
+		 * they are stored
+		 *
+		 * With `Compression::Auto`, tells how many blocks were found
+		 * incompressible and took each codec. Blocks still in the buffer or
+		 * with the workers are not counted yet.
+		 */
+		const BlockStats &blockStats() const noexcept
+		{
+			return m_stats;
+		}
+
+		/**
+		 * @brief Write the content of the internal buffer to the file
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		virtual void flush();
+
+		/**
+		 * @brief Flushes and closes the file
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		virtual void close();
+
+	protected:
+		/**
+		 * @brief Constructor for writers that are not backed by a `FILE`
+		 *
+		 * Every write goes to `writeSlow()` until `setWindow()` is called.
+		 */
+		OBinaryFile() noexcept;
+
+		/**
+		 * @brief Store the next writes in the `size` bytes pointed by `data`
+		 */
+		void setWindow(std::byte *data, std::size_t size) noexcept
+		{
+			m_cursor = data;
+			m_limit = data + size;
+		}
+
+		/**
+		 * @brief Position of the next byte to be written in the window
+		 */
+		std::byte *cursor() const noexcept
+		{
+			return m_cursor;
+		}
+
+		/**
+		 * @brief Use the options `format` and record them at the current
+		 * position if they are not the default ones
+		 */
+		void writeHeader(const Format &format);
+
+		/**
+		 * @brief Use the options `format` for writes appended to an archive
+		 * written with them, whose header, if any, is already written
+		 */
+		void appendWith(const Format &format);
+
+		/**
+		 * @brief Write `size` bytes when they do not fit in the window
+		 *
 		 * Returns the number of bytes actually written
 		 */
-		std::size_t write(const std::byte *data, std::size_t size);
+		virtual std::size_t writeSlow(const std::byte *data, std::size_t size);
+
+		/**
+		 * @brief Reserve `size` bytes when they do not fit in the window
+		 *
+		 * Returns `nullptr` if they cannot be reserved.
+		 */
+		virtual std::byte *reserveSlow(std::size_t size);
+
+	private:
+		void startBlocks();
+		std::size_t writeBlocks(const std::byte *data, std::size_t size);
+		bool drain();
+		bool submitBlock(std::size_t used);
+		bool collect(bool all);
+		bool complete();
+		bool finish();
 	};
 
 	/**
@@ -68,15 +388,39 @@ namespace serial
 	{
 	private:
 		FILE *m_file;
+		std::vector<std::byte> m_buffer;
+		const std::byte *m_cursor;
+		const std::byte *m_end;
+		bool m_read_ahead;
+		Format m_format;
+		bool m_blocks;
+		bool m_ended;
+		const detail::Codec *m_codec;
+		std::vector<std::byte> m_block;
+		const std::byte *m_packed_cursor;
+		const std::byte *m_packed_end;
+		std::size_t m_threads;
+		std::unique_ptr<detail::BlockPool> m_pool;
 
 	public:
+		/**
+		 * @brief Default capacity of the internal read-ahead buffer
+		 */
+		static constexpr std::size_t DefaultBufferSize = 64 * 1024;
+
 		/**
 		 * @brief Constructor
 		 *
 		 * Opens the file for reading or throws a `std::runtime_error` in case of
-		 * error.
+		 * error. The file is read ahead in chunks of `buffer_size` bytes, a size
+		 * of 0 disables read-ahead: bytes are then read only when they are
+		 * decoded, those looked at by `peek()` being kept until they are
+		 * consumed. The blocks of compressed archives or of
+		 * archives with checksums are decompressed and checked one at a time
+		 * in another buffer.
 		 */
-		IBinaryFile(const std::string &filename);
+		IBinaryFile(const std::string &filename,
+					std::size_t buffer_size = DefaultBufferSize);
 
 		IBinaryFile(const IBinaryFile &) = delete;
 		IBinaryFile(IBinaryFile &&other) noexcept;
@@ -87,7 +431,7 @@ namespace serial
 		/**
 		 * @brief Closes the file
 		 */
-		~IBinaryFile();
+		virtual ~IBinaryFile();
 
 		/**
 		 * @brief Read `size` bytes from the file and store them in the buffer
@@ -95,135 +439,2386 @@ namespace serial
 		 *
 		 * Returns the number of bytes actually read.
 		 */
-		std::size_t read(std::byte *data, std::size_t size);
-	};
-
-	OBinaryFile &operator<<(OBinaryFile &file, uint8_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, int8_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, uint16_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, int16_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, uint32_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, int32_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, uint64_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, int64_t x);
-	OBinaryFile &operator<<(OBinaryFile &file, char x);
-	OBinaryFile &operator<<(OBinaryFile &file, float x);
-	OBinaryFile &operator<<(OBinaryFile &file, double x);
-	OBinaryFile &operator<<(OBinaryFile &file, bool x);
-	OBinaryFile &operator<<(OBinaryFile &file, const std::string &x);
+		std::size_t read(std::byte *data, std::size_t size)
+		{
+			if (size <= static_cast<std::size_t>(m_end - m_cursor))
+			{
+				std::memcpy(data, m_cursor, size);
+				m_cursor += size;
+				return size;
+			}
+			return readSlow(data, size);
+		}
 
-	template <typename T>
-	OBinaryFile &operator<<(OBinaryFile &file, const std::vector<T> &x)
-	{
-		file << x.size();
-		for (auto &element : x)
+		/**
+		 * @brief Encoding options of the file, read from its header
+		 */
+		const Format &format() const noexcept
 		{
-			file << element;
+			return m_format;
 		}
-		return file;
-	}
 
-	template <typename T, std::size_t N>
-	OBinaryFile &operator<<(OBinaryFile &file, const std::array<T, N> &x)
-	{
-		file << N;
-		for (auto &element : x)
+		/**
+		 * @brief Number of bytes that can be read without refilling
+		 */
+		std::size_t remaining() const noexcept
 		{
-			file << element;
+			return m_end - m_cursor;
 		}
-		return file;
-	}
 
-	template <typename K, typename V>
-	OBinaryFile &operator<<(OBinaryFile &file, const std::map<K, V> &x)
-	{
-		file << x.size();
-		for (auto &p : x)
+		/**
+		 * @brief Get a pointer to the next `size` bytes without consuming them
+		 *
+		 * The pointer stays valid until the next call to any other member
+		 * function. Returns `nullptr` if fewer than `size` bytes remain in the
+		 * file.
+		 */
+		const std::byte *peek(std::size_t size)
 		{
-			file << p.first << p.second;
+			return ensure(size) ? m_cursor : nullptr;
 		}
-		return file;
-	}
 
-	template <typename T>
-	OBinaryFile &operator<<(OBinaryFile &file, const std::set<T> &x)
-	{
-		file << x.size();
-		for (T &value : x)
+		/**
+		 * @brief Consume `size` bytes that were just peeked
+		 */
+		void skip(std::size_t size) noexcept
 		{
-			file << value;
+			m_cursor += size;
 		}
-		return file;
-	}
 
-	IBinaryFile &operator>>(IBinaryFile &file, int8_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, uint8_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, int16_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, uint16_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, int32_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, uint32_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, int64_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, uint64_t &x);
-	IBinaryFile &operator>>(IBinaryFile &file, char &x);
-	IBinaryFile &operator>>(IBinaryFile &file, float &x);
-	IBinaryFile &operator>>(IBinaryFile &file, double &x);
-	IBinaryFile &operator>>(IBinaryFile &file, bool &x);
-	IBinaryFile &operator>>(IBinaryFile &file, std::string &x);
+		/**
+		 * @brief Decompress the blocks of the archive with `threads` threads
+		 *
+		 * With more than one thread, the blocks after the one being read are
+		 * decompressed and checked ahead by workers, two per thread, and the
+		 * errors are thrown when the blocks are reached. With one thread, the
+		 * default, each block is decompressed when it is first read from.
+		 */
+		void setThreads(std::size_t threads);
+
+	protected:
+		/**
+		 * @brief Constructor for readers that are not backed by a `FILE`
+		 *
+		 * The reader is empty until `setWindow()` is called.
+		 */
+		IBinaryFile() noexcept;
 
-	template <typename T>
-	IBinaryFile &operator>>(IBinaryFile &file, std::vector<T> &x)
-	{
-		size_t size;
-		file >> size;
-		x.resize(size);
-		for (auto &element : x)
+		/**
+		 * @brief Serve the reads from the `size` bytes pointed by `data`
+		 *
+		 * The bytes must outlive the reader, they are never refilled.
+		 */
+		void setWindow(const std::byte *data, std::size_t size) noexcept
 		{
-			file >> element;
+			m_cursor = data;
+			m_end = data + size;
 		}
-		return file;
-	}
 
-	template <typename T, std::size_t N>
-	IBinaryFile &operator>>(IBinaryFile &file, std::array<T, N> &x)
-	{
-		size_t size;
-		file >> size;
-		for (auto &element : x)
+		/**
+		 * @brief Read the options of the archive from its header, if any
+		 *
+		 * Throws a `std::runtime_error` if the header has unknown options.
+		 * The next reads of an archive stored by blocks are served from its
+		 * decompressed blocks.
+		 */
+		void readHeader();
+
+		/**
+		 * @brief Read an archive without header written with the options
+		 * `format`, which do not store it by blocks
+		 */
+		void readWith(const Format &format);
+
+	private:
+		/**
+		 * @brief Make sure that at least `size` bytes are buffered
+		 *
+		 * Returns false if the end of the file is reached before.
+		 */
+		bool ensure(std::size_t size)
 		{
-			file >> element;
+			return size <= static_cast<std::size_t>(m_end - m_cursor) || fill(size);
 		}
-		return file;
-	}
 
-	template <typename K, typename V>
-	IBinaryFile &operator>>(IBinaryFile &file, std::map<K, V> &x)
+		bool fill(std::size_t size);
+		bool readAhead(const std::byte *&cursor, const std::byte *&end, std::size_t size);
+		std::size_t readSlow(std::byte *data, std::size_t size);
+		std::size_t openBlock();
+		void decodeBlock(std::byte *data, std::size_t size);
+		void prefetch();
+		std::size_t nextBlock();
+		void takeBlock(std::byte *data, std::size_t size);
+		bool fillBlocks(std::size_t size);
+		std::size_t readBlocks(std::byte *data, std::size_t size);
+	};
+
+	/**
+	 * @brief A file to be read through a memory mapping
+	 *
+	 * The whole file is mapped at construction and every read is served
+	 * straight from the mapping, the pages are shared with the other
+	 * processes mapping the same file.
+	 */
+	class MappedIBinaryFile final : public IBinaryFile
 	{
-		size_t size;
-		file >> size;
-		for (size_t i = 0; i < size; ++i)
-		{
-			K key;
-			V value;
-			file >> key >> value;
-			x.emplace(std::move(key), std::move(value));
-		}
-		return file;
-	}
+	private:
+		void *m_mapping;
+		std::size_t m_length;
 
-	template <typename T>
-	IBinaryFile &operator>>(IBinaryFile &file, std::set<T> &x)
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * Maps the file for reading or throws a `std::runtime_error` in case of
+		 * error.
+		 */
+		MappedIBinaryFile(const std::string &filename);
+
+		MappedIBinaryFile(const MappedIBinaryFile &) = delete;
+		MappedIBinaryFile(MappedIBinaryFile &&other) noexcept;
+
+		MappedIBinaryFile &operator=(const MappedIBinaryFile &) = delete;
+		MappedIBinaryFile &operator=(MappedIBinaryFile &&other) noexcept;
+
+		/**
+		 * @brief Unmaps the file
+		 */
+		~MappedIBinaryFile();
+	};
+
+	/**
+	 * @brief A file to be written through a memory mapping
+	 *
+	 * The file space is preallocated and mapped, writes are plain stores in
+	 * the mapping. When it is full, the file and the mapping grow
+	 * geometrically. The file is truncated to the bytes actually written
+	 * when it is closed.
+	 */
+	class MappedOBinaryFile final : public OBinaryFile
 	{
-		size_t size;
-		file >> size;
-		for (size_t i = 0; i < size; ++i)
-		{
-			T value;
-			file >> value;
-			x.insert(std::move(value));
-		}
-		return file;
-	}
+	private:
+		int m_fd;
+		std::byte *m_mapping;
+		std::size_t m_capacity;
+
+	public:
+		/**
+		 * @brief Default number of bytes preallocated at construction
+		 */
+		static constexpr std::size_t DefaultCapacity = 1024 * 1024;
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Opens and maps the file for writing or throws a `std::runtime_error`
+		 * in case of error. `capacity` bytes are preallocated after the
+		 * current end of the file.
+		 */
+		MappedOBinaryFile(const std::string &filename, Mode mode = Truncate,
+						  std::size_t capacity = DefaultCapacity);
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Opens and maps the file for writing with the options `format` or
+		 * throws a `std::runtime_error` in case of error, or if the file is
+		 * appended to and holds an archive of other options.
+		 */
+		MappedOBinaryFile(const std::string &filename, const Format &format, Mode mode = Truncate,
+						  std::size_t capacity = DefaultCapacity);
+
+		MappedOBinaryFile(const MappedOBinaryFile &) = delete;
+		MappedOBinaryFile(MappedOBinaryFile &&other) noexcept;
+
+		MappedOBinaryFile &operator=(const MappedOBinaryFile &) = delete;
+		MappedOBinaryFile &operator=(MappedOBinaryFile &&other) noexcept;
+
+		/**
+		 * @brief Truncates and closes the file
+		 *
+		 * Errors are silently ignored, call `close()` to observe them.
+		 */
+		~MappedOBinaryFile();
+
+		/**
+		 * @brief Schedule the write-back of the mapping
+		 *
+		 * The file has its final size only once closed. Throws a
+		 * `std::runtime_error` in case of error.
+		 */
+		void flush() override;
+
+		/**
+		 * @brief Truncates the file to the bytes written and closes it
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		void close() override;
+
+	protected:
+		std::size_t writeSlow(const std::byte *data, std::size_t size) override;
+		std::byte *reserveSlow(std::size_t size) override;
+
+	private:
+		bool grow(std::size_t size);
+	};
+
+	class OBinaryBuffer;
+	class IBinaryBuffer;
+
+	namespace detail
+	{
+		/**
+		 * @brief Writer of a record of a record file, appending to `buffer`
+		 * with the options `format` of the file and without header
+		 */
+		OBinaryBuffer recordWriter(std::vector<std::byte> &buffer, const Format &format);
+
+		/**
+		 * @brief Reader of a record written by `recordWriter()` with the
+		 * options `format`, from the bytes of `buffer`
+		 */
+		IBinaryBuffer recordReader(const std::vector<std::byte> &buffer, const Format &format);
+	}
+
+	/**
+	 * @brief A memory buffer to be written
+	 *
+	 * The bytes are appended to a growable `std::vector` or stored in a
+	 * caller-supplied fixed-size region of memory.
+	 */
+	class OBinaryBuffer final : public OBinaryFile
+	{
+	private:
+		std::vector<std::byte> *m_vector;
+		std::byte *m_data;
+		std::size_t m_capacity;
+
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * Appends the bytes to `buffer`, which holds exactly the bytes written
+		 * after `flush()`, `close()` or the destruction of the writer. Throws
+		 * a `std::runtime_error` if `buffer` holds an archive of other
+		 * options than `format`.
+		 */
+		OBinaryBuffer(std::vector<std::byte> &buffer, const Format &format = Format());
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Stores the bytes in the `size` bytes pointed by `data`, writes
+		 * beyond them are short.
+		 */
+		OBinaryBuffer(std::byte *data, std::size_t size, const Format &format = Format());
+
+		OBinaryBuffer(const OBinaryBuffer &) = delete;
+		OBinaryBuffer(OBinaryBuffer &&other) noexcept;
+
+		OBinaryBuffer &operator=(const OBinaryBuffer &) = delete;
+		OBinaryBuffer &operator=(OBinaryBuffer &&other) noexcept;
+
+		/**
+		 * @brief Closes the buffer
+		 */
+		~OBinaryBuffer();
+
+		/**
+		 * @brief Number of bytes written in the buffer
+		 */
+		std::size_t size() const noexcept
+		{
+			return cursor() - m_data;
+		}
+
+		/**
+		 * @brief Shrink the vector to the bytes written
+		 */
+		void flush() override;
+
+		/**
+		 * @brief Shrink the vector to the bytes written and detach from it
+		 */
+		void close() override;
+
+	protected:
+		std::size_t writeSlow(const std::byte *data, std::size_t size) override;
+		std::byte *reserveSlow(std::size_t size) override;
+
+	private:
+		friend OBinaryBuffer detail::recordWriter(std::vector<std::byte> &buffer, const Format &format);
+
+		/**
+		 * @brief Constructor of a writer appending to `buffer` with the
+		 * options `format` and without header
+		 */
+		OBinaryBuffer(std::vector<std::byte> &buffer, const Format &format, bool header);
+
+		bool grow(std::size_t size);
+	};
+
+	/**
+	 * @brief A memory buffer to be read
+	 */
+	class IBinaryBuffer final : public IBinaryFile
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * Reads the `size` bytes pointed by `data`, they must outlive the
+		 * reader.
+		 */
+		IBinaryBuffer(const std::byte *data, std::size_t size);
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Reads the bytes of `buffer`, it must outlive the reader and must not
+		 * be modified while it is read.
+		 */
+		IBinaryBuffer(const std::vector<std::byte> &buffer);
+
+	private:
+		friend IBinaryBuffer detail::recordReader(const std::vector<std::byte> &buffer, const Format &format);
+
+		/**
+		 * @brief Constructor of a reader of the bytes of `buffer`, written
+		 * with the options `format` and without header
+		 */
+		IBinaryBuffer(const std::vector<std::byte> &buffer, const Format &format);
+	};
+
+	/**
+	 * @brief A file of small records, each one compressed on its own against
+	 * a dictionary
+	 *
+	 * Each record is serialized with the options `format`, without the
+	 * header of an archive, compressed against the dictionary, stored raw if
+	 * it does not shrink, and appended to the file. `close()` appends the
+	 * index of the records so that `IRecordFile` reads any of them directly.
+	 * The header of the file records the options once and holds the
+	 * dictionary, or only its identifier when it is not embedded, the reader
+	 * then gets it from elsewhere.
+	 */
+	class ORecordFile
+	{
+	private:
+		OBinaryFile m_file;
+		Dictionary m_dictionary;
+		Format m_format;
+		std::vector<uint64_t> m_offsets;
+		uint64_t m_offset;
+		bool m_closed;
+		std::vector<std::byte> m_record;
+		std::vector<std::byte> m_packed;
+
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * Opens the file for writing the records with the options `format`
+		 * against `dictionary`, or throws a `std::runtime_error` in case of
+		 * error. The options cannot compress nor add checksums, the records
+		 * are compressed by the dictionary instead.
+		 */
+		ORecordFile(const std::string &filename, const Dictionary &dictionary, const Format &format = Format(),
+					bool embed_dictionary = true);
+
+		ORecordFile(const ORecordFile &) = delete;
+		ORecordFile &operator=(const ORecordFile &) = delete;
+
+		/**
+		 * @brief Writes the index and closes the file
+		 *
+		 * Errors are silently ignored, call `close()` to observe them.
+		 */
+		~ORecordFile();
+
+		/**
+		 * @brief Serialize `record` and write it as the next record
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		template <typename T>
+		void write(const T &record);
+
+		/**
+		 * @brief Write the `size` bytes pointed by `data` as the next record
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		void writeRecord(const std::byte *data, std::size_t size);
+
+		/**
+		 * @brief Number of records written
+		 */
+		std::size_t size() const noexcept
+		{
+			return m_offsets.size();
+		}
+
+		/**
+		 * @brief Writes the index and closes the file
+		 *
+		 * Throws a `std::runtime_error` in case of error.
+		 */
+		void close();
+	};
+
+	/**
+	 * @brief A file of records written by `ORecordFile`, read in any order
+	 *
+	 * The file is mapped and only its header and index are read at
+	 * construction. Each record is decompressed when it is read.
+	 */
+	class IRecordFile
+	{
+	private:
+		void *m_mapping;
+		std::size_t m_length;
+		Dictionary m_dictionary;
+		Format m_format;
+		const std::byte *m_index;
+		std::size_t m_count;
+		std::vector<std::byte> m_record;
+
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * Maps the file and loads the dictionary embedded in it, or throws a
+		 * `std::runtime_error` in case of error or if the dictionary is not
+		 * embedded.
+		 */
+		IRecordFile(const std::string &filename);
+
+		/**
+		 * @brief Constructor
+		 *
+		 * Maps the file, whose records were compressed against `dictionary`,
+		 * or throws a `std::runtime_error` in case of error or if the file
+		 * names another dictionary.
+		 */
+		IRecordFile(const std::string &filename, const Dictionary &dictionary);
+
+		IRecordFile(const IRecordFile &) = delete;
+		IRecordFile &operator=(const IRecordFile &) = delete;
+
+		/**
+		 * @brief Unmaps the file
+		 */
+		~IRecordFile();
+
+		/**
+		 * @brief Number of records
+		 */
+		std::size_t size() const noexcept
+		{
+			return m_count;
+		}
+
+		/**
+		 * @brief Dictionary the records were compressed against
+		 */
+		const Dictionary &dictionary() const noexcept
+		{
+			return m_dictionary;
+		}
+
+		/**
+		 * @brief Options the records were written with
+		 */
+		const Format &format() const noexcept
+		{
+			return m_format;
+		}
+
+		/**
+		 * @brief Read the record `index` in `record`
+		 *
+		 * Throws a `std::runtime_error` if there is no such record or if it is
+		 * corrupted.
+		 */
+		template <typename T>
+		void read(std::size_t index, T &record);
+
+		/**
+		 * @brief Bytes of the record `index`
+		 *
+		 * They stay valid until the next read. Throws a `std::runtime_error`
+		 * if there is no such record or if it is corrupted.
+		 */
+		const std::vector<std::byte> &readRecord(std::size_t index);
+
+	private:
+		void open(const std::string &filename, const Dictionary *dictionary);
+	};
+
+	/**
+	 * @brief Archive concepts
+	 *
+	 * Every operator is a template over the archive it writes to or reads
+	 * from, so each backend gets fully inlined encoders without any virtual
+	 * call. All the classes above model these concepts, other backends only
+	 * need to provide the same member functions.
+	 *
+	 * A Sink provides:
+	 * - `std::size_t write(const std::byte *data, std::size_t size)`, which
+	 *   writes `size` bytes and returns the number of bytes actually written;
+	 * - `std::byte *reserve(std::size_t size)`, which returns a pointer to the
+	 *   next `size` bytes of the archive that the caller must fill, or
+	 *   `nullptr` if they cannot be reserved (the caller then uses `write()`).
+	 *
+	 * A Source provides:
+	 * - `std::size_t read(std::byte *data, std::size_t size)`, which reads
+	 *   `size` bytes and returns the number of bytes actually read;
+	 * - `std::size_t remaining() const`, the number of bytes that can be read
+	 *   without refilling;
+	 * - `const std::byte *peek(std::size_t size)`, which returns a pointer to
+	 *   the next `size` bytes without consuming them, or `nullptr` if fewer
+	 *   bytes are left;
+	 * - `void skip(std::size_t size)`, which consumes `size` bytes that were
+	 *   just peeked.
+	 *
+	 * Sinks and sources declared outside of the `serial` namespace must bring
+	 * the operators in scope with `using serial::operator<<;` and
+	 * `using serial::operator>>;`.
+	 */
+	template <typename T, typename = void>
+	struct is_sink : std::false_type
+	{
+	};
+
+	template <typename T>
+	struct is_sink<T, std::void_t<
+						  decltype(std::declval<T &>().write(std::declval<const std::byte *>(), std::size_t())),
+						  decltype(std::declval<T &>().reserve(std::size_t()))>>
+		: std::true_type
+	{
+	};
+
+	template <typename T>
+	constexpr bool is_sink_v = is_sink<T>::value;
+
+	template <typename T, typename = void>
+	struct is_source : std::false_type
+	{
+	};
+
+	template <typename T>
+	struct is_source<T, std::void_t<
+							decltype(std::declval<T &>().read(std::declval<std::byte *>(), std::size_t())),
+							decltype(std::declval<const T &>().remaining()),
+							decltype(std::declval<T &>().peek(std::size_t())),
+							decltype(std::declval<T &>().skip(std::size_t()))>>
+		: std::true_type
+	{
+	};
+
+	template <typename T>
+	constexpr bool is_source_v = is_source<T>::value;
+
+	template <typename Sink>
+	using sink_t = std::enable_if_t<is_sink_v<Sink>, Sink &>;
+
+	template <typename Source>
+	using source_t = std::enable_if_t<is_source_v<Source>, Source &>;
+
+	namespace detail
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		constexpr bool HostIsLittleEndian = true;
+#else
+		constexpr bool HostIsLittleEndian = false;
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		constexpr bool HostIsBigEndian = true;
+#else
+		constexpr bool HostIsBigEndian = false;
+#endif
+
+		static_assert(HostIsLittleEndian || HostIsBigEndian, "unsupported host byte order");
+
+		template <typename T, typename = void>
+		struct has_format : std::false_type
+		{
+		};
+
+		template <typename T>
+		struct has_format<T, std::void_t<decltype(std::declval<const T &>().format())>>
+			: std::true_type
+		{
+		};
+
+		/**
+		 * @brief Encoding options of an archive, the default ones if it has
+		 * none
+		 */
+		template <typename Archive>
+		inline Format formatOf(const Archive &file)
+		{
+			if constexpr (has_format<Archive>::value)
+			{
+				return file.format();
+			}
+			else
+			{
+				return Format();
+			}
+		}
+
+		/**
+		 * @brief Store `x` in big endian order in the bytes pointed by `b`
+		 */
+		template <typename T>
+		inline void storeBigEndian(std::byte *b, T x)
+		{
+			using U = std::make_unsigned_t<T>;
+			U u = static_cast<U>(x);
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+			{
+				b[i] = static_cast<std::byte>(u >> ((sizeof(T) - 1 - i) * 8));
+			}
+		}
+
+		/**
+		 * @brief Load a value stored in big endian order in the bytes pointed
+		 * by `b`
+		 */
+		template <typename T>
+		inline T loadBigEndian(const std::byte *b)
+		{
+			using U = std::make_unsigned_t<T>;
+			U u = 0;
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+			{
+				u |= static_cast<U>(static_cast<U>(b[i]) << ((sizeof(T) - 1 - i) * 8));
+			}
+			return static_cast<T>(u);
+		}
+
+		/**
+		 * @brief Store `x` in little endian order in the bytes pointed by `b`
+		 */
+		template <typename T>
+		inline void storeLittleEndian(std::byte *b, T x)
+		{
+			using U = std::make_unsigned_t<T>;
+			U u = static_cast<U>(x);
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+			{
+				b[i] = static_cast<std::byte>(u >> (i * 8));
+			}
+		}
+
+		/**
+		 * @brief Load a value stored in little endian order in the bytes
+		 * pointed by `b`
+		 */
+		template <typename T>
+		inline T loadLittleEndian(const std::byte *b)
+		{
+			using U = std::make_unsigned_t<T>;
+			U u = 0;
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+			{
+				u |= static_cast<U>(static_cast<U>(b[i]) << (i * 8));
+			}
+			return static_cast<T>(u);
+		}
+
+		/**
+		 * @brief Whether the integers of type `T` are stored as varints
+		 */
+		template <typename T>
+		inline bool isCompact(const Format &format)
+		{
+			if constexpr (std::is_integral_v<T> && sizeof(T) > 1)
+			{
+				return format.compact_integers;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		template <typename Sink>
+		inline Sink &writeVarint(Sink &file, uint64_t x)
+		{
+			std::byte b[MaxVarintSize];
+			file.write(b, encodeVarint(b, x));
+			return file;
+		}
+
+		/**
+		 * @brief Write an integer as a varint, ZigZag-mapped if it is signed
+		 */
+		template <typename Sink, typename T>
+		inline Sink &writeCompact(Sink &file, T x)
+		{
+			if constexpr (std::is_signed_v<T>)
+			{
+				return writeVarint(file, zigzagEncode(x));
+			}
+			else
+			{
+				return writeVarint(file, x);
+			}
+		}
+
+		/**
+		 * @brief Read a varint one byte at a time, near the end of the window
+		 */
+		template <typename Source>
+		uint64_t readVarintSlow(Source &file)
+		{
+			uint64_t x = 0;
+			for (unsigned shift = 0; shift < 64; shift += 7)
+			{
+				std::byte b{};
+				if (file.read(&b, 1) != 1)
+				{
+					break;
+				}
+				x |= static_cast<uint64_t>(b & std::byte(0x7F)) << shift;
+				if ((b & std::byte(0x80)) == std::byte(0))
+				{
+					break;
+				}
+			}
+			return x;
+		}
+
+		template <typename Source>
+		inline uint64_t readVarint(Source &file)
+		{
+			if (file.remaining() >= MaxVarintSize)
+			{
+				uint64_t x;
+				file.skip(decodeVarint(file.peek(MaxVarintSize), x));
+				return x;
+			}
+			return readVarintSlow(file);
+		}
+
+		/**
+		 * @brief Read an integer stored as a varint, ZigZag-mapped if it is
+		 * signed
+		 */
+		template <typename T, typename Source>
+		inline T readCompact(Source &file)
+		{
+			if constexpr (std::is_signed_v<T>)
+			{
+				return static_cast<T>(zigzagDecode(readVarint(file)));
+			}
+			else
+			{
+				return static_cast<T>(readVarint(file));
+			}
+		}
+
+		/**
+		 * @brief Key types of sets and maps that can be delta-encoded
+		 */
+		template <typename T>
+		constexpr bool is_delta_key_v = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+		/**
+		 * @brief Write the gap between the key `key` and the previous key
+		 * `previous` of a sorted container
+		 */
+		template <typename Sink, typename T>
+		inline Sink &writeGap(Sink &file, T previous, T key)
+		{
+			using U = std::make_unsigned_t<T>;
+			return writeVarint(file, static_cast<U>(static_cast<U>(key) - static_cast<U>(previous)));
+		}
+
+		/**
+		 * @brief Read the key following the key `previous` of a sorted
+		 * container
+		 */
+		template <typename T, typename Source>
+		inline T readGap(Source &file, T previous)
+		{
+			using U = std::make_unsigned_t<T>;
+			return static_cast<T>(static_cast<U>(static_cast<U>(previous) + static_cast<U>(readVarint(file))));
+		}
+
+		template <typename Sink, typename T>
+		inline Sink &writeInteger(Sink &file, T x)
+		{
+			if (isCompact<T>(formatOf(file)))
+			{
+				return writeCompact(file, x);
+			}
+			std::byte b[sizeof(T)];
+			if (formatOf(file).byte_order == Format::LittleEndian)
+			{
+				storeLittleEndian(b, x);
+			}
+			else
+			{
+				// Big endian serialization
+				storeBigEndian(b, x);
+			}
+			file.write(b, sizeof(T));
+			return file;
+		}
+
+		template <typename Source, typename T>
+		inline Source &readInteger(Source &file, T &x)
+		{
+			if (isCompact<T>(formatOf(file)))
+			{
+				x = readCompact<T>(file);
+				return file;
+			}
+			std::byte read[sizeof(T)] = {};
+			file.read(read, sizeof(T));
+			if (formatOf(file).byte_order == Format::LittleEndian)
+			{
+				x = loadLittleEndian<T>(read);
+			}
+			else
+			{
+				// Big endian deserialization
+				x = loadBigEndian<T>(read);
+			}
+			return file;
+		}
+
+		template <typename Sink, typename T>
+		inline Sink &writeByte(Sink &file, T x)
+		{
+			std::byte b = static_cast<std::byte>(x);
+			file.write(&b, 1);
+			return file;
+		}
+
+		template <typename Source>
+		inline std::byte readByte(Source &file)
+		{
+			std::byte read{};
+			file.read(&read, 1);
+			return read;
+		}
+
+		template <typename Sink, typename T>
+		inline Sink &writeFloat(Sink &file, T x)
+		{
+			std::byte b[sizeof(T)];
+			std::memcpy(b, &x, sizeof(T));
+			if (HostIsBigEndian && formatOf(file).byte_order == Format::LittleEndian)
+			{
+				std::reverse(b, b + sizeof(T));
+			}
+			file.write(b, sizeof(T));
+			return file;
+		}
+
+		template <typename Source, typename T>
+		inline Source &readFloat(Source &file, T &x)
+		{
+			std::byte read[sizeof(T)] = {};
+			file.read(read, sizeof(T));
+			if (HostIsBigEndian && formatOf(file).byte_order == Format::LittleEndian)
+			{
+				std::reverse(read, read + sizeof(T));
+			}
+			std::memcpy(&x, read, sizeof(T));
+			return file;
+		}
+
+		/**
+		 * @brief Element types whose arrays are encoded in a single pass
+		 */
+		template <typename T>
+		constexpr bool is_bulk_v =
+			std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t> || std::is_same_v<T, char> ||
+			std::is_same_v<T, uint16_t> || std::is_same_v<T, int16_t> ||
+			std::is_same_v<T, uint32_t> || std::is_same_v<T, int32_t> ||
+			std::is_same_v<T, uint64_t> || std::is_same_v<T, int64_t> ||
+			std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+		/**
+		 * @brief Whether the values of type `T` are stored in the archive with
+		 * their bytes in reverse order
+		 */
+		template <typename T>
+		inline bool isSwapped(const Format &format)
+		{
+			if constexpr (sizeof(T) == 1)
+			{
+				return false;
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				return HostIsBigEndian && format.byte_order == Format::LittleEndian;
+			}
+			else
+			{
+				return HostIsLittleEndian == (format.byte_order == Format::BigEndian);
+			}
+		}
+
+		/**
+		 * @brief Number of bytes encoded at once by the bulk encoders
+		 */
+		constexpr std::size_t BulkChunkSize = 16 * 1024;
+
+		/**
+		 * @brief Whether the arrays of type `T` are bit-packed in an archive
+		 * with the options `format`
+		 */
+		template <typename T>
+		inline bool isPacked(const Format &format)
+		{
+			if constexpr (std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8))
+			{
+				return format.bit_packing;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		/**
+		 * @brief Write the `count` integers of 32 or 64 bits pointed by `data`
+		 * bit-packed
+		 *
+		 * Each block of `BitPackBlock` values is stored as the number of bits
+		 * of its values, its minimum in little endian and the differences of
+		 * its values with the minimum packed on that number of bits. The last
+		 * block, when it is not full, is packed one value after the other.
+		 */
+		template <typename Sink, typename T>
+		void writeBitPacked(Sink &file, const T *data, std::size_t count)
+		{
+			using U = std::make_unsigned_t<T>;
+			const U *values = reinterpret_cast<const U *>(data);
+			std::byte staging[1 + sizeof(U) + bitPackedSize(8 * sizeof(U))];
+			for (std::size_t done = 0; done < count; done += BitPackBlock)
+			{
+				std::size_t n = std::min(BitPackBlock, count - done);
+				T lowest = data[done];
+				for (std::size_t i = 1; i < n; ++i)
+				{
+					lowest = std::min(lowest, data[done + i]);
+				}
+				U min = static_cast<U>(lowest);
+				U bits = 0;
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					bits |= static_cast<U>(values[done + i] - min);
+				}
+				unsigned width = bitWidth(bits);
+				staging[0] = static_cast<std::byte>(width);
+				storeLittleEndian(staging + 1, min);
+				std::byte *packed = staging + 1 + sizeof(U);
+				std::size_t size;
+				if (n == BitPackBlock)
+				{
+					bitPack(packed, values + done, min, width);
+					size = bitPackedSize(width);
+				}
+				else
+				{
+					size = packBits(packed, values + done, n, min, width);
+				}
+				file.write(staging, 1 + sizeof(U) + size);
+			}
+		}
+
+		/**
+		 * @brief Read `count` integers of 32 or 64 bits written by
+		 * `writeBitPacked()` in the array pointed by `data`
+		 *
+		 * Each block is unpacked straight from the window of the archive, or
+		 * from a copy when the archive cannot peek it because it is truncated,
+		 * the missing bytes being read as zeros. Throws a `std::runtime_error`
+		 * if a block has more bits than its values.
+		 */
+		template <typename Source, typename T>
+		void readBitPacked(Source &file, T *data, std::size_t count)
+		{
+			using U = std::make_unsigned_t<T>;
+			U *values = reinterpret_cast<U *>(data);
+			std::byte staging[1 + sizeof(U) + bitPackedSize(8 * sizeof(U))];
+			for (std::size_t done = 0; done < count; done += BitPackBlock)
+			{
+				std::size_t n = std::min(BitPackBlock, count - done);
+				const std::byte *header = file.peek(1 + sizeof(U));
+				bool peeked = header != nullptr;
+				if (peeked)
+				{
+					std::memcpy(staging, header, 1 + sizeof(U));
+				}
+				else
+				{
+					std::memset(staging, 0, 1 + sizeof(U));
+					file.read(staging, 1 + sizeof(U));
+				}
+				unsigned width = static_cast<unsigned>(staging[0]);
+				if (width > 8 * sizeof(U))
+				{
+					throw std::runtime_error("Error while reading bit-packed integers!");
+				}
+				std::size_t size = 1 + sizeof(U) + (n == BitPackBlock ? bitPackedSize(width) : packedBitsSize(n, width));
+				const std::byte *block = peeked ? file.peek(size) : nullptr;
+				if (block != nullptr)
+				{
+					file.skip(size);
+				}
+				else
+				{
+					if (peeked)
+					{
+						file.skip(1 + sizeof(U));
+					}
+					std::memset(staging + 1 + sizeof(U), 0, size - 1 - sizeof(U));
+					file.read(staging + 1 + sizeof(U), size - 1 - sizeof(U));
+					block = staging;
+				}
+				U min = loadLittleEndian<U>(block + 1);
+				if (n == BitPackBlock)
+				{
+					bitUnpack(values + done, block + 1 + sizeof(U), min, width);
+				}
+				else
+				{
+					unpackBits(values + done, block + 1 + sizeof(U), n, min, width);
+				}
+			}
+		}
+
+		/**
+		 * @brief Whether the arrays of type `T` use the XOR codec in an archive
+		 * with the options `format`
+		 */
+		template <typename T>
+		inline bool isXored(const Format &format)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				return format.float_xor;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		/**
+		 * @brief Write the `count` floating point numbers pointed by `data`
+		 * with the XOR codec of Gorilla
+		 *
+		 * The values are encoded by blocks of `GorillaBlock`, each one stored
+		 * as the varint size of its bit stream followed by the bit stream.
+		 */
+		template <typename Sink, typename T>
+		void writeXored(Sink &file, const T *data, std::size_t count)
+		{
+			std::vector<std::byte> staging;
+			for (std::size_t done = 0; done < count; done += GorillaBlock)
+			{
+				std::size_t n = std::min(GorillaBlock, count - done);
+				staging.clear();
+				BitWriter bits(staging);
+				encodeGorilla(bits, data + done, n);
+				bits.flush();
+				writeVarint(file, staging.size());
+				file.write(staging.data(), staging.size());
+			}
+		}
+
+		/**
+		 * @brief Read `count` floating point numbers written by `writeXored()`
+		 * in the array pointed by `data`
+		 *
+		 * Each block is decoded straight from the window of the archive, or
+		 * from a copy when the archive cannot peek it because it is truncated,
+		 * the missing bits being read as zeros. Throws a `std::runtime_error`
+		 * if a block is larger than its values can be.
+		 */
+		template <typename Source, typename T>
+		void readXored(Source &file, T *data, std::size_t count)
+		{
+			std::vector<std::byte> staging;
+			for (std::size_t done = 0; done < count; done += GorillaBlock)
+			{
+				std::size_t n = std::min(GorillaBlock, count - done);
+				std::size_t size = readVarint(file);
+				// At most 13 bits of control per value, and the first one raw
+				if (size > (n + 1) * (sizeof(T) + 2))
+				{
+					throw std::runtime_error("Error while reading XORed floating point numbers!");
+				}
+				const std::byte *block = file.peek(size);
+				if (block != nullptr)
+				{
+					BitReader bits(block, size);
+					decodeGorilla(data + done, bits, n);
+					file.skip(size);
+				}
+				else
+				{
+					staging.resize(size);
+					staging.resize(file.read(staging.data(), size));
+					BitReader bits(staging.data(), staging.size());
+					decodeGorilla(data + done, bits, n);
+				}
+			}
+		}
+
+		/**
+		 * @brief Whether the arrays of type `T` are byte-shuffled in an archive
+		 * with the options `format`
+		 */
+		template <typename T>
+		inline bool isShuffled(const Format &format)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				return format.byte_shuffle;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		/**
+		 * @brief Write the `count` floating point numbers pointed by `data`
+		 * with their bytes shuffled
+		 *
+		 * The values are put in the byte order of the archive, then shuffled
+		 * by chunks of `BulkChunkSize` bytes straight into the archive, or into
+		 * a staging buffer written at once when the archive cannot reserve
+		 * them.
+		 */
+		template <typename Sink, typename T>
+		void writeShuffled(Sink &file, const T *data, std::size_t count)
+		{
+			constexpr std::size_t chunk = BulkChunkSize / sizeof(T);
+			std::byte swapped[BulkChunkSize];
+			std::byte staging[BulkChunkSize];
+			bool swap = isSwapped<T>(formatOf(file));
+			for (std::size_t done = 0; done < count; done += chunk)
+			{
+				std::size_t n = std::min(chunk, count - done);
+				const std::byte *values = reinterpret_cast<const std::byte *>(data + done);
+				if (swap)
+				{
+					byteSwap<sizeof(T)>(swapped, values, n);
+					values = swapped;
+				}
+				std::byte *b = file.reserve(n * sizeof(T));
+				if (b != nullptr)
+				{
+					byteShuffle<sizeof(T)>(b, values, n);
+				}
+				else
+				{
+					byteShuffle<sizeof(T)>(staging, values, n);
+					file.write(staging, n * sizeof(T));
+				}
+			}
+		}
+
+		/**
+		 * @brief Read `count` floating point numbers written by
+		 * `writeShuffled()` in the array pointed by `data`
+		 *
+		 * Each chunk is unshuffled straight from the window of the archive, or
+		 * from a copy when the archive cannot peek it because it is truncated,
+		 * the missing bytes being read as zeros.
+		 */
+		template <typename Source, typename T>
+		void readShuffled(Source &file, T *data, std::size_t count)
+		{
+			constexpr std::size_t chunk = BulkChunkSize / sizeof(T);
+			std::byte staging[BulkChunkSize];
+			for (std::size_t done = 0; done < count; done += chunk)
+			{
+				std::size_t n = std::min(chunk, count - done);
+				std::byte *values = reinterpret_cast<std::byte *>(data + done);
+				const std::byte *block = file.peek(n * sizeof(T));
+				if (block != nullptr)
+				{
+					byteUnshuffle<sizeof(T)>(values, block, n);
+					file.skip(n * sizeof(T));
+				}
+				else
+				{
+					std::size_t size = file.read(staging, n * sizeof(T));
+					std::memset(staging + size, 0, n * sizeof(T) - size);
+					byteUnshuffle<sizeof(T)>(values, staging, n);
+				}
+			}
+			if (isSwapped<T>(formatOf(file)))
+			{
+				std::byte *b = reinterpret_cast<std::byte *>(data);
+				byteSwap<sizeof(T)>(b, b, count);
+			}
+		}
+
+		/**
+		 * @brief Write the `count` integers of 32 or 64 bits pointed by `data`
+		 * with the Stream VByte codec
+		 *
+		 * The values are encoded by blocks of `StreamVByteBlock`, the control
+		 * bytes of a block followed by its data bytes, so that the reader can
+		 * decode a whole block with SIMD shuffles. Signed values are
+		 * ZigZag-mapped first.
+		 */
+		template <typename Sink, typename T>
+		void writeStreamVByte(Sink &file, const T *data, std::size_t count)
+		{
+			using U = std::make_unsigned_t<T>;
+			constexpr std::size_t controls = streamVByteControlSize<U>(StreamVByteBlock);
+			std::byte staging[controls + StreamVByteBlock * sizeof(U)];
+			U mapped[std::is_signed_v<T> ? StreamVByteBlock : 1];
+			for (std::size_t done = 0; done < count; done += StreamVByteBlock)
+			{
+				std::size_t n = std::min(StreamVByteBlock, count - done);
+				const U *values;
+				if constexpr (std::is_signed_v<T>)
+				{
+					for (std::size_t i = 0; i < n; ++i)
+					{
+						mapped[i] = static_cast<U>(zigzagEncode(data[done + i]));
+					}
+					values = mapped;
+				}
+				else
+				{
+					values = data + done;
+				}
+				std::size_t c = streamVByteControlSize<U>(n);
+				std::size_t size = encodeStreamVByte(staging, staging + c, values, n);
+				file.write(staging, c + size);
+			}
+		}
+
+		/**
+		 * @brief Read a block of `count` values written by `writeStreamVByte()`
+		 * when the archive cannot peek it, because it is truncated
+		 *
+		 * The missing bytes are read as zeros.
+		 */
+		template <typename Source, typename U>
+		void readStreamVByteSlow(Source &file, U *values, std::size_t count)
+		{
+			std::size_t c = streamVByteControlSize<U>(count);
+			std::vector<std::byte> block(c + count * sizeof(U));
+			file.read(block.data(), c);
+			std::size_t size = streamVByteDataSize<U>(block.data(), count);
+			file.read(block.data() + c, size);
+			decodeStreamVByte(values, block.data(), block.data() + c, size, count);
+		}
+
+		/**
+		 * @brief Read `count` integers of 32 or 64 bits written by
+		 * `writeStreamVByte()` in the array pointed by `data`
+		 *
+		 * Each block is decoded straight from the window of the archive.
+		 */
+		template <typename Source, typename T>
+		void readStreamVByte(Source &file, T *data, std::size_t count)
+		{
+			using U = std::make_unsigned_t<T>;
+			U *values = reinterpret_cast<U *>(data);
+			for (std::size_t done = 0; done < count; done += StreamVByteBlock)
+			{
+				std::size_t n = std::min(StreamVByteBlock, count - done);
+				std::size_t c = streamVByteControlSize<U>(n);
+				const std::byte *block = file.peek(c);
+				if (block != nullptr)
+				{
+					std::size_t size = streamVByteDataSize<U>(block, n);
+					block = file.peek(c + size);
+					if (block != nullptr)
+					{
+						decodeStreamVByte(values + done, block, block + c, size, n);
+						file.skip(c + size);
+						continue;
+					}
+				}
+				readStreamVByteSlow(file, values + done, n);
+			}
+			if constexpr (std::is_signed_v<T>)
+			{
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					data[i] = static_cast<T>(zigzagDecode(values[i]));
+				}
+			}
+		}
+
+		/**
+		 * @brief Write the `count` values pointed by `data`
+		 *
+		 * Values stored in host order are written at once. The others are
+		 * byte-swapped by chunks straight into the archive, or into a staging
+		 * buffer written at once when the archive cannot reserve them. Integers
+		 * of 32 and 64 bits are bit-packed or use the Stream VByte codec, and
+		 * floating point numbers the XOR codec or the byte shuffle, when the
+		 * archive asks for it.
+		 */
+		template <typename Sink, typename T>
+		void writeBulk(Sink &file, const T *data, std::size_t count)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+			if (isPacked<T>(formatOf(file)))
+			{
+				if constexpr (std::is_integral_v<T> && sizeof(T) >= 4)
+				{
+					writeBitPacked(file, data, count);
+				}
+			}
+			else if (isXored<T>(formatOf(file)))
+			{
+				if constexpr (std::is_floating_point_v<T>)
+				{
+					writeXored(file, data, count);
+				}
+			}
+			else if (isShuffled<T>(formatOf(file)))
+			{
+				if constexpr (std::is_floating_point_v<T>)
+				{
+					writeShuffled(file, data, count);
+				}
+			}
+			else if (isCompact<T>(formatOf(file)))
+			{
+				if constexpr (std::is_integral_v<T> && sizeof(T) >= 4)
+				{
+					writeStreamVByte(file, data, count);
+				}
+				else
+				{
+					for (std::size_t i = 0; i < count; ++i)
+					{
+						writeCompact(file, data[i]);
+					}
+				}
+			}
+			else if (!isSwapped<T>(formatOf(file)))
+			{
+				file.write(reinterpret_cast<const std::byte *>(data), count * sizeof(T));
+			}
+			else if constexpr (sizeof(T) > 1)
+			{
+				constexpr std::size_t chunk = BulkChunkSize / sizeof(T);
+				std::byte staging[BulkChunkSize];
+				for (std::size_t done = 0; done < count; done += chunk)
+				{
+					std::size_t n = std::min(chunk, count - done);
+					const std::byte *values = reinterpret_cast<const std::byte *>(data + done);
+					std::byte *b = file.reserve(n * sizeof(T));
+					if (b != nullptr)
+					{
+						byteSwap<sizeof(T)>(b, values, n);
+					}
+					else
+					{
+						byteSwap<sizeof(T)>(staging, values, n);
+						file.write(staging, n * sizeof(T));
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Read `count` values in the array pointed by `data`
+		 *
+		 * The bytes are read at once in the array and decoded in place, except
+		 * for bit-packed and compact integers and XORed or shuffled floating
+		 * point numbers.
+		 */
+		template <typename Source, typename T>
+		void readBulk(Source &file, T *data, std::size_t count)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+			if (isPacked<T>(formatOf(file)))
+			{
+				if constexpr (std::is_integral_v<T> && sizeof(T) >= 4)
+				{
+					readBitPacked(file, data, count);
+				}
+				return;
+			}
+			if (isXored<T>(formatOf(file)))
+			{
+				if constexpr (std::is_floating_point_v<T>)
+				{
+					readXored(file, data, count);
+				}
+				return;
+			}
+			if (isShuffled<T>(formatOf(file)))
+			{
+				if constexpr (std::is_floating_point_v<T>)
+				{
+					readShuffled(file, data, count);
+				}
+				return;
+			}
+			if (isCompact<T>(formatOf(file)))
+			{
+				if constexpr (std::is_integral_v<T> && sizeof(T) >= 4)
+				{
+					readStreamVByte(file, data, count);
+				}
+				else
+				{
+					for (std::size_t i = 0; i < count; ++i)
+					{
+						data[i] = readCompact<T>(file);
+					}
+				}
+				return;
+			}
+			std::byte *b = reinterpret_cast<std::byte *>(data);
+			file.read(b, count * sizeof(T));
+			if constexpr (sizeof(T) > 1)
+			{
+				if (isSwapped<T>(formatOf(file)))
+				{
+					byteSwap<sizeof(T)>(b, b, count);
+				}
+			}
+		}
+
+		/**
+		 * @brief Gather the 8 bools pointed by `b` in the bits of a byte, the
+		 * first one in the low bit
+		 *
+		 * The bools are loaded as a 64-bit word and a multiplication moves the
+		 * low bit of each of its bytes to the high byte.
+		 */
+		inline uint8_t packFlags(const bool *b)
+		{
+			uint64_t word;
+			std::memcpy(&word, b, 8);
+			if constexpr (HostIsBigEndian)
+			{
+				word = __builtin_bswap64(word);
+			}
+			return static_cast<uint8_t>((word * 0x0102040810204080) >> 56);
+		}
+
+		/**
+		 * @brief Spread the bits of `flags` to the 8 bools pointed by `b`, the
+		 * low bit first
+		 */
+		inline void unpackFlags(bool *b, uint8_t flags)
+		{
+			uint64_t word = (flags * uint64_t(0x0101010101010101)) & 0x8040201008040201;
+			word = ((word + 0x7F7F7F7F7F7F7F7F) >> 7) & 0x0101010101010101;
+			if constexpr (HostIsBigEndian)
+			{
+				word = __builtin_bswap64(word);
+			}
+			std::memcpy(b, &word, 8);
+		}
+
+		/**
+		 * @brief Write the `count` bools pointed by `data` as 8 flags per byte,
+		 * the first one in the low bit
+		 */
+		template <typename Sink>
+		void writeFlags(Sink &file, const bool *data, std::size_t count)
+		{
+			std::byte staging[BulkChunkSize];
+			for (std::size_t done = 0; done < count; done += 8 * BulkChunkSize)
+			{
+				std::size_t n = std::min(8 * BulkChunkSize, count - done);
+				const bool *flags = data + done;
+				std::size_t full = n / 8;
+				for (std::size_t i = 0; i < full; ++i)
+				{
+					staging[i] = static_cast<std::byte>(packFlags(flags + 8 * i));
+				}
+				if (n % 8 != 0)
+				{
+					unsigned last = 0;
+					for (std::size_t i = 8 * full; i < n; ++i)
+					{
+						last |= static_cast<unsigned>(flags[i]) << (i % 8);
+					}
+					staging[full++] = static_cast<std::byte>(last);
+				}
+				file.write(staging, full);
+			}
+		}
+
+		/**
+		 * @brief Read `count` bools written by `writeFlags()` in the array
+		 * pointed by `data`
+		 *
+		 * The missing flags of a truncated archive are read as `false`.
+		 */
+		template <typename Source>
+		void readFlags(Source &file, bool *data, std::size_t count)
+		{
+			std::byte staging[BulkChunkSize];
+			for (std::size_t done = 0; done < count; done += 8 * BulkChunkSize)
+			{
+				std::size_t n = std::min(8 * BulkChunkSize, count - done);
+				std::size_t bytes = (n + 7) / 8;
+				std::size_t read = file.read(staging, bytes);
+				std::memset(staging + read, 0, bytes - read);
+				bool *flags = data + done;
+				std::size_t full = n / 8;
+				for (std::size_t i = 0; i < full; ++i)
+				{
+					unpackFlags(flags + 8 * i, static_cast<uint8_t>(staging[i]));
+				}
+				for (std::size_t i = 8 * full; i < n; ++i)
+				{
+					flags[i] = ((static_cast<unsigned>(staging[full]) >> (i % 8)) & 1) != 0;
+				}
+			}
+		}
+
+		/**
+		 * @brief Write the flags of `x` as `writeFlags()` does
+		 *
+		 * The flags are gathered by 64 in a word, the first one in the low
+		 * bit, which is stored in little endian.
+		 */
+		template <typename Sink>
+		void writeFlags(Sink &file, const std::vector<bool> &x)
+		{
+			std::byte staging[BulkChunkSize];
+			std::vector<bool>::const_iterator it = x.begin();
+			for (std::size_t done = 0; done < x.size(); done += 8 * BulkChunkSize)
+			{
+				std::size_t n = std::min(8 * BulkChunkSize, x.size() - done);
+				for (std::size_t i = 0; i < n; i += 64)
+				{
+					std::size_t m = std::min<std::size_t>(64, n - i);
+					uint64_t word = 0;
+					for (std::size_t j = 0; j < m; ++j, ++it)
+					{
+						word |= static_cast<uint64_t>(*it) << j;
+					}
+					std::byte bytes[8];
+					storeLittleEndian(bytes, word);
+					std::memcpy(staging + i / 8, bytes, (m + 7) / 8);
+				}
+				file.write(staging, (n + 7) / 8);
+			}
+		}
+
+		/**
+		 * @brief Read the `x.size()` flags written by `writeFlags()` in `x`
+		 *
+		 * The flags are spread from 64-bit words. The missing flags of a
+		 * truncated archive are read as `false`.
+		 */
+		template <typename Source>
+		void readFlags(Source &file, std::vector<bool> &x)
+		{
+			std::byte staging[BulkChunkSize];
+			std::vector<bool>::iterator it = x.begin();
+			for (std::size_t done = 0; done < x.size(); done += 8 * BulkChunkSize)
+			{
+				std::size_t n = std::min(8 * BulkChunkSize, x.size() - done);
+				std::size_t bytes = (n + 7) / 8;
+				std::size_t read = file.read(staging, bytes);
+				std::memset(staging + read, 0, bytes - read);
+				for (std::size_t i = 0; i < n; i += 64)
+				{
+					std::size_t m = std::min<std::size_t>(64, n - i);
+					std::byte word_bytes[8] = {};
+					std::memcpy(word_bytes, staging + i / 8, (m + 7) / 8);
+					uint64_t word = loadLittleEndian<uint64_t>(word_bytes);
+					for (std::size_t j = 0; j < m; ++j, ++it)
+					{
+						*it = ((word >> j) & 1) != 0;
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Write the `count` floats pointed by `data` narrowed to 16 bits
+		 * by `narrow`
+		 *
+		 * The values are converted by chunks straight into the archive, or
+		 * into a staging buffer written at once when the archive cannot
+		 * reserve them, then put in the byte order of the archive.
+		 */
+		template <typename Sink>
+		void writeNarrowed(Sink &file, const float *data, std::size_t count,
+						   void (*narrow)(std::byte *, const float *, std::size_t))
+		{
+			constexpr std::size_t chunk = BulkChunkSize / 2;
+			std::byte staging[BulkChunkSize];
+			bool swap = isSwapped<uint16_t>(formatOf(file));
+			for (std::size_t done = 0; done < count; done += chunk)
+			{
+				std::size_t n = std::min(chunk, count - done);
+				std::byte *b = file.reserve(2 * n);
+				std::byte *values = b != nullptr ? b : staging;
+				narrow(values, data + done, n);
+				if (swap)
+				{
+					byteSwap<2>(values, values, n);
+				}
+				if (b == nullptr)
+				{
+					file.write(staging, 2 * n);
+				}
+			}
+		}
+
+		/**
+		 * @brief Read `count` floats written by `writeNarrowed()` widened by
+		 * `widen` in the array pointed by `data`
+		 *
+		 * Chunks in host order are widened straight from the window of the
+		 * archive, the others from a copy, the missing bytes of a truncated
+		 * archive being read as zeros.
+		 */
+		template <typename Source>
+		void readWidened(Source &file, float *data, std::size_t count,
+						 void (*widen)(float *, const std::byte *, std::size_t))
+		{
+			constexpr std::size_t chunk = BulkChunkSize / 2;
+			std::byte staging[BulkChunkSize];
+			bool swap = isSwapped<uint16_t>(formatOf(file));
+			for (std::size_t done = 0; done < count; done += chunk)
+			{
+				std::size_t n = std::min(chunk, count - done);
+				const std::byte *block = swap ? nullptr : file.peek(2 * n);
+				if (block != nullptr)
+				{
+					widen(data + done, block, n);
+					file.skip(2 * n);
+					continue;
+				}
+				std::size_t read = file.read(staging, 2 * n);
+				std::memset(staging + read, 0, 2 * n - read);
+				if (swap)
+				{
+					byteSwap<2>(staging, staging, n);
+				}
+				widen(data + done, staging, n);
+			}
+		}
+	} // namespace detail
+
+	/**
+	 * @brief An integer stored as a LEB128 varint whatever the options of the
+	 * archive, ZigZag-mapped if it is signed
+	 *
+	 * Created with `serial::varint()`: `file << serial::varint(x)` and
+	 * `file >> serial::varint(x)`.
+	 */
+	template <typename T>
+	struct Varint
+	{
+		static_assert(std::is_integral_v<T>, "varints store integers");
+		T &value;
+	};
+
+	template <typename T>
+	Varint<T> varint(T &value)
+	{
+		return {value};
+	}
+
+	template <typename T>
+	Varint<const T> varint(const T &value)
+	{
+		return {value};
+	}
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, Varint<T> x)
+	{
+		return detail::writeCompact(file, x.value);
+	}
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, Varint<T> x)
+	{
+		static_assert(!std::is_const_v<T>, "cannot read into a constant");
+		x.value = detail::readCompact<T>(file);
+		return file;
+	}
+
+	/**
+	 * @brief A vector of floats stored as IEEE half-precision numbers, which
+	 * keep 11 significant bits up to 65504, whatever the options of the
+	 * archive
+	 *
+	 * Created with `serial::half()`: `file << serial::half(x)` and
+	 * `file >> serial::half(x)`. Larger values are stored as infinities.
+	 */
+	template <typename T>
+	struct Half
+	{
+		static_assert(std::is_same_v<std::remove_const_t<T>, std::vector<float>>, "halves store vectors of floats");
+		T &value;
+	};
+
+	inline Half<std::vector<float>> half(std::vector<float> &value)
+	{
+		return {value};
+	}
+
+	inline Half<const std::vector<float>> half(const std::vector<float> &value)
+	{
+		return {value};
+	}
+
+	/**
+	 * @brief A vector of floats stored as bfloat16 numbers, which keep the
+	 * range of floats but only 8 significant bits, whatever the options of
+	 * the archive
+	 *
+	 * Created with `serial::bfloat16()`: `file << serial::bfloat16(x)` and
+	 * `file >> serial::bfloat16(x)`.
+	 */
+	template <typename T>
+	struct BFloat16
+	{
+		static_assert(std::is_same_v<std::remove_const_t<T>, std::vector<float>>, "bfloat16s store vectors of floats");
+		T &value;
+	};
+
+	inline BFloat16<std::vector<float>> bfloat16(std::vector<float> &value)
+	{
+		return {value};
+	}
+
+	inline BFloat16<const std::vector<float>> bfloat16(const std::vector<float> &value)
+	{
+		return {value};
+	}
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, Half<T> x)
+	{
+		file << x.value.size();
+		detail::writeNarrowed(file, x.value.data(), x.value.size(), detail::halfKernels().toHalf);
+		return file;
+	}
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, Half<T> x)
+	{
+		static_assert(!std::is_const_v<T>, "cannot read into a constant");
+		size_t size;
+		file >> size;
+		x.value.resize(size);
+		detail::readWidened(file, x.value.data(), size, detail::halfKernels().fromHalf);
+		return file;
+	}
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, BFloat16<T> x)
+	{
+		file << x.value.size();
+		detail::writeNarrowed(file, x.value.data(), x.value.size(), detail::halfKernels().toBfloat16);
+		return file;
+	}
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, BFloat16<T> x)
+	{
+		static_assert(!std::is_const_v<T>, "cannot read into a constant");
+		size_t size;
+		file >> size;
+		x.value.resize(size);
+		detail::readWidened(file, x.value.data(), size, detail::halfKernels().fromBfloat16);
+		return file;
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, uint8_t x)
+	{
+		return detail::writeByte(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, int8_t x)
+	{
+		return detail::writeByte(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, uint16_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, int16_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, uint32_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, int32_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, uint64_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, int64_t x)
+	{
+		return detail::writeInteger(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, char x)
+	{
+		return detail::writeByte(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, float x)
+	{
+		return detail::writeFloat(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, double x)
+	{
+		return detail::writeFloat(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, bool x)
+	{
+		return detail::writeByte(file, x);
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const std::string &x)
+	{
+		file << x.size();
+		file.write(reinterpret_cast<const std::byte *>(x.data()), x.size());
+		return file;
+	}
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<T> &x);
+
+	template <typename Sink, typename T, std::size_t N>
+	sink_t<Sink> operator<<(Sink &file, const std::array<T, N> &x);
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<bool> &x);
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<std::string> &x);
+
+	template <typename Sink, std::size_t N>
+	sink_t<Sink> operator<<(Sink &file, const std::array<bool, N> &x);
+
+	template <typename Sink, typename K, typename V>
+	sink_t<Sink> operator<<(Sink &file, const std::map<K, V> &x);
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, const std::set<T> &x);
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<T> &x)
+	{
+		file << x.size();
+		if constexpr (detail::is_bulk_v<T>)
+		{
+			detail::writeBulk(file, x.data(), x.size());
+		}
+		else
+		{
+			for (auto &element : x)
+			{
+				file << element;
+			}
+		}
+		return file;
+	}
+
+	template <typename Sink, typename T, std::size_t N>
+	sink_t<Sink> operator<<(Sink &file, const std::array<T, N> &x)
+	{
+		file << N;
+		if constexpr (detail::is_bulk_v<T>)
+		{
+			detail::writeBulk(file, x.data(), N);
+		}
+		else
+		{
+			for (auto &element : x)
+			{
+				file << element;
+			}
+		}
+		return file;
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<bool> &x)
+	{
+		file << x.size();
+		detail::writeFlags(file, x);
+		return file;
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const std::vector<std::string> &x)
+	{
+		file << x.size();
+		if (!detail::formatOf(file).string_dictionary)
+		{
+			for (auto &element : x)
+			{
+				file << element;
+			}
+			return file;
+		}
+		// Codes in the order of the first occurrences
+		std::unordered_map<std::string_view, uint64_t> codes;
+		std::vector<const std::string *> dictionary;
+		std::vector<uint64_t> elements(x.size());
+		for (size_t i = 0; i < x.size(); ++i)
+		{
+			auto result = codes.try_emplace(x[i], dictionary.size());
+			if (result.second)
+			{
+				dictionary.push_back(&x[i]);
+			}
+			elements[i] = result.first->second;
+		}
+		file << dictionary.size();
+		for (const std::string *value : dictionary)
+		{
+			file << *value;
+		}
+		for (uint64_t code : elements)
+		{
+			detail::writeVarint(file, code);
+		}
+		return file;
+	}
+
+	template <typename Sink, std::size_t N>
+	sink_t<Sink> operator<<(Sink &file, const std::array<bool, N> &x)
+	{
+		file << N;
+		detail::writeFlags(file, x.data(), N);
+		return file;
+	}
+
+	template <typename Sink, typename K, typename V>
+	sink_t<Sink> operator<<(Sink &file, const std::map<K, V> &x)
+	{
+		file << x.size();
+		if constexpr (detail::is_delta_key_v<K>)
+		{
+			if (detail::formatOf(file).delta_keys && !x.empty())
+			{
+				K previous = x.begin()->first;
+				file << previous << x.begin()->second;
+				for (auto it = std::next(x.begin()); it != x.end(); ++it)
+				{
+					detail::writeGap(file, previous, it->first);
+					file << it->second;
+					previous = it->first;
+				}
+				return file;
+			}
+		}
+		for (auto &p : x)
+		{
+			file << p.first << p.second;
+		}
+		return file;
+	}
+
+	template <typename Sink, typename T>
+	sink_t<Sink> operator<<(Sink &file, const std::set<T> &x)
+	{
+		file << x.size();
+		if constexpr (detail::is_delta_key_v<T>)
+		{
+			if (detail::formatOf(file).delta_keys && !x.empty())
+			{
+				T previous = *x.begin();
+				file << previous;
+				for (auto it = std::next(x.begin()); it != x.end(); ++it)
+				{
+					detail::writeGap(file, previous, *it);
+					previous = *it;
+				}
+				return file;
+			}
+		}
+		for (const T &value : x)
+		{
+			file << value;
+		}
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, int8_t &x)
+	{
+		x = static_cast<int8_t>(detail::readByte(file));
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, uint8_t &x)
+	{
+		x = static_cast<uint8_t>(detail::readByte(file));
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, int16_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, uint16_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, int32_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, uint32_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, int64_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, uint64_t &x)
+	{
+		return detail::readInteger(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, char &x)
+	{
+		x = static_cast<char>(detail::readByte(file));
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, float &x)
+	{
+		return detail::readFloat(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, double &x)
+	{
+		return detail::readFloat(file, x);
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, bool &x)
+	{
+		x = static_cast<bool>(detail::readByte(file));
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, std::string &x)
+	{
+		size_t size_string;
+		file >> size_string;
+		x.resize(size_string);
+		// Keep only the bytes actually read if the archive is truncated
+		x.resize(file.read(reinterpret_cast<std::byte *>(x.data()), size_string));
+		return file;
+	}
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, std::vector<T> &x);
+
+	template <typename Source, typename T, std::size_t N>
+	source_t<Source> operator>>(Source &file, std::array<T, N> &x);
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, std::vector<bool> &x);
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, std::vector<std::string> &x);
+
+	template <typename Source, std::size_t N>
+	source_t<Source> operator>>(Source &file, std::array<bool, N> &x);
+
+	template <typename Source, typename K, typename V>
+	source_t<Source> operator>>(Source &file, std::map<K, V> &x);
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, std::set<T> &x);
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, std::vector<T> &x)
+	{
+		size_t size;
+		file >> size;
+		x.resize(size);
+		if constexpr (detail::is_bulk_v<T>)
+		{
+			detail::readBulk(file, x.data(), size);
+		}
+		else
+		{
+			for (auto &element : x)
+			{
+				file >> element;
+			}
+		}
+		return file;
+	}
+
+	template <typename Source, typename T, std::size_t N>
+	source_t<Source> operator>>(Source &file, std::array<T, N> &x)
+	{
+		size_t size;
+		file >> size;
+		if constexpr (detail::is_bulk_v<T>)
+		{
+			detail::readBulk(file, x.data(), N);
+		}
+		else
+		{
+			for (auto &element : x)
+			{
+				file >> element;
+			}
+		}
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, std::vector<bool> &x)
+	{
+		size_t size;
+		file >> size;
+		x.assign(size, false);
+		detail::readFlags(file, x);
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, std::vector<std::string> &x)
+	{
+		size_t size;
+		file >> size;
+		if (!detail::formatOf(file).string_dictionary)
+		{
+			x.resize(size);
+			for (auto &element : x)
+			{
+				file >> element;
+			}
+			return file;
+		}
+		// Each distinct string is read once and copied to its elements
+		size_t count;
+		file >> count;
+		std::vector<std::string> dictionary(count);
+		for (auto &value : dictionary)
+		{
+			file >> value;
+		}
+		x.resize(size);
+		for (auto &element : x)
+		{
+			uint64_t code = detail::readVarint(file);
+			if (code >= count)
+			{
+				throw std::runtime_error("Error while reading a dictionary-encoded vector!");
+			}
+			element = dictionary[code];
+		}
+		return file;
+	}
+
+	template <typename Source, std::size_t N>
+	source_t<Source> operator>>(Source &file, std::array<bool, N> &x)
+	{
+		size_t size;
+		file >> size;
+		detail::readFlags(file, x.data(), N);
+		return file;
+	}
+
+	template <typename Source, typename K, typename V>
+	source_t<Source> operator>>(Source &file, std::map<K, V> &x)
+	{
+		size_t size;
+		file >> size;
+		if constexpr (detail::is_delta_key_v<K>)
+		{
+			if (detail::formatOf(file).delta_keys && size > 0)
+			{
+				K key;
+				V value;
+				file >> key >> value;
+				x.emplace_hint(x.end(), key, std::move(value));
+				for (size_t i = 1; i < size; ++i)
+				{
+					key = detail::readGap(file, key);
+					V next;
+					file >> next;
+					x.emplace_hint(x.end(), key, std::move(next));
+				}
+				return file;
+			}
+		}
+		// The keys come in order, each one is inserted at the end
+		for (size_t i = 0; i < size; ++i)
+		{
+			K key;
+			V value;
+			file >> key >> value;
+			x.emplace_hint(x.end(), std::move(key), std::move(value));
+		}
+		return file;
+	}
+
+	template <typename Source, typename T>
+	source_t<Source> operator>>(Source &file, std::set<T> &x)
+	{
+		size_t size;
+		file >> size;
+		if constexpr (detail::is_delta_key_v<T>)
+		{
+			if (detail::formatOf(file).delta_keys && size > 0)
+			{
+				T value;
+				file >> value;
+				x.emplace_hint(x.end(), value);
+				for (size_t i = 1; i < size; ++i)
+				{
+					value = detail::readGap(file, value);
+					x.emplace_hint(x.end(), value);
+				}
+				return file;
+			}
+		}
+		// The values come in order, each one is inserted at the end
+		for (size_t i = 0; i < size; ++i)
+		{
+			T value;
+			file >> value;
+			x.emplace_hint(x.end(), std::move(value));
+		}
+		return file;
+	}
+
+	template <typename Sink>
+	sink_t<Sink> operator<<(Sink &file, const Dictionary &x)
+	{
+		file << x.content().size();
+		file.write(x.content().data(), x.content().size());
+		return file;
+	}
+
+	template <typename Source>
+	source_t<Source> operator>>(Source &file, Dictionary &x)
+	{
+		size_t size;
+		file >> size;
+		if (size > Dictionary::MaxCapacity)
+		{
+			throw std::runtime_error("Error while loading the dictionary!");
+		}
+		std::vector<std::byte> content(size);
+		content.resize(file.read(content.data(), size));
+		x = Dictionary(std::move(content));
+		return file;
+	}
+
+	/**
+	 * @brief Train a dictionary on `records` serialized the way `ORecordFile`
+	 * stores them with the options `format`
+	 */
+	template <typename T>
+	Dictionary trainDictionary(const std::vector<T> &records, const Format &format = Format(),
+							   std::size_t capacity = Dictionary::DefaultCapacity)
+	{
+		std::vector<std::vector<std::byte>> samples(records.size());
+		for (std::size_t i = 0; i < records.size(); ++i)
+		{
+			OBinaryBuffer out = detail::recordWriter(samples[i], format);
+			out << records[i];
+		}
+		return Dictionary::train(samples, capacity);
+	}
+
+	template <typename T>
+	void ORecordFile::write(const T &record)
+	{
+		m_record.clear();
+		{
+			OBinaryBuffer out = detail::recordWriter(m_record, m_format);
+			out << record;
+		}
+		writeRecord(m_record.data(), m_record.size());
+	}
+
+	template <typename T>
+	void IRecordFile::read(std::size_t index, T &record)
+	{
+		IBinaryBuffer in = detail::recordReader(readRecord(index), m_format);
+		in >> record;
+	}
+
+} // namespace serial
 
-} // namespace serial
 
 #endif // SERIAL_H
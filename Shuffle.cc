@@ -0,0 +1,250 @@
+#include "Shuffle.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            /**
+             * @brief Shuffle the values from `start` to `count`
+             */
+            template <std::size_t size>
+            void shuffleScalar(std::byte *out, const std::byte *in, std::size_t count, std::size_t start)
+            {
+                for (std::size_t j = 0; j < size; ++j)
+                {
+                    std::byte *plane = out + j * count;
+                    for (std::size_t i = start; i < count; ++i)
+                    {
+                        plane[i] = in[i * size + j];
+                    }
+                }
+            }
+
+            /**
+             * @brief Unshuffle the values from `start` to `count`
+             */
+            template <std::size_t size>
+            void unshuffleScalar(std::byte *out, const std::byte *in, std::size_t count, std::size_t start)
+            {
+                for (std::size_t j = 0; j < size; ++j)
+                {
+                    const std::byte *plane = in + j * count;
+                    for (std::size_t i = start; i < count; ++i)
+                    {
+                        out[i * size + j] = plane[i];
+                    }
+                }
+            }
+
+            template <std::size_t size>
+            void shuffleScalar(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                shuffleScalar<size>(out, in, count, 0);
+            }
+
+            template <std::size_t size>
+            void unshuffleScalar(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                unshuffleScalar<size>(out, in, count, 0);
+            }
+
+            const ShuffleKernels ScalarKernels = {
+                shuffleScalar<4>,
+                unshuffleScalar<4>,
+                shuffleScalar<8>,
+                unshuffleScalar<8>,
+            };
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  AVX2
+             ***********************************************************************************/
+
+            /**
+             * @brief Transpose the 4 bytes of 32 values of 32 bits, from 4 vectors
+             * of 8 values to 4 vectors of 32 bytes of same weight
+             *
+             * In each lane the bytes of same weight of 4 values are grouped, then
+             * the groups are ordered by weight and a 4x4 transpose of 64-bit
+             * words gathers them.
+             */
+            __attribute__((target("avx2"))) void transpose32(__m256i v[4])
+            {
+                const __m256i bytes = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+                const __m256i dwords = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+                for (int k = 0; k < 4; ++k)
+                {
+                    v[k] = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v[k], bytes), dwords);
+                }
+                __m256i t0 = _mm256_unpacklo_epi64(v[0], v[1]);
+                __m256i t1 = _mm256_unpackhi_epi64(v[0], v[1]);
+                __m256i t2 = _mm256_unpacklo_epi64(v[2], v[3]);
+                __m256i t3 = _mm256_unpackhi_epi64(v[2], v[3]);
+                v[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+                v[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+                v[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+                v[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+            }
+
+            /**
+             * @brief Inverse of `transpose32()`
+             */
+            __attribute__((target("avx2"))) void untranspose32(__m256i v[4])
+            {
+                const __m256i bytes = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+                const __m256i dwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+                __m256i t0 = _mm256_unpacklo_epi64(v[0], v[1]);
+                __m256i t1 = _mm256_unpackhi_epi64(v[0], v[1]);
+                __m256i t2 = _mm256_unpacklo_epi64(v[2], v[3]);
+                __m256i t3 = _mm256_unpackhi_epi64(v[2], v[3]);
+                v[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+                v[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+                v[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+                v[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+                for (int k = 0; k < 4; ++k)
+                {
+                    v[k] = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v[k], dwords), bytes);
+                }
+            }
+
+            /**
+             * @brief Even bytes of each lane first, odd bytes last
+             */
+            __attribute__((target("avx2"))) __m256i evenOdd()
+            {
+                return _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15));
+            }
+
+            __attribute__((target("avx2"))) void shuffle32Avx2(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                std::size_t i = 0;
+                for (; i + 32 <= count; i += 32)
+                {
+                    __m256i v[4];
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        v[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 4 * i + 32 * k));
+                    }
+                    transpose32(v);
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j * count + i), v[j]);
+                    }
+                }
+                shuffleScalar<4>(out, in, count, i);
+            }
+
+            __attribute__((target("avx2"))) void unshuffle32Avx2(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                std::size_t i = 0;
+                for (; i + 32 <= count; i += 32)
+                {
+                    __m256i v[4];
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        v[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + j * count + i));
+                    }
+                    untranspose32(v);
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * i + 32 * k), v[k]);
+                    }
+                }
+                unshuffleScalar<4>(out, in, count, i);
+            }
+
+            /**
+             * @brief Shuffle 16 values of 64 bits at a time as 32 values of 32
+             * bits, whose byte `j` holds the bytes `j` and `j + 4` of the
+             * values alternately
+             */
+            __attribute__((target("avx2"))) void shuffle64Avx2(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                const __m256i split = evenOdd();
+                std::size_t i = 0;
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m256i v[4];
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        v[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 8 * i + 32 * k));
+                    }
+                    transpose32(v);
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        __m256i planes = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v[j], split), 0xD8);
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j * count + i), _mm256_castsi256_si128(planes));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (j + 4) * count + i), _mm256_extracti128_si256(planes, 1));
+                    }
+                }
+                shuffleScalar<8>(out, in, count, i);
+            }
+
+            __attribute__((target("avx2"))) void unshuffle64Avx2(std::byte *out, const std::byte *in, std::size_t count)
+            {
+                const __m256i merge = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15));
+                std::size_t i = 0;
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m256i v[4];
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + j * count + i));
+                        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + (j + 4) * count + i));
+                        __m256i planes = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+                        v[j] = _mm256_shuffle_epi8(_mm256_permute4x64_epi64(planes, 0xD8), merge);
+                    }
+                    untranspose32(v);
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8 * i + 32 * k), v[k]);
+                    }
+                }
+                unshuffleScalar<8>(out, in, count, i);
+            }
+
+            const ShuffleKernels Avx2Kernels = {
+                shuffle32Avx2,
+                unshuffle32Avx2,
+                shuffle64Avx2,
+                unshuffle64Avx2,
+            };
+#endif
+        }
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const ShuffleKernels &shuffleKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            if (level == SimdLevel::AVX2)
+            {
+                return Avx2Kernels;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
@@ -0,0 +1,83 @@
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include "ByteSwap.h"
+
+#include <cstddef>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Byte shuffling kernels, in the style of Blosc
+		 *
+		 * `shuffle` transposes `count` values of 32 or 64 bits from `in` to
+		 * `out`: the byte `j` of the value `i` goes to `out[j * count + i]`, so
+		 * that the bytes of same weight, which vary together in arrays of
+		 * numbers, are grouped and compress better. `unshuffle` is the inverse.
+		 * `in` and `out` must not overlap, and need no alignment.
+		 */
+		struct ShuffleKernels
+		{
+			void (*shuffle32)(std::byte *out, const std::byte *in, std::size_t count);
+			void (*unshuffle32)(std::byte *out, const std::byte *in, std::size_t count);
+			void (*shuffle64)(std::byte *out, const std::byte *in, std::size_t count);
+			void (*unshuffle64)(std::byte *out, const std::byte *in, std::size_t count);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`.
+		 * There are AVX2 and scalar kernels only, the SSSE3 level uses the
+		 * scalar ones.
+		 */
+		const ShuffleKernels &shuffleKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const ShuffleKernels &shuffleKernels()
+		{
+			static const ShuffleKernels &kernels = shuffleKernels(simdLevel());
+			return kernels;
+		}
+
+		/**
+		 * @brief Shuffle `count` values of `size` bytes from `in` to `out`
+		 */
+		template <std::size_t size>
+		inline void byteShuffle(std::byte *out, const std::byte *in, std::size_t count)
+		{
+			static_assert(size == 4 || size == 8, "unsupported value size");
+			if constexpr (size == 4)
+			{
+				shuffleKernels().shuffle32(out, in, count);
+			}
+			else
+			{
+				shuffleKernels().shuffle64(out, in, count);
+			}
+		}
+
+		/**
+		 * @brief Unshuffle `count` values of `size` bytes from `in` to `out`
+		 */
+		template <std::size_t size>
+		inline void byteUnshuffle(std::byte *out, const std::byte *in, std::size_t count)
+		{
+			static_assert(size == 4 || size == 8, "unsupported value size");
+			if constexpr (size == 4)
+			{
+				shuffleKernels().unshuffle32(out, in, count);
+			}
+			else
+			{
+				shuffleKernels().unshuffle64(out, in, count);
+			}
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // SHUFFLE_H
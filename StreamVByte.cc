@@ -0,0 +1,287 @@
+#include "StreamVByte.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace serial
+{
+    namespace detail
+    {
+        namespace
+        {
+            /***********************************************************************************
+             *                                  Tables
+             ***********************************************************************************/
+
+            /**
+             * @brief Shuffle masks moving the data bytes of the values of a
+             * control byte to their place in 16 bytes of output, with the
+             * number of data bytes of the control byte
+             */
+            struct ShuffleTable
+            {
+                uint8_t mask[256][16];
+                uint8_t length[256];
+            };
+
+            /**
+             * @brief Build the table of the values of `size` bytes, whose
+             * controls take `bits` bits
+             */
+            constexpr ShuffleTable makeShuffleTable(unsigned size, unsigned bits)
+            {
+                ShuffleTable table{};
+                unsigned values = 8 / bits;
+                unsigned codes = size == 4 ? 3 : 7;
+                for (unsigned control = 0; control < 256; ++control)
+                {
+                    unsigned position = 0;
+                    for (unsigned v = 0; v < values; ++v)
+                    {
+                        unsigned length = ((control >> (bits * v)) & codes) + 1;
+                        for (unsigned b = 0; b < size; ++b)
+                        {
+                            table.mask[control][size * v + b] = static_cast<uint8_t>(b < length ? position + b : 0x80);
+                        }
+                        position += length;
+                    }
+                    table.length[control] = static_cast<uint8_t>(position);
+                }
+                return table;
+            }
+
+            constexpr ShuffleTable Shuffle32 = makeShuffleTable(4, 2);
+            constexpr ShuffleTable Shuffle64 = makeShuffleTable(8, 4);
+
+            /***********************************************************************************
+             *                                  Scalar
+             ***********************************************************************************/
+
+            /**
+             * @brief Number of significant bytes of `x`, at least one
+             */
+            unsigned significantBytes(uint32_t x)
+            {
+                return 4 - static_cast<unsigned>(__builtin_clz(x | 1)) / 8;
+            }
+
+            unsigned significantBytes(uint64_t x)
+            {
+                return 8 - static_cast<unsigned>(__builtin_clzll(x | 1)) / 8;
+            }
+
+            /**
+             * @brief Store all the bytes of `x` in little endian
+             */
+            template <typename T>
+            void storeBytes(std::byte *data, T x)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                if constexpr (sizeof(T) == 4)
+                {
+                    x = __builtin_bswap32(x);
+                }
+                else
+                {
+                    x = __builtin_bswap64(x);
+                }
+#endif
+                std::memcpy(data, &x, sizeof(T));
+            }
+
+            /**
+             * @brief Load the `length` bytes of a value stored in little endian,
+             * without reading past `end`
+             */
+            uint64_t loadBytes(const std::byte *data, unsigned length, const std::byte *end)
+            {
+                if (end - data >= 8)
+                {
+                    uint64_t x;
+                    std::memcpy(&x, data, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    x = __builtin_bswap64(x);
+#endif
+                    return length == 8 ? x : x & ((uint64_t(1) << (8 * length)) - 1);
+                }
+                uint64_t x = 0;
+                for (unsigned b = 0; b < length; ++b)
+                {
+                    x |= static_cast<uint64_t>(data[b]) << (8 * b);
+                }
+                return x;
+            }
+
+            template <typename T>
+            std::size_t encodeScalar(std::byte *control, std::byte *data, const T *in, std::size_t count)
+            {
+                constexpr unsigned values = sizeof(T) == 4 ? 4 : 2;
+                constexpr unsigned bits = 8 / values;
+                if (count == 0)
+                {
+                    return 0;
+                }
+                std::memset(control, 0, streamVByteControlSize<T>(count));
+                std::byte *start = data;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    unsigned length = significantBytes(in[i]);
+                    control[i / values] |= static_cast<std::byte>((length - 1) << (bits * (i % values)));
+                    storeBytes(data, in[i]);
+                    data += length;
+                }
+                return data - start;
+            }
+
+            template <typename T>
+            void decodeScalar(T *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count)
+            {
+                constexpr unsigned values = sizeof(T) == 4 ? 4 : 2;
+                constexpr unsigned bits = 8 / values;
+                constexpr unsigned codes = sizeof(T) == 4 ? 3 : 7;
+                const std::byte *end = data + size;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    unsigned code = static_cast<unsigned>(control[i / values]) >> (bits * (i % values));
+                    unsigned length = (code & codes) + 1;
+                    out[i] = static_cast<T>(loadBytes(data, length, end));
+                    data += length;
+                }
+            }
+
+            const StreamVByteKernels ScalarKernels = {decodeScalar<uint32_t>, decodeScalar<uint64_t>};
+
+#ifdef SERIAL_X86
+            /***********************************************************************************
+             *                                  SSSE3
+             ***********************************************************************************/
+
+            /**
+             * @brief Decode a control byte at a time while 16 data bytes can be
+             * loaded, and the rest with the scalar kernel
+             */
+            template <typename T>
+            __attribute__((target("ssse3"))) void decodeSsse3(T *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count)
+            {
+                constexpr std::size_t values = 16 / sizeof(T);
+                const ShuffleTable &table = sizeof(T) == 4 ? Shuffle32 : Shuffle64;
+                const std::byte *end = data + size;
+                std::size_t i = 0;
+                for (; i + values <= count && end - data >= 16; i += values)
+                {
+                    unsigned c = static_cast<unsigned>(control[i / values]);
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+                    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.mask[c]));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(v, mask));
+                    data += table.length[c];
+                }
+                decodeScalar(out + i, control + i / values, data, end - data, count - i);
+            }
+
+            const StreamVByteKernels Ssse3Kernels = {decodeSsse3<uint32_t>, decodeSsse3<uint64_t>};
+
+            /***********************************************************************************
+             *                                  AVX2
+             ***********************************************************************************/
+
+            /**
+             * @brief Decode two control bytes at a time, one per lane, while 32
+             * data bytes remain, and the rest with the SSSE3 kernel
+             */
+            template <typename T>
+            __attribute__((target("avx2"))) void decodeAvx2(T *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count)
+            {
+                constexpr std::size_t values = 16 / sizeof(T);
+                const ShuffleTable &table = sizeof(T) == 4 ? Shuffle32 : Shuffle64;
+                const std::byte *end = data + size;
+                std::size_t i = 0;
+                for (; i + 2 * values <= count && end - data >= 32; i += 2 * values)
+                {
+                    unsigned c0 = static_cast<unsigned>(control[i / values]);
+                    unsigned c1 = static_cast<unsigned>(control[i / values + 1]);
+                    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+                    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + table.length[c0]));
+                    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+                    __m256i mask = _mm256_inserti128_si256(
+                        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table.mask[c0]))),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.mask[c1])), 1);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_shuffle_epi8(v, mask));
+                    data += table.length[c0] + table.length[c1];
+                }
+                decodeSsse3(out + i, control + i / values, data, end - data, count - i);
+            }
+
+            const StreamVByteKernels Avx2Kernels = {decodeAvx2<uint32_t>, decodeAvx2<uint64_t>};
+#endif
+        }
+
+        std::size_t encodeStreamVByte(std::byte *control, std::byte *data, const uint32_t *in, std::size_t count)
+        {
+            return encodeScalar(control, data, in, count);
+        }
+
+        std::size_t encodeStreamVByte(std::byte *control, std::byte *data, const uint64_t *in, std::size_t count)
+        {
+            return encodeScalar(control, data, in, count);
+        }
+
+        /**
+         * @brief Number of data bytes of the `count` values of type `T` whose
+         * control bytes are pointed by `control`
+         *
+         * Whole control bytes are looked up in the tables, the values of the
+         * last one are counted one by one.
+         */
+        template <typename T>
+        std::size_t streamVByteDataSize(const std::byte *control, std::size_t count)
+        {
+            constexpr std::size_t values = 16 / sizeof(T);
+            constexpr unsigned bits = 8 / values;
+            constexpr unsigned codes = sizeof(T) == 4 ? 3 : 7;
+            const ShuffleTable &table = sizeof(T) == 4 ? Shuffle32 : Shuffle64;
+            std::size_t size = 0;
+            std::size_t full = count / values;
+            for (std::size_t i = 0; i < full; ++i)
+            {
+                size += table.length[static_cast<unsigned>(control[i])];
+            }
+            for (std::size_t i = full * values; i < count; ++i)
+            {
+                size += ((static_cast<unsigned>(control[full]) >> (bits * (i % values))) & codes) + 1;
+            }
+            return size;
+        }
+
+        template std::size_t streamVByteDataSize<uint32_t>(const std::byte *control, std::size_t count);
+        template std::size_t streamVByteDataSize<uint64_t>(const std::byte *control, std::size_t count);
+
+        /**
+         * @brief Kernels for the instruction set `level`
+         */
+        const StreamVByteKernels &streamVByteKernels(SimdLevel level)
+        {
+#ifdef SERIAL_X86
+            if (level > simdLevel())
+            {
+                level = simdLevel();
+            }
+            switch (level)
+            {
+            case SimdLevel::AVX2:
+                return Avx2Kernels;
+            case SimdLevel::SSSE3:
+                return Ssse3Kernels;
+            case SimdLevel::Scalar:
+                break;
+            }
+#else
+            (void)level;
+#endif
+            return ScalarKernels;
+        }
+    } // namespace detail
+} // namespace serial
@@ -0,0 +1,91 @@
+#ifndef STREAM_V_BYTE_H
+#define STREAM_V_BYTE_H
+
+#include "ByteSwap.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Number of values of a block of the Stream VByte codec
+		 */
+		constexpr std::size_t StreamVByteBlock = 1024;
+
+		/**
+		 * @brief Number of control bytes of `count` values of type `T`
+		 *
+		 * The control of a 32-bit value takes 2 bits and the one of a 64-bit
+		 * value 4 bits, the first value of a control byte in its low bits.
+		 */
+		template <typename T>
+		constexpr std::size_t streamVByteControlSize(std::size_t count)
+		{
+			static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported value size");
+			return sizeof(T) == 4 ? (count + 3) / 4 : (count + 1) / 2;
+		}
+
+		/**
+		 * @brief Encode `count` values with the Stream VByte codec
+		 *
+		 * Each value is stored in the data bytes with its significant bytes
+		 * only, at least one, least significant first, and its control holds
+		 * that number of bytes minus one. `control` must hold
+		 * `streamVByteControlSize()` bytes and `data` `count * sizeof(value)`
+		 * bytes. Returns the number of data bytes.
+		 */
+		std::size_t encodeStreamVByte(std::byte *control, std::byte *data, const uint32_t *in, std::size_t count);
+		std::size_t encodeStreamVByte(std::byte *control, std::byte *data, const uint64_t *in, std::size_t count);
+
+		/**
+		 * @brief Number of data bytes of the `count` values of type `T` whose
+		 * control bytes are pointed by `control`
+		 */
+		template <typename T>
+		std::size_t streamVByteDataSize(const std::byte *control, std::size_t count);
+
+		/**
+		 * @brief Stream VByte decoding kernels
+		 *
+		 * Each kernel decodes in `out` the `count` values whose control bytes
+		 * are pointed by `control` and whose `size` data bytes are pointed by
+		 * `data`, `size` being the one given by `streamVByteDataSize()`.
+		 */
+		struct StreamVByteKernels
+		{
+			void (*decode32)(uint32_t *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count);
+			void (*decode64)(uint64_t *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count);
+		};
+
+		/**
+		 * @brief Kernels for the instruction set `level`
+		 *
+		 * Falls back to the best supported instruction set below `level`.
+		 */
+		const StreamVByteKernels &streamVByteKernels(SimdLevel level);
+
+		/**
+		 * @brief Kernels for the best instruction set of the processor
+		 */
+		inline const StreamVByteKernels &streamVByteKernels()
+		{
+			static const StreamVByteKernels &kernels = streamVByteKernels(simdLevel());
+			return kernels;
+		}
+
+		inline void decodeStreamVByte(uint32_t *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count)
+		{
+			streamVByteKernels().decode32(out, control, data, size, count);
+		}
+
+		inline void decodeStreamVByte(uint64_t *out, const std::byte *control, const std::byte *data, std::size_t size, std::size_t count)
+		{
+			streamVByteKernels().decode64(out, control, data, size, count);
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // STREAM_V_BYTE_H
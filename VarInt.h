@@ -0,0 +1,115 @@
+#ifndef VAR_INT_H
+#define VAR_INT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace serial
+{
+	namespace detail
+	{
+		/**
+		 * @brief Maximum number of bytes of a varint encoding 64 bits
+		 */
+		constexpr std::size_t MaxVarintSize = 10;
+
+		/**
+		 * @brief Encode `x` as a LEB128 varint in the bytes pointed by `b`
+		 *
+		 * Each byte holds 7 bits of `x`, least significant first, and its most
+		 * significant bit tells whether another byte follows. At least
+		 * `MaxVarintSize` bytes must be writable. Returns the number of bytes
+		 * of the varint.
+		 */
+		inline std::size_t encodeVarint(std::byte *b, uint64_t x)
+		{
+			std::size_t n = 0;
+			while (x >= 0x80)
+			{
+				b[n++] = static_cast<std::byte>(x | 0x80);
+				x >>= 7;
+			}
+			b[n++] = static_cast<std::byte>(x);
+			return n;
+		}
+
+		/**
+		 * @brief Number of bytes of the varint encoding `x`
+		 */
+		inline std::size_t varintSize(uint64_t x)
+		{
+			// One byte per started group of 7 significant bits
+			int bits = 64 - __builtin_clzll(x | 1);
+			return static_cast<std::size_t>((bits + 6) / 7);
+		}
+
+		/**
+		 * @brief Map a signed integer to an unsigned one so that small
+		 * magnitudes get small codes: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+		 */
+		inline uint64_t zigzagEncode(int64_t x)
+		{
+			return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+		}
+
+		/**
+		 * @brief Inverse of `zigzagEncode()`
+		 */
+		inline int64_t zigzagDecode(uint64_t x)
+		{
+			return static_cast<int64_t>((x >> 1) ^ (~(x & 1) + 1));
+		}
+
+		/**
+		 * @brief Gather the 7-bit groups of the 8 bytes of `word`, dropping the
+		 * continuation bits
+		 */
+		inline uint64_t gatherVarintGroups(uint64_t word)
+		{
+			word = (word & 0x007F007F007F007F) | ((word & 0x7F007F007F007F00) >> 1);
+			word = (word & 0x00003FFF00003FFF) | ((word & 0x3FFF00003FFF0000) >> 2);
+			word = (word & 0x000000000FFFFFFF) | ((word & 0x0FFFFFFF00000000) >> 4);
+			return word;
+		}
+
+		/**
+		 * @brief Decode the varint pointed by `b` in `x`
+		 *
+		 * At least `MaxVarintSize` bytes must be readable. Varints of up to 8
+		 * bytes (values below 2^56) are decoded without any loop: the
+		 * terminating byte is found with a bit scan over an 8-byte load.
+		 * Returns the number of bytes of the varint.
+		 */
+		inline std::size_t decodeVarint(const std::byte *b, uint64_t &x)
+		{
+			uint64_t word;
+			std::memcpy(&word, b, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			word = __builtin_bswap64(word);
+#endif
+			uint64_t stops = ~word & 0x8080808080808080;
+			if (stops != 0)
+			{
+				unsigned bits = static_cast<unsigned>(__builtin_ctzll(stops)) + 1;
+				if (bits < 64)
+				{
+					word &= (uint64_t(1) << bits) - 1;
+				}
+				x = gatherVarintGroups(word);
+				return bits / 8;
+			}
+			x = gatherVarintGroups(word);
+			uint64_t b8 = static_cast<uint64_t>(b[8]);
+			x |= (b8 & 0x7F) << 56;
+			if ((b8 & 0x80) == 0)
+			{
+				return 9;
+			}
+			x |= static_cast<uint64_t>(b[9]) << 63;
+			return 10;
+		}
+	} // namespace detail
+} // namespace serial
+
+#endif // VAR_INT_H
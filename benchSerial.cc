@@ -0,0 +1,639 @@
+#include "Crc32c.h"
+#include "Serial.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+/***********************************************************************************
+ *                                  Functions
+ ***********************************************************************************/
+
+/**
+ * Prevent the compiler from optimizing away the result of a benchmark
+ */
+template <typename T>
+void keep(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Run `fn` until at least 200 ms elapsed and print the throughput, `bytes`
+ * being the number of bytes processed by one call
+ */
+template <typename Function>
+void measure(const std::string &name, std::size_t bytes, Function fn)
+{
+    using clock = std::chrono::steady_clock;
+    fn();
+    std::size_t iterations = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed{};
+    do
+    {
+        fn();
+        ++iterations;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 0.2);
+    double gbs = static_cast<double>(bytes) * iterations / elapsed.count() / 1e9;
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::fixed << std::setprecision(2) << std::setw(8) << gbs << " GB/s\n";
+}
+
+const char *levelName(serial::detail::SimdLevel level)
+{
+    switch (level)
+    {
+    case serial::detail::SimdLevel::AVX2:
+        return "avx2";
+    case serial::detail::SimdLevel::SSSE3:
+        return "ssse3";
+    case serial::detail::SimdLevel::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+/***********************************************************************************
+ *                                  Benchmarks
+ ***********************************************************************************/
+
+/**
+ * Byte swapping kernels
+ */
+void benchByteSwap()
+{
+    using serial::detail::SimdLevel;
+    constexpr std::size_t Size = 1 << 20;
+    std::vector<std::byte> in(Size), out(Size);
+    for (std::size_t i = 0; i < Size; ++i)
+    {
+        in[i] = static_cast<std::byte>(i * 31);
+    }
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        if (level > serial::detail::simdLevel())
+        {
+            continue;
+        }
+        const serial::detail::ByteSwapKernels &kernels = serial::detail::byteSwapKernels(level);
+        std::string suffix = std::string(" (") + levelName(level) + ")";
+        measure("bswap16" + suffix, Size, [&] { kernels.swap16(out.data(), in.data(), Size / 2); keep(out[0]); });
+        measure("bswap32" + suffix, Size, [&] { kernels.swap32(out.data(), in.data(), Size / 4); keep(out[0]); });
+        measure("bswap64" + suffix, Size, [&] { kernels.swap64(out.data(), in.data(), Size / 8); keep(out[0]); });
+    }
+}
+
+/**
+ * Bulk vector encoding to and from memory
+ */
+void benchVector()
+{
+    std::vector<uint32_t> values(1 << 20);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+    std::size_t bytes = values.size() * sizeof(uint32_t);
+
+    std::vector<std::byte> buffer;
+    buffer.reserve(bytes + 64);
+    measure("vector<uint32_t> write", bytes, [&]
+            {
+                buffer.clear();
+                serial::OBinaryBuffer out(buffer);
+                out << values;
+            });
+
+    std::vector<uint32_t> read;
+    measure("vector<uint32_t> read", bytes, [&]
+            {
+                serial::IBinaryBuffer in(buffer);
+                in >> read;
+                keep(read[0]);
+            });
+}
+
+/**
+ * Stream VByte decoding kernels and compact vectors, throughput counted in
+ * decoded bytes
+ */
+void benchStreamVByte()
+{
+    using serial::detail::SimdLevel;
+    std::vector<uint32_t> values(1 << 20);
+    uint32_t seed = 2463534242u;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        // Mix of 1 to 4 byte values
+        values[i] = seed >> (8 * (seed % 4));
+    }
+    std::size_t bytes = values.size() * sizeof(uint32_t);
+
+    std::vector<std::byte> control(serial::detail::streamVByteControlSize<uint32_t>(values.size()));
+    std::vector<std::byte> data(bytes);
+    std::size_t size = serial::detail::encodeStreamVByte(control.data(), data.data(), values.data(), values.size());
+    std::vector<uint32_t> out(values.size());
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        if (level > serial::detail::simdLevel())
+        {
+            continue;
+        }
+        const serial::detail::StreamVByteKernels &kernels = serial::detail::streamVByteKernels(level);
+        std::string suffix = std::string(" (") + levelName(level) + ")";
+        measure("stream vbyte decode32" + suffix, bytes, [&]
+                {
+                    kernels.decode32(out.data(), control.data(), data.data(), size, out.size());
+                    keep(out[0]);
+                });
+    }
+
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    measure("compact vector<uint32_t> write", bytes, [&]
+            {
+                buffer.clear();
+                serial::OBinaryBuffer file(buffer, format);
+                file << values;
+            });
+
+    std::vector<uint32_t> read;
+    measure("compact vector<uint32_t> read", bytes, [&]
+            {
+                serial::IBinaryBuffer file(buffer);
+                file >> read;
+                keep(read[0]);
+            });
+}
+
+/**
+ * Bit-packing kernels and bit-packed vectors of 12-bit values, throughput
+ * counted in unpacked bytes
+ */
+void benchBitPack()
+{
+    using serial::detail::SimdLevel;
+    constexpr unsigned Width = 12;
+    std::vector<uint32_t> values(1 << 20);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = 5000 + static_cast<uint32_t>(i * 2654435761u >> (32 - Width));
+    }
+    std::size_t bytes = values.size() * sizeof(uint32_t);
+    std::size_t blocks = values.size() / serial::detail::BitPackBlock;
+
+    std::vector<std::byte> packed(blocks * serial::detail::bitPackedSize(Width));
+    std::vector<uint32_t> out(values.size());
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3})
+    {
+        if (level > serial::detail::simdLevel())
+        {
+            continue;
+        }
+        const serial::detail::BitPackKernels &kernels = serial::detail::bitPackKernels(level);
+        std::string suffix = std::string(" (") + (level == SimdLevel::Scalar ? "scalar" : "sse2") + ")";
+        auto block = [&](std::size_t b) { return packed.data() + b * serial::detail::bitPackedSize(Width); };
+        measure("bit pack32" + suffix, bytes, [&]
+                {
+                    for (std::size_t b = 0; b < blocks; ++b)
+                    {
+                        kernels.pack32(block(b), values.data() + b * serial::detail::BitPackBlock, 5000, Width);
+                    }
+                    keep(packed[0]);
+                });
+        measure("bit unpack32" + suffix, bytes, [&]
+                {
+                    for (std::size_t b = 0; b < blocks; ++b)
+                    {
+                        kernels.unpack32(out.data() + b * serial::detail::BitPackBlock, block(b), 5000, Width);
+                    }
+                    keep(out[0]);
+                });
+    }
+
+    serial::Format format;
+    format.bit_packing = true;
+    std::vector<std::byte> buffer;
+    measure("bit-packed vector<uint32_t> write", bytes, [&]
+            {
+                buffer.clear();
+                serial::OBinaryBuffer file(buffer, format);
+                file << values;
+            });
+
+    std::vector<uint32_t> read;
+    measure("bit-packed vector<uint32_t> read", bytes, [&]
+            {
+                serial::IBinaryBuffer file(buffer);
+                file >> read;
+                keep(read[0]);
+            });
+}
+
+/**
+ * XOR codec against the raw path on a slowly changing series, throughput
+ * counted in raw bytes
+ */
+void benchGorilla()
+{
+    std::vector<double> values(1 << 20);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        // A sensor sampled with two decimals
+        values[i] = 20.0 + std::round(std::sin(i * 0.0005) * 500.0) / 100.0;
+    }
+    std::size_t bytes = values.size() * sizeof(double);
+
+    serial::Format xor_format;
+    xor_format.float_xor = true;
+    for (const serial::Format &format : {serial::Format(), xor_format})
+    {
+        std::string name = format.float_xor ? "xor vector<double>" : "raw vector<double>";
+        std::vector<std::byte> buffer;
+        measure(name + " write", bytes, [&]
+                {
+                    buffer.clear();
+                    serial::OBinaryBuffer file(buffer, format);
+                    file << values;
+                });
+
+        std::vector<double> read;
+        measure(name + " read", bytes, [&]
+                {
+                    serial::IBinaryBuffer file(buffer);
+                    file >> read;
+                    keep(read[0]);
+                });
+        std::cout << std::left << std::setw(40) << name + " size"
+                  << std::right << std::fixed << std::setprecision(2) << std::setw(8)
+                  << 8.0 * buffer.size() / values.size() << " bits/value\n";
+    }
+}
+
+/**
+ * Byte shuffle of doubles, the stage before a compressor
+ */
+void benchShuffle()
+{
+    std::vector<double> values(1 << 20);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = 1000.0 + std::sin(i * 0.0005);
+    }
+    std::size_t bytes = values.size() * sizeof(double);
+    std::vector<std::byte> shuffled(bytes);
+    std::vector<double> unshuffled(values.size());
+    const std::byte *in = reinterpret_cast<const std::byte *>(values.data());
+
+    using serial::detail::SimdLevel;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2})
+    {
+        if (level > serial::detail::simdLevel())
+        {
+            continue;
+        }
+        const serial::detail::ShuffleKernels &kernels = serial::detail::shuffleKernels(level);
+        std::string suffix = std::string(" (") + levelName(level) + ")";
+        measure("shuffle64" + suffix, bytes, [&]
+                {
+                    kernels.shuffle64(shuffled.data(), in, values.size());
+                    keep(shuffled[0]);
+                });
+        measure("unshuffle64" + suffix, bytes, [&]
+                {
+                    kernels.unshuffle64(reinterpret_cast<std::byte *>(unshuffled.data()), shuffled.data(), values.size());
+                    keep(unshuffled[0]);
+                });
+    }
+}
+
+/**
+ * Vectors of floats stored on 16 bits, throughput counted in float bytes
+ */
+void benchHalf()
+{
+    std::vector<float> values(1 << 20);
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        values[i] = std::sin(i * 0.001f);
+    }
+    std::size_t bytes = values.size() * sizeof(float);
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+
+    std::vector<std::byte> buffer;
+    std::vector<float> read;
+    measure("half vector<float> write", bytes, [&]
+            {
+                buffer.clear();
+                serial::OBinaryBuffer file(buffer, format);
+                file << serial::half(values);
+            });
+    measure("half vector<float> read", bytes, [&]
+            {
+                serial::IBinaryBuffer file(buffer);
+                file >> serial::half(read);
+                keep(read[0]);
+            });
+    measure("bfloat16 vector<float> write", bytes, [&]
+            {
+                buffer.clear();
+                serial::OBinaryBuffer file(buffer, format);
+                file << serial::bfloat16(values);
+            });
+    measure("bfloat16 vector<float> read", bytes, [&]
+            {
+                serial::IBinaryBuffer file(buffer);
+                file >> serial::bfloat16(read);
+                keep(read[0]);
+            });
+}
+
+/**
+ * A checkpoint written and read through stdio files, raw or compressed by
+ * blocks, throughput counted in raw bytes
+ */
+void benchCompression()
+{
+    std::vector<uint32_t> ids(1 << 18);
+    std::vector<double> weights(1 << 18);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        ids[i] = static_cast<uint32_t>(i / 4 * 7);
+        weights[i] = std::round(std::sin(i * 0.001) * 1000.0) / 1000.0;
+    }
+    std::string name = (std::filesystem::temp_directory_path() / "bench_compression.bin").string();
+    std::size_t bytes = ids.size() * sizeof(uint32_t) + weights.size() * sizeof(double);
+
+    for (serial::Compression compression : {serial::Compression::None, serial::Compression::Lz, serial::Compression::LzHigh,
+                                            serial::Compression::Lz4, serial::Compression::Zstd})
+    {
+        if (compression != serial::Compression::None && !serial::compressionAvailable(compression))
+        {
+            continue;
+        }
+        serial::Format format;
+        format.compression = compression;
+        std::string label = compression == serial::Compression::None ? "raw" : serial::detail::findCodec(compression)->name;
+        measure(label + " checkpoint write", bytes, [&]
+                {
+                    serial::OBinaryFile file(name, format);
+                    file << ids << weights;
+                });
+        std::vector<uint32_t> read_ids;
+        std::vector<double> read_weights;
+        measure(label + " checkpoint read", bytes, [&]
+                {
+                    serial::IBinaryFile file(name);
+                    file >> read_ids >> read_weights;
+                    keep(read_ids[0]);
+                });
+        std::cout << std::left << std::setw(40) << label + " checkpoint ratio"
+                  << std::right << std::fixed << std::setprecision(2) << std::setw(8)
+                  << static_cast<double>(bytes) / std::filesystem::file_size(name) << "\n";
+    }
+    std::filesystem::remove(name);
+}
+
+/**
+ * CRC32C of a 1 MiB buffer, then a checkpoint written and read with
+ * checksums through stdio files
+ */
+void benchCrc32c()
+{
+    std::vector<std::byte> data(1 << 20);
+    for (std::size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<std::byte>(i * 2654435761u >> 24);
+    }
+    const serial::detail::Crc32cKernels &scalar = serial::detail::crc32cKernels(serial::detail::SimdLevel::Scalar);
+    const serial::detail::Crc32cKernels &best = serial::detail::crc32cKernels();
+    measure("crc32c (slicing-by-8)", data.size(), [&]
+            {
+                keep(scalar.update(0, data.data(), data.size()));
+            });
+    if (&best != &scalar)
+    {
+        measure("crc32c (sse4.2)", data.size(), [&]
+                {
+                    keep(best.update(0, data.data(), data.size()));
+                });
+    }
+
+    std::vector<uint32_t> ids(1 << 18);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        ids[i] = static_cast<uint32_t>(i / 4 * 7);
+    }
+    std::string name = (std::filesystem::temp_directory_path() / "bench_crc32c.bin").string();
+    std::size_t bytes = ids.size() * sizeof(uint32_t);
+    serial::Format format;
+    format.checksums = true;
+    measure("checksummed checkpoint write", bytes, [&]
+            {
+                serial::OBinaryFile file(name, format);
+                file << ids;
+            });
+    std::vector<uint32_t> read;
+    measure("checksummed checkpoint read", bytes, [&]
+            {
+                serial::IBinaryFile file(name);
+                file >> read;
+                keep(read[0]);
+            });
+    std::filesystem::remove(name);
+}
+
+/**
+ * A compressed checkpoint written and read with 1 to N threads, N being the
+ * number of cores, throughput counted in raw bytes
+ */
+void benchThreads()
+{
+    std::vector<uint32_t> ids(1 << 20);
+    std::vector<double> weights(1 << 20);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        ids[i] = static_cast<uint32_t>(i / 4 * 7);
+        weights[i] = std::round(std::sin(i * 0.001) * 1000.0) / 1000.0;
+    }
+    std::string name = (std::filesystem::temp_directory_path() / "bench_threads.bin").string();
+    std::size_t bytes = ids.size() * sizeof(uint32_t) + weights.size() * sizeof(double);
+    serial::Format format;
+    format.compression = serial::Compression::Lz;
+
+    std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < cores; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+    for (std::size_t threads : counts)
+    {
+        std::string label = "lz checkpoint " + std::to_string(threads) + " thread" + (threads > 1 ? "s" : "");
+        measure(label + " write", bytes, [&]
+                {
+                    serial::OBinaryFile file(name, format);
+                    file.setThreads(threads);
+                    file << ids << weights;
+                });
+        std::vector<uint32_t> read_ids;
+        std::vector<double> read_weights;
+        measure(label + " read", bytes, [&]
+                {
+                    serial::IBinaryFile file(name);
+                    file.setThreads(threads);
+                    file >> read_ids >> read_weights;
+                    keep(read_ids[0]);
+                });
+    }
+    std::filesystem::remove(name);
+}
+
+/**
+ * An archive of already compressed bytes followed by a checkpoint, written
+ * with each codec and with the codec picked per block
+ */
+void benchAutoCompression()
+{
+    std::vector<std::byte> blob(1 << 21);
+    uint64_t seed = 88172645463325252ull;
+    for (std::byte &b : blob)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        b = static_cast<std::byte>(seed);
+    }
+    std::vector<uint32_t> ids(1 << 18);
+    std::vector<double> weights(1 << 18);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        ids[i] = static_cast<uint32_t>(i / 4 * 7);
+        weights[i] = std::round(std::sin(i * 0.001) * 1000.0) / 1000.0;
+    }
+    std::string name = (std::filesystem::temp_directory_path() / "bench_auto.bin").string();
+    std::size_t bytes = blob.size() + ids.size() * sizeof(uint32_t) + weights.size() * sizeof(double);
+
+    for (serial::Compression compression : {serial::Compression::Lz, serial::Compression::LzHigh, serial::Compression::Auto})
+    {
+        serial::Format format;
+        format.compression = compression;
+        std::string label = compression == serial::Compression::Auto ? "auto" : serial::detail::findCodec(compression)->name;
+        serial::BlockStats stats;
+        measure(label + " mixed write", bytes, [&]
+                {
+                    serial::OBinaryFile file(name, format);
+                    file.write(blob.data(), blob.size());
+                    file << ids << weights;
+                    file.close();
+                    stats = file.blockStats();
+                });
+        std::cout << std::left << std::setw(40) << label + " mixed ratio"
+                  << std::right << std::fixed << std::setprecision(2) << std::setw(8)
+                  << static_cast<double>(bytes) / std::filesystem::file_size(name)
+                  << "   raw " << stats.raw << ", fast " << stats.fast << ", strong " << stats.strong << " blocks\n";
+    }
+    std::filesystem::remove(name);
+}
+
+/**
+ * Small records of a record file compressed alone and against a trained
+ * dictionary, read in random order, compared to a whole compressed archive
+ */
+void benchRecords()
+{
+    const char *kinds[] = {"customer", "supplier", "partner", "employee"};
+    std::vector<std::map<std::string, std::string>> records(1 << 14);
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        records[i]["id"] = std::to_string(100000 + i * 37);
+        records[i]["kind"] = kinds[i % 4];
+        records[i]["status"] = i % 3 == 0 ? "inactive" : "active";
+        records[i]["email"] = "user" + std::to_string(i * 7919 % 100003) + "@example.com";
+        records[i]["created"] = "2024-0" + std::to_string(1 + i % 9) + "-1" + std::to_string(i % 10) + "T08:00:00Z";
+        records[i]["note"] = "Standard account with the default notification settings";
+    }
+    std::string name = (std::filesystem::temp_directory_path() / "bench_records.bin").string();
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::byte> raw;
+    {
+        serial::OBinaryBuffer out(raw, format);
+        out << records;
+    }
+    std::size_t bytes = raw.size();
+
+    std::vector<std::size_t> order(records.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i * 7919 % order.size();
+    }
+    std::vector<std::map<std::string, std::string>> sample(records.begin(), records.begin() + 1024);
+    for (bool trained : {false, true})
+    {
+        serial::Dictionary dictionary = trained ? serial::trainDictionary(sample, format) : serial::Dictionary();
+        std::string label = trained ? "records dictionary" : "records alone";
+        measure(label + " write", bytes, [&]
+                {
+                    serial::ORecordFile file(name, dictionary, format);
+                    for (const auto &record : records)
+                    {
+                        file.write(record);
+                    }
+                });
+        measure(label + " random read", bytes, [&]
+                {
+                    serial::IRecordFile file(name);
+                    std::map<std::string, std::string> record;
+                    for (std::size_t i : order)
+                    {
+                        record.clear();
+                        file.read(i, record);
+                    }
+                    keep(record);
+                });
+        std::cout << std::left << std::setw(40) << label + " ratio"
+                  << std::right << std::fixed << std::setprecision(2) << std::setw(8)
+                  << static_cast<double>(bytes) / std::filesystem::file_size(name) << "\n";
+    }
+
+    format.compression = serial::Compression::Lz;
+    {
+        serial::OBinaryFile file(name, format);
+        file << records;
+    }
+    std::cout << std::left << std::setw(40) << "records whole lz ratio"
+              << std::right << std::fixed << std::setprecision(2) << std::setw(8)
+              << static_cast<double>(bytes) / std::filesystem::file_size(name) << "\n";
+    std::filesystem::remove(name);
+}
+
+int main()
+{
+    std::cout << "Best instruction set: " << levelName(serial::detail::simdLevel()) << "\n";
+    benchByteSwap();
+    benchVector();
+    benchStreamVByte();
+    benchBitPack();
+    benchGorilla();
+    benchShuffle();
+    benchHalf();
+    benchCompression();
+    benchCrc32c();
+    benchAutoCompression();
+    benchThreads();
+    benchRecords();
+    return 0;
+}
@@ -1,8 +1,11 @@
+#include "Crc32c.h"
 #include "Serial.h"
 
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <fstream>
+#include <cmath>
+#include <limits>
 
 namespace fs = std::filesystem;
 
@@ -32,6 +35,18 @@ void deleteFile(const fs::path &file_path)
     }
 }
 
+/**
+ * Content of a file
+ */
+std::vector<std::byte> readBytes(const fs::path &name)
+{
+    std::ifstream f(name, std::ios::binary);
+    std::vector<char> chars((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    std::vector<std::byte> bytes(chars.size());
+    std::memcpy(bytes.data(), chars.data(), chars.size());
+    return bytes;
+}
+
 /***********************************************************************************
  *                                  Tests
  ***********************************************************************************/
@@ -1907,6 +1922,78 @@ TEST(stringTest, Many)
     deleteFile(name);
 }
 
+TEST(stringTest, Replace)
+{
+    fs::path name = createPathFile("test_string_5.bin");
+
+    // Write to file
+    std::string write1 = "short";
+    std::string write2 = "";
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2;
+    }
+
+    // Reading the file
+    std::string read1 = "a much longer previous content";
+    std::string read2 = "not empty";
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+
+    deleteFile(name);
+}
+
+TEST(stringTest, Large)
+{
+    fs::path name = createPathFile("test_string_6.bin");
+
+    // Write to file
+    std::string write(3 * serial::OBinaryFile::DefaultBufferSize + 17, '\0');
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = static_cast<char>(i * 13);
+    }
+    {
+        serial::OBinaryFile file(name);
+        file << write << write;
+    }
+    ASSERT_EQ(fs::file_size(name), 2 * (8 + write.size()));
+
+    // Reading the file
+    std::string read1, read2;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2;
+    }
+    ASSERT_EQ(write, read1);
+    ASSERT_EQ(write, read2);
+
+    deleteFile(name);
+}
+
+TEST(stringTest, Truncated)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << std::string("truncated");
+    }
+    buffer.resize(buffer.size() - 3);
+
+    // Reading the buffer
+    std::string read;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read;
+    }
+    ASSERT_EQ(read, "trunca");
+}
+
 /**
  * vector tests
  */
@@ -2065,6 +2152,162 @@ TEST(vectorTest, Endianness)
     deleteFile(name);
 }
 
+TEST(vectorTest, Empty)
+{
+    fs::path name = createPathFile("test_vector_7.bin");
+
+    // Write to file
+    std::vector<uint32_t> write1;
+    std::vector<double> write2;
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2;
+    }
+    ASSERT_EQ(fs::file_size(name), 16u);
+
+    // Reading the file
+    std::vector<uint32_t> read1 = {1, 2};
+    std::vector<double> read2 = {3.0};
+    {
+        serial::IBinaryFile file_read(name);
+        file_read >> read1 >> read2;
+    }
+    ASSERT_TRUE(read1.empty());
+    ASSERT_TRUE(read2.empty());
+
+    deleteFile(name);
+}
+
+TEST(vectorTest, Large)
+{
+    fs::path name = createPathFile("test_vector_8.bin");
+
+    // Write to file
+    std::vector<uint32_t> write1(100000);
+    std::vector<int64_t> write2(30000);
+    std::vector<float> write3(20000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+    for (size_t i = 0; i < write2.size(); ++i)
+    {
+        write2[i] = static_cast<int64_t>(i * 0x9E3779B97F4A7C15) - 42;
+    }
+    for (size_t i = 0; i < write3.size(); ++i)
+    {
+        write3[i] = static_cast<float>(i) / 3.0f;
+    }
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2 << write3;
+    }
+    ASSERT_EQ(fs::file_size(name), 24u + 400000u + 240000u + 80000u);
+
+    // Reading the file
+    std::vector<uint32_t> read1;
+    std::vector<int64_t> read2;
+    std::vector<float> read3;
+    {
+        serial::IBinaryFile file_read(name);
+        file_read >> read1 >> read2 >> read3;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    // Same bytes through the element by element encoders
+    std::vector<std::byte> bytes(fs::file_size(name));
+    {
+        serial::IBinaryFile file_read(name);
+        file_read.read(bytes.data(), bytes.size());
+    }
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << write1.size();
+        for (uint32_t value : write1)
+        {
+            out << value;
+        }
+        out << write2.size();
+        for (int64_t value : write2)
+        {
+            out << value;
+        }
+        out << write3.size();
+        for (float value : write3)
+        {
+            out << value;
+        }
+    }
+    ASSERT_EQ(bytes, buffer);
+
+    deleteFile(name);
+}
+
+TEST(vectorTest, LargeUnbuffered)
+{
+    fs::path name = createPathFile("test_vector_9.bin");
+
+    // Write to file
+    std::vector<uint16_t> write(50000);
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = static_cast<uint16_t>(i * 40503u);
+    }
+    {
+        serial::OBinaryFile file(name, serial::OBinaryFile::Mode::Truncate, 0);
+        file << write;
+    }
+    ASSERT_EQ(fs::file_size(name), 8u + 100000u);
+
+    // Reading the file
+    std::vector<uint16_t> read;
+    {
+        serial::IBinaryFile file_read(name, 0);
+        file_read >> read;
+    }
+    ASSERT_EQ(write, read);
+
+    deleteFile(name);
+}
+
+TEST(vectorTest, Bool)
+{
+    fs::path name = createPathFile("test_vector_10.bin");
+
+    // Write to file, with stale bits past the end of the words
+    std::vector<bool> write1(200001);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = (i * 2654435761u) % 7 < 3;
+    }
+    std::vector<bool> write2(70, true);
+    write2.resize(3);
+    write2[1] = false;
+    std::vector<bool> write3;
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2 << write3;
+    }
+    ASSERT_EQ(fs::file_size(name), 8u + 25001u + 8u + 1u + 8u);
+
+    // Reading the file
+    std::vector<bool> read1, read2 = {true, true, true, true}, read3 = {true};
+    {
+        serial::IBinaryFile file(name);
+        file >> read1;
+        ASSERT_EQ(file.peek(9)[8], std::byte(0x05));
+        file >> read2 >> read3;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name);
+}
+
 /**
  * array tests
  */
@@ -2229,6 +2472,63 @@ TEST(arrayTest, Endianness)
     deleteFile(name);
 }
 
+TEST(arrayTest, Bulk)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    std::array<uint64_t, 3> write1 = {1, 0xFFFFFFFFFFFFFFFF, 0x0123456789ABCDEF};
+    std::array<int32_t, 2> write2 = {-1, 0x12345678};
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << write1 << write2;
+    }
+    ASSERT_EQ(buffer.size(), 48u);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[16]), 0xFF);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[32]), 0x00);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[33]), 0x00);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[39]), 0x02);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[44]), 0x12);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[47]), 0x78);
+
+    // Reading the buffer
+    std::array<uint64_t, 3> read1;
+    std::array<int32_t, 2> read2;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+}
+
+TEST(arrayTest, Bool)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    std::array<bool, 21> write1 = {true, false, false, true, true, false, true, false,
+                                   false, false, false, false, false, false, false, true,
+                                   true, true, false, false, true};
+    std::array<bool, 0> write2 = {};
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << write1 << write2;
+    }
+    ASSERT_EQ(buffer.size(), 8u + 3u + 8u);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[8]), 0x59);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[9]), 0x80);
+    ASSERT_EQ(static_cast<uint8_t>(buffer[10]), 0x13);
+
+    // Reading the buffer
+    std::array<bool, 21> read1;
+    std::array<bool, 0> read2;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2;
+        ASSERT_EQ(in.remaining(), 0u);
+    }
+    ASSERT_EQ(write1, read1);
+}
+
 /**
  * map tests
  */
@@ -2584,51 +2884,3392 @@ TEST(moveTest, IBinaryAssignmentOperator)
 }
 
 /**
- * use test
+ * buffer tests
  */
-struct Foo
+TEST(bufferTest, Flush)
 {
-    int16_t i;
-    double d;
-    std::string s;
-};
+    fs::path name = createPathFile("test_buffer_1.bin");
 
-serial::OBinaryFile &operator<<(serial::OBinaryFile &file, const Foo &foo)
+    // Write to file
+    uint32_t write1 = 0xDEADBEEF;
+    uint16_t write2 = 42;
+    {
+        serial::OBinaryFile file(name);
+        file << write1;
+        ASSERT_EQ(fs::file_size(name), 0u);
+        file.flush();
+        ASSERT_EQ(fs::file_size(name), 4u);
+        file << write2;
+        file.close();
+        ASSERT_EQ(fs::file_size(name), 6u);
+    }
+
+    // Reading the file
+    uint32_t read1;
+    uint16_t read2;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+
+    deleteFile(name);
+}
+
+TEST(bufferTest, SmallBuffer)
 {
-    return file << foo.i << foo.d << foo.s;
+    fs::path name = createPathFile("test_buffer_2.bin");
+
+    // Write to file
+    uint64_t write1 = 0x0123456789ABCDEF;
+    std::string write2 = "larger than the buffer";
+    int16_t write3 = -3;
+    {
+        serial::OBinaryFile file(name, serial::OBinaryFile::Mode::Truncate, 3);
+        file << write1 << write2 << write3;
+    }
+    ASSERT_EQ(fs::file_size(name), 40u);
+
+    // Reading the file
+    uint64_t read1;
+    std::string read2;
+    int16_t read3;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2 >> read3;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name);
 }
-serial::IBinaryFile &operator>>(serial::IBinaryFile &file, Foo &foo)
+
+TEST(bufferTest, Unbuffered)
 {
-    return file >> foo.i >> foo.d >> foo.s;
+    fs::path name = createPathFile("test_buffer_3.bin");
+
+    // Write to file
+    std::vector<int32_t> write = {1, 2, 3, 4, 5};
+    {
+        serial::OBinaryFile file(name, serial::OBinaryFile::Mode::Truncate, 0);
+        file << write;
+    }
+    ASSERT_EQ(fs::file_size(name), 28u);
+
+    // Reading the file
+    std::vector<int32_t> read;
+    {
+        serial::IBinaryFile file(name);
+        file >> read;
+    }
+    ASSERT_EQ(write, read);
+
+    deleteFile(name);
 }
 
-TEST(useTest, Default)
+TEST(bufferTest, LargeWrite)
 {
-    fs::path name = createPathFile("test_use.bin");
+    fs::path name = createPathFile("test_buffer_4.bin");
 
     // Write to file
-    Foo foo;
-    foo.i = 42;
-    foo.d = 69.0;
-    foo.s = "Hello";
+    std::vector<std::byte> write(3 * serial::OBinaryFile::DefaultBufferSize);
+    for (size_t i = 0; i < write.size(); ++i)
     {
-        serial::OBinaryFile out(name);
-        out << foo;
+        write[i] = static_cast<std::byte>(i * 7);
     }
+    {
+        serial::OBinaryFile file(name);
+        file << uint8_t(1);
+        size_t bytes_written = file.write(write.data(), write.size());
+        ASSERT_EQ(bytes_written, write.size());
+    }
+    ASSERT_EQ(fs::file_size(name), write.size() + 1);
 
     // Reading the file
-    struct Foo copy;
+    uint8_t read1;
+    std::vector<std::byte> read2(write.size());
     {
-        serial::IBinaryFile in(name);
-        in >> copy;
+        serial::IBinaryFile file(name);
+        file >> read1;
+        size_t bytes_read = file.read(read2.data(), read2.size());
+        ASSERT_EQ(bytes_read, read2.size());
     }
-    ASSERT_EQ(foo.i, copy.i);
-    ASSERT_EQ(foo.d, copy.d);
-    ASSERT_EQ(foo.s, copy.s);
+    ASSERT_EQ(read1, 1);
+    ASSERT_EQ(write, read2);
+
+    deleteFile(name);
+}
+
+TEST(bufferTest, CloseTwice)
+{
+    fs::path name = createPathFile("test_buffer_5.bin");
+
+    serial::OBinaryFile file(name);
+    file << int32_t(7);
+    file.close();
+    file.close();
+    ASSERT_EQ(fs::file_size(name), 4u);
+    ASSERT_THROW(file.flush(), std::runtime_error);
 
     deleteFile(name);
 }
 
+/**
+ * read-ahead tests
+ */
+TEST(readAheadTest, Peek)
+{
+    fs::path name = createPathFile("test_read_ahead_1.bin");
+
+    // Write to file
+    uint16_t write1 = 0x1234;
+    uint8_t write2 = 0x56;
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2;
+    }
+
+    // Reading the file
+    {
+        serial::IBinaryFile file(name);
+        const std::byte *b = file.peek(2);
+        ASSERT_NE(b, nullptr);
+        ASSERT_EQ(static_cast<uint8_t>(b[0]), 0x12);
+        ASSERT_EQ(static_cast<uint8_t>(b[1]), 0x34);
+        ASSERT_EQ(file.peek(4), nullptr);
+
+        uint16_t read1;
+        uint8_t read2;
+        file >> read1;
+        ASSERT_EQ(write1, read1);
+        b = file.peek(1);
+        ASSERT_NE(b, nullptr);
+        ASSERT_EQ(static_cast<uint8_t>(b[0]), 0x56);
+        file >> read2;
+        ASSERT_EQ(write2, read2);
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+
+    deleteFile(name);
+}
+
+TEST(readAheadTest, SmallBuffer)
+{
+    fs::path name = createPathFile("test_read_ahead_2.bin");
+
+    // Write to file
+    std::vector<uint64_t> write = {1, 0xFFFFFFFFFFFFFFFF, 3, 0x0123456789ABCDEF};
+    std::string write2 = "spans several refills";
+    {
+        serial::OBinaryFile file(name);
+        file << write << write2;
+    }
+
+    // Reading the file
+    std::vector<uint64_t> read;
+    std::string read2;
+    {
+        serial::IBinaryFile file(name, 5);
+        ASSERT_NE(file.peek(8), nullptr);
+        file >> read >> read2;
+    }
+    ASSERT_EQ(write, read);
+    ASSERT_EQ(write2, read2);
+
+    deleteFile(name);
+}
+
+TEST(readAheadTest, Unbuffered)
+{
+    fs::path name = createPathFile("test_read_ahead_3.bin");
+
+    // Write to file
+    std::map<int16_t, std::string> write = {{4, "four"}, {313, "five"}};
+    {
+        serial::OBinaryFile file(name);
+        file << write;
+    }
+
+    // Reading the file
+    std::map<int16_t, std::string> read;
+    {
+        serial::IBinaryFile file(name, 0);
+        file >> read;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write, read);
+
+    deleteFile(name);
+}
+
+TEST(readAheadTest, UnbufferedFormat)
+{
+    fs::path name = createPathFile("test_read_ahead_5.bin");
+
+    // Write to file, with a header and varints that are peeked
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    format.compact_integers = true;
+    std::vector<uint32_t> write1 = {1, 300, 70000, 5000000};
+    std::string write2(5000, 'z');
+    {
+        serial::OBinaryFile file(name, format);
+        file << int64_t(-2) << write1 << write2 << uint16_t(7);
+    }
+
+    // Reading the file
+    int64_t read1;
+    std::vector<uint32_t> read2;
+    std::string read3;
+    uint16_t read4;
+    {
+        serial::IBinaryFile file(name, 0);
+        ASSERT_EQ(file.format(), format);
+        file >> read1 >> read2 >> read3 >> read4;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(read1, -2);
+    ASSERT_EQ(read2, write1);
+    ASSERT_EQ(read3, write2);
+    ASSERT_EQ(read4, 7u);
+
+    deleteFile(name);
+}
+
+TEST(readAheadTest, ShortRead)
+{
+    fs::path name = createPathFile("test_read_ahead_4.bin");
+
+    // Write to file
+    {
+        std::byte b[3] = {std::byte(1), std::byte(2), std::byte(3)};
+        serial::OBinaryFile file(name);
+        file.write(b, 3);
+    }
+
+    // Reading the file
+    {
+        std::byte read[8];
+        serial::IBinaryFile file(name, 2);
+        size_t bytes_read = file.read(read, 1);
+        ASSERT_EQ(bytes_read, 1u);
+        bytes_read = file.read(read, 8);
+        ASSERT_EQ(bytes_read, 2u);
+        ASSERT_EQ(static_cast<int>(read[0]), 2);
+        ASSERT_EQ(static_cast<int>(read[1]), 3);
+        bytes_read = file.read(read, 8);
+        ASSERT_EQ(bytes_read, 0u);
+    }
+
+    deleteFile(name);
+}
+
+/**
+ * mapped file tests
+ */
+TEST(mappedTest, TypeAndContainer)
+{
+    fs::path name = createPathFile("test_mapped_1.bin");
+
+    // Write to file
+    double write1 = 1239e12;
+    std::string write2 = "helloooo";
+    std::vector<std::string> write3 = {"first", "second", "third"};
+    int64_t write4 = -12323;
+    std::map<int16_t, std::string> write5 = {{4, "four"}, {313, "five"}};
+    std::array<uint32_t, 3> write6 = {7, 8, 0xFFFFFFFF};
+    {
+        serial::OBinaryFile file(name);
+        file << write1 << write2 << write3 << write4 << write5 << write6;
+    }
+
+    // Reading the file
+    double read1;
+    std::string read2;
+    std::vector<std::string> read3;
+    int64_t read4;
+    std::map<int16_t, std::string> read5;
+    std::array<uint32_t, 3> read6;
+    {
+        serial::MappedIBinaryFile file(name);
+        file >> read1 >> read2 >> read3 >> read4 >> read5 >> read6;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+    ASSERT_EQ(write6, read6);
+
+    deleteFile(name);
+}
+
+TEST(mappedTest, Empty)
+{
+    fs::path name = createPathFile("test_mapped_2.bin");
+
+    // Write to file
+    {
+        serial::OBinaryFile file(name);
+    }
+    ASSERT_EQ(fs::file_size(name), 0u);
+
+    // Reading the file
+    {
+        std::byte read;
+        serial::MappedIBinaryFile file(name);
+        ASSERT_EQ(file.read(&read, 1), 0u);
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+
+    deleteFile(name);
+}
+
+TEST(mappedTest, ShortRead)
+{
+    fs::path name = createPathFile("test_mapped_3.bin");
+
+    // Write to file
+    {
+        std::byte b[3] = {std::byte(1), std::byte(2), std::byte(3)};
+        serial::OBinaryFile file(name);
+        file.write(b, 3);
+    }
+
+    // Reading the file
+    {
+        std::byte read[8];
+        serial::MappedIBinaryFile file(name);
+        ASSERT_EQ(file.read(read, 8), 3u);
+        ASSERT_EQ(static_cast<int>(read[2]), 3);
+        ASSERT_EQ(file.read(read, 1), 0u);
+    }
+
+    deleteFile(name);
+}
+
+TEST(mappedTest, Missing)
+{
+    fs::path name = createPathFile("test_mapped_4.bin");
+    deleteFile(name);
+    ASSERT_THROW(serial::MappedIBinaryFile file(name), std::runtime_error);
+}
+
+TEST(mappedTest, Move)
+{
+    fs::path name1 = createPathFile("test_mapped_5_1.bin");
+    fs::path name2 = createPathFile("test_mapped_5_2.bin");
+
+    // Write to files
+    int64_t write1 = 70000;
+    int64_t write2 = 3;
+    int64_t write3 = 36;
+    {
+        serial::OBinaryFile f1(name1);
+        f1 << write1 << write2;
+        serial::OBinaryFile f2(name2);
+        f2 << write3;
+    }
+
+    // Reading files
+    int64_t read1, read2, read3;
+    {
+        serial::MappedIBinaryFile file1(name1);
+        file1 >> read1;
+        serial::MappedIBinaryFile file2(name2);
+        file2 >> read3;
+        file2 = std::move(file1);
+        file2 >> read2;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name1);
+    deleteFile(name2);
+}
+
+/**
+ * mapped output file tests
+ */
+TEST(mappedOutTest, TypeAndContainer)
+{
+    fs::path name = createPathFile("test_mapped_out_1.bin");
+
+    // Write to file
+    double write1 = 1239e12;
+    std::string write2 = "helloooo";
+    std::vector<std::string> write3 = {"first", "second", "third"};
+    int64_t write4 = -12323;
+    std::map<int16_t, std::string> write5 = {{4, "four"}, {313, "five"}};
+    {
+        serial::MappedOBinaryFile file(name);
+        file << write1 << write2 << write3 << write4 << write5;
+    }
+
+    // Reading the file
+    double read1;
+    std::string read2;
+    std::vector<std::string> read3;
+    int64_t read4;
+    std::map<int16_t, std::string> read5;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2 >> read3 >> read4 >> read5;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+
+    deleteFile(name);
+}
+
+TEST(mappedOutTest, Endianness)
+{
+    fs::path name = createPathFile("test_mapped_out_2.bin");
+
+    // Write to file
+    uint32_t write = 0x12345678;
+    {
+        serial::MappedOBinaryFile file(name);
+        file << write;
+    }
+    ASSERT_EQ(fs::file_size(name), 4u);
+
+    // Reading the file
+    char b[4];
+    std::ifstream f(name, std::ios::binary);
+    f.read(b, 4);
+    ASSERT_EQ(static_cast<uint8_t>(b[0]), 0x12);
+    ASSERT_EQ(static_cast<uint8_t>(b[1]), 0x34);
+    ASSERT_EQ(static_cast<uint8_t>(b[2]), 0x56);
+    ASSERT_EQ(static_cast<uint8_t>(b[3]), 0x78);
+
+    deleteFile(name);
+}
+
+TEST(mappedOutTest, Growth)
+{
+    fs::path name = createPathFile("test_mapped_out_3.bin");
+
+    // Write to file
+    std::vector<uint64_t> write(10000);
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = i * 0x0101010101;
+    }
+    {
+        serial::MappedOBinaryFile file(name, serial::OBinaryFile::Mode::Truncate, 3);
+        file << write;
+        file.flush();
+        file.close();
+        ASSERT_EQ(fs::file_size(name), 8u + 8u * write.size());
+    }
+
+    // Reading the file
+    std::vector<uint64_t> read;
+    {
+        serial::MappedIBinaryFile file(name);
+        file >> read;
+    }
+    ASSERT_EQ(write, read);
+
+    deleteFile(name);
+}
+
+TEST(mappedOutTest, Append)
+{
+    fs::path name = createPathFile("test_mapped_out_4.bin");
+
+    // Write to file
+    {
+        serial::OBinaryFile file(name);
+        file << int16_t(1);
+    }
+    {
+        serial::MappedOBinaryFile file(name, serial::OBinaryFile::Mode::Append);
+        file << int16_t(2);
+    }
+    {
+        serial::MappedOBinaryFile file(name, serial::OBinaryFile::Mode::Append, 1);
+        file << int16_t(3) << int16_t(4);
+    }
+    ASSERT_EQ(fs::file_size(name), 8u);
+
+    // Reading the file
+    int16_t read1, read2, read3, read4;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2 >> read3 >> read4;
+    }
+    ASSERT_EQ(read1, 1);
+    ASSERT_EQ(read2, 2);
+    ASSERT_EQ(read3, 3);
+    ASSERT_EQ(read4, 4);
+
+    deleteFile(name);
+}
+
+TEST(mappedOutTest, Move)
+{
+    fs::path name1 = createPathFile("test_mapped_out_5_1.bin");
+    fs::path name2 = createPathFile("test_mapped_out_5_2.bin");
+
+    // Write to files
+    int64_t write1 = 70000;
+    int64_t write2 = 3;
+    int64_t write3 = 36;
+    {
+        serial::MappedOBinaryFile f1(name1);
+        f1 << write1;
+        serial::MappedOBinaryFile f2(name2);
+        f2 << write3;
+        f2 = std::move(f1);
+        f2 << write2;
+    }
+    ASSERT_EQ(fs::file_size(name1), 16u);
+    ASSERT_EQ(fs::file_size(name2), 8u);
+
+    // Reading file
+    int64_t read1, read2, read3;
+    {
+        serial::IBinaryFile file(name1);
+        file >> read1 >> read2;
+        serial::IBinaryFile file2(name2);
+        file2 >> read3;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name1);
+    deleteFile(name2);
+}
+
+/**
+ * memory buffer tests
+ */
+TEST(memoryBufferTest, TypeAndContainer)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    double write1 = 1239e12;
+    std::string write2 = "helloooo";
+    std::vector<std::string> write3 = {"first", "second", "third"};
+    int64_t write4 = -12323;
+    std::map<int16_t, std::string> write5 = {{4, "four"}, {313, "five"}};
+    std::array<std::string, 2> write6 = {"seven", "eight"};
+    bool write7 = true;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << write1 << write2 << write3 << write4 << write5 << write6 << write7;
+        ASSERT_EQ(out.size(), 151u);
+    }
+    ASSERT_EQ(buffer.size(), 151u);
+
+    // Reading the buffer
+    double read1;
+    std::string read2;
+    std::vector<std::string> read3;
+    int64_t read4;
+    std::map<int16_t, std::string> read5;
+    std::array<std::string, 2> read6;
+    bool read7;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2 >> read3 >> read4 >> read5 >> read6 >> read7;
+        ASSERT_EQ(in.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+    ASSERT_EQ(write6, read6);
+    ASSERT_EQ(write7, read7);
+}
+
+TEST(memoryBufferTest, SameBytesAsFile)
+{
+    fs::path name = createPathFile("test_memory_buffer_1.bin");
+
+    // Write to file and buffer
+    std::vector<int16_t> write = {0x2F2, 0x239};
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryFile file(name);
+        file << write;
+        serial::OBinaryBuffer out(buffer);
+        out << write;
+    }
+
+    // Reading the file
+    std::vector<std::byte> bytes(fs::file_size(name));
+    {
+        serial::IBinaryFile file(name);
+        file.read(bytes.data(), bytes.size());
+    }
+    ASSERT_EQ(bytes, buffer);
+
+    deleteFile(name);
+}
+
+TEST(memoryBufferTest, Append)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer = {std::byte(0xAB)};
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << uint16_t(0x1234);
+        out.flush();
+        ASSERT_EQ(buffer.size(), 3u);
+        out << std::string(100, 'x');
+    }
+    ASSERT_EQ(buffer.size(), 111u);
+
+    // Reading the buffer
+    uint8_t read1;
+    uint16_t read2;
+    std::string read3;
+    {
+        serial::IBinaryBuffer in(buffer.data(), buffer.size());
+        in >> read1 >> read2 >> read3;
+    }
+    ASSERT_EQ(read1, 0xAB);
+    ASSERT_EQ(read2, 0x1234);
+    ASSERT_EQ(read3, std::string(100, 'x'));
+}
+
+TEST(memoryBufferTest, FixedSize)
+{
+    // Write to buffer
+    std::byte buffer[6] = {};
+    {
+        serial::OBinaryBuffer out(buffer, 6);
+        out << uint32_t(0x01020304);
+        ASSERT_EQ(out.size(), 4u);
+        std::byte b[4] = {std::byte(5), std::byte(6), std::byte(7), std::byte(8)};
+        ASSERT_EQ(out.write(b, 4), 2u);
+        ASSERT_EQ(out.size(), 6u);
+        ASSERT_EQ(out.write(b, 1), 0u);
+    }
+
+    // Reading the buffer
+    {
+        uint32_t read1;
+        uint16_t read2;
+        serial::IBinaryBuffer in(buffer, 6);
+        in >> read1 >> read2;
+        ASSERT_EQ(read1, 0x01020304u);
+        ASSERT_EQ(read2, 0x0506u);
+        std::byte read;
+        ASSERT_EQ(in.read(&read, 1), 0u);
+    }
+}
+
+TEST(memoryBufferTest, Move)
+{
+    // Write to buffers
+    std::vector<std::byte> buffer1, buffer2;
+    {
+        serial::OBinaryBuffer out1(buffer1);
+        out1 << int64_t(70000);
+        serial::OBinaryBuffer out2(buffer2);
+        out2 << int64_t(36);
+        out2 = std::move(out1);
+        out2 << int64_t(3);
+    }
+    ASSERT_EQ(buffer1.size(), 16u);
+    ASSERT_EQ(buffer2.size(), 8u);
+
+    // Reading the buffers
+    int64_t read1, read2, read3;
+    {
+        serial::IBinaryBuffer in1(buffer1);
+        in1 >> read1 >> read2;
+        serial::IBinaryBuffer in2(buffer2);
+        in2 >> read3;
+    }
+    ASSERT_EQ(read1, 70000);
+    ASSERT_EQ(read2, 3);
+    ASSERT_EQ(read3, 36);
+}
+
+/**
+ * archive concept tests
+ */
+namespace
+{
+    using serial::operator<<;
+    using serial::operator>>;
+
+    /**
+     * A minimal sink that only counts the bytes written
+     */
+    struct CountingSink
+    {
+        size_t count = 0;
+        std::byte scratch[16];
+
+        size_t write(const std::byte *, size_t size)
+        {
+            count += size;
+            return size;
+        }
+
+        std::byte *reserve(size_t size)
+        {
+            if (size > sizeof(scratch)){return nullptr;}
+            count += size;
+            return scratch;
+        }
+    };
+
+    /**
+     * A minimal source reading from a string
+     */
+    struct StringSource
+    {
+        std::string data;
+        size_t position = 0;
+
+        size_t read(std::byte *out, size_t size)
+        {
+            size = std::min(size, data.size() - position);
+            std::memcpy(out, data.data() + position, size);
+            position += size;
+            return size;
+        }
+
+        size_t remaining() const
+        {
+            return data.size() - position;
+        }
+
+        const std::byte *peek(size_t size)
+        {
+            if (size > remaining()){return nullptr;}
+            return reinterpret_cast<const std::byte *>(data.data() + position);
+        }
+
+        void skip(size_t size)
+        {
+            position += size;
+        }
+    };
+}
+
+static_assert(serial::is_sink_v<serial::OBinaryFile>);
+static_assert(serial::is_sink_v<serial::MappedOBinaryFile>);
+static_assert(serial::is_sink_v<serial::OBinaryBuffer>);
+static_assert(serial::is_sink_v<CountingSink>);
+static_assert(!serial::is_sink_v<serial::IBinaryFile>);
+static_assert(!serial::is_sink_v<std::ofstream>);
+static_assert(serial::is_source_v<serial::IBinaryFile>);
+static_assert(serial::is_source_v<serial::MappedIBinaryFile>);
+static_assert(serial::is_source_v<serial::IBinaryBuffer>);
+static_assert(serial::is_source_v<StringSource>);
+static_assert(!serial::is_source_v<serial::OBinaryFile>);
+static_assert(!serial::is_source_v<std::ifstream>);
+
+TEST(conceptTest, CustomSink)
+{
+    std::vector<std::string> write1 = {"first", "second", "third"};
+    std::map<int16_t, std::vector<uint32_t>> write2 = {{4, {1, 2}}, {313, {}}};
+
+    CountingSink sink;
+    sink << write1 << write2 << 'a';
+    ASSERT_EQ(sink.count, 48u + 36u + 1u);
+}
+
+TEST(conceptTest, CustomSource)
+{
+    std::vector<std::byte> buffer;
+    std::vector<std::string> write1 = {"first", "second", "third"};
+    std::map<int16_t, std::vector<uint32_t>> write2 = {{4, {1, 2}}, {313, {}}};
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << write1 << write2;
+    }
+
+    StringSource source;
+    source.data.assign(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    std::vector<std::string> read1;
+    std::map<int16_t, std::vector<uint32_t>> read2;
+    source >> read1 >> read2;
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(source.remaining(), 0u);
+}
+
+TEST(conceptTest, Reserve)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer);
+        std::byte *b = out.reserve(1000);
+        ASSERT_NE(b, nullptr);
+        for (int i = 0; i < 1000; ++i)
+        {
+            b[i] = static_cast<std::byte>(i);
+        }
+        out << uint8_t(42);
+    }
+    ASSERT_EQ(buffer.size(), 1001u);
+    ASSERT_EQ(static_cast<int>(buffer[999]), 999 % 256);
+    ASSERT_EQ(static_cast<int>(buffer[1000]), 42);
+
+    // Fixed-size buffer
+    std::byte fixed[4];
+    serial::OBinaryBuffer out(fixed, 4);
+    ASSERT_NE(out.reserve(3), nullptr);
+    ASSERT_EQ(out.reserve(2), nullptr);
+}
+
+/**
+ * byte swap kernels tests
+ */
+template <std::size_t size>
+void checkByteSwap(void (*kernel)(std::byte *, const std::byte *, size_t))
+{
+    std::vector<std::byte> in(1000 + 1);
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        in[i] = static_cast<std::byte>(i * 37 + 11);
+    }
+    for (size_t offset = 0; offset < 2; ++offset)
+    {
+        for (size_t count = 0; count * size + offset < in.size(); count += (count < 40 ? 1 : 37))
+        {
+            std::vector<std::byte> out(count * size + 1, std::byte(0xAA));
+            kernel(out.data(), in.data() + offset, count);
+            for (size_t i = 0; i < count * size; ++i)
+            {
+                // Byte j of a value goes to byte (size - 1 - j)
+                size_t value = i / size, j = i % size;
+                ASSERT_EQ(out[i], in[offset + value * size + (size - 1 - j)]);
+            }
+            ASSERT_EQ(out[count * size], std::byte(0xAA));
+
+            // In place
+            std::vector<std::byte> inplace(in.begin() + offset, in.begin() + offset + count * size);
+            kernel(inplace.data(), inplace.data(), count);
+            ASSERT_TRUE(std::equal(inplace.begin(), inplace.end(), out.begin()));
+        }
+    }
+}
+
+TEST(byteSwapTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::ByteSwapKernels &kernels = serial::detail::byteSwapKernels(level);
+        checkByteSwap<2>(kernels.swap16);
+        checkByteSwap<4>(kernels.swap32);
+        checkByteSwap<8>(kernels.swap64);
+    }
+}
+
+TEST(byteSwapTest, SameAsScalar)
+{
+    using serial::detail::SimdLevel;
+    std::vector<std::byte> in(4096 + 8);
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        in[i] = static_cast<std::byte>(i * 7 + i / 256);
+    }
+    const serial::detail::ByteSwapKernels &scalar = serial::detail::byteSwapKernels(SimdLevel::Scalar);
+    const serial::detail::ByteSwapKernels &best = serial::detail::byteSwapKernels();
+    std::vector<std::byte> expected(4096), actual(4096);
+
+    scalar.swap16(expected.data(), in.data() + 3, 2048);
+    best.swap16(actual.data(), in.data() + 3, 2048);
+    ASSERT_EQ(expected, actual);
+
+    scalar.swap32(expected.data(), in.data() + 5, 1024);
+    best.swap32(actual.data(), in.data() + 5, 1024);
+    ASSERT_EQ(expected, actual);
+
+    scalar.swap64(expected.data(), in.data() + 1, 512);
+    best.swap64(actual.data(), in.data() + 1, 512);
+    ASSERT_EQ(expected, actual);
+}
+
+/**
+ * format tests
+ */
+TEST(formatTest, LittleEndian)
+{
+    fs::path name = createPathFile("test_format_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    uint32_t write1 = 0x12345678;
+    std::vector<int16_t> write2 = {0x2F2, -2};
+    double write3 = 1239e12;
+    {
+        serial::OBinaryFile file(name, format);
+        ASSERT_EQ(file.format(), format);
+        file << write1 << write2 << write3;
+    }
+    ASSERT_EQ(fs::file_size(name), 12u + 4u + 12u + 8u);
+
+    // Reading the bytes
+    char b[16];
+    std::ifstream f(name, std::ios::binary);
+    f.read(b, 16);
+    ASSERT_EQ(static_cast<uint8_t>(b[0]), 0x89);
+    ASSERT_EQ(b[1], 'S');
+    ASSERT_EQ(b[2], 'R');
+    ASSERT_EQ(b[3], 'L');
+    ASSERT_EQ(static_cast<uint8_t>(b[11]), 0x01);
+    ASSERT_EQ(static_cast<uint8_t>(b[12]), 0x78);
+    ASSERT_EQ(static_cast<uint8_t>(b[13]), 0x56);
+    ASSERT_EQ(static_cast<uint8_t>(b[14]), 0x34);
+    ASSERT_EQ(static_cast<uint8_t>(b[15]), 0x12);
+
+    // Reading the file
+    uint32_t read1;
+    std::vector<int16_t> read2;
+    double read3;
+    {
+        serial::IBinaryFile file(name);
+        ASSERT_EQ(file.format(), format);
+        file >> read1 >> read2 >> read3;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name);
+}
+
+TEST(formatTest, DefaultHasNoHeader)
+{
+    fs::path name = createPathFile("test_format_2.bin");
+
+    // Write to file
+    {
+        serial::OBinaryFile file(name, serial::Format());
+        file << uint16_t(0x1234);
+    }
+    ASSERT_EQ(fs::file_size(name), 2u);
+
+    // Reading the file
+    uint16_t read;
+    {
+        serial::IBinaryFile file(name);
+        ASSERT_EQ(file.format(), serial::Format());
+        file >> read;
+    }
+    ASSERT_EQ(read, 0x1234);
+
+    deleteFile(name);
+}
+
+TEST(formatTest, AllBackends)
+{
+    fs::path name = createPathFile("test_format_3.bin");
+
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    std::vector<uint64_t> write1(1000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = i * 0x0101010101;
+    }
+    std::map<int32_t, std::string> write2 = {{-4, "four"}, {313, "five"}};
+
+    // Write to buffer and mapped file
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write1 << write2;
+        serial::MappedOBinaryFile file(name, format);
+        file << write1 << write2;
+    }
+
+    // Values are stored in host order on little endian hosts
+    if (serial::detail::HostIsLittleEndian)
+    {
+        ASSERT_EQ(std::memcmp(buffer.data() + 20, write1.data(), 8 * write1.size()), 0);
+    }
+
+    // Reading the buffer and mapped file
+    {
+        std::vector<uint64_t> read1;
+        std::map<int32_t, std::string> read2;
+        serial::IBinaryBuffer in(buffer);
+        ASSERT_EQ(in.format(), format);
+        in >> read1 >> read2;
+        ASSERT_EQ(write1, read1);
+        ASSERT_EQ(write2, read2);
+    }
+    {
+        std::vector<uint64_t> read1;
+        std::map<int32_t, std::string> read2;
+        serial::MappedIBinaryFile in(name);
+        ASSERT_EQ(in.format(), format);
+        in >> read1 >> read2;
+        ASSERT_EQ(write1, read1);
+        ASSERT_EQ(write2, read2);
+    }
+
+    deleteFile(name);
+}
+
+TEST(formatTest, Append)
+{
+    fs::path name = createPathFile("test_format_4.bin");
+
+    // Write to file
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    {
+        serial::OBinaryFile file(name, format);
+        file << int32_t(-1);
+    }
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Mode::Append);
+        file << int32_t(0x01020304);
+    }
+    ASSERT_EQ(fs::file_size(name), 20u);
+
+    // Reading the file
+    int32_t read1, read2;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2;
+    }
+    ASSERT_EQ(read1, -1);
+    ASSERT_EQ(read2, 0x01020304);
+
+    deleteFile(name);
+}
+
+TEST(formatTest, AppendMapped)
+{
+    fs::path name = createPathFile("test_format_5.bin");
+
+    // Write to file
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    format.compact_integers = true;
+    {
+        serial::MappedOBinaryFile file(name, format);
+        file << uint32_t(1) << std::string("first");
+    }
+    {
+        serial::MappedOBinaryFile file(name, format, serial::OBinaryFile::Mode::Append);
+        file << uint32_t(2) << std::vector<int64_t>{-1, 300};
+    }
+
+    // Reading the file
+    uint32_t read1, read3;
+    std::string read2;
+    std::vector<int64_t> read4;
+    {
+        serial::MappedIBinaryFile file(name);
+        file >> read1 >> read2 >> read3 >> read4;
+    }
+    ASSERT_EQ(read1, 1u);
+    ASSERT_EQ(read2, "first");
+    ASSERT_EQ(read3, 2u);
+    ASSERT_EQ(read4, (std::vector<int64_t>{-1, 300}));
+
+    deleteFile(name);
+}
+
+TEST(formatTest, AppendBuffer)
+{
+    // Write to buffer
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << uint32_t(1);
+    }
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << uint32_t(2) << int64_t(-3);
+    }
+
+    // Reading the buffer
+    uint32_t read1, read2;
+    int64_t read3;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2 >> read3;
+    }
+    ASSERT_EQ(read1, 1u);
+    ASSERT_EQ(read2, 2u);
+    ASSERT_EQ(read3, -3);
+}
+
+TEST(formatTest, AppendMismatch)
+{
+    fs::path name = createPathFile("test_format_6.bin");
+
+    serial::Format little;
+    little.byte_order = serial::Format::LittleEndian;
+    serial::Format compact;
+    compact.compact_integers = true;
+    serial::Format compressed;
+    compressed.compression = serial::Compression::Lz;
+
+    // Appending to an archive needs the options it was written with
+    {
+        serial::OBinaryFile file(name, little);
+        file << uint32_t(1);
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+    ASSERT_THROW(serial::OBinaryFile file(name, serial::OBinaryFile::Append), std::runtime_error);
+    ASSERT_THROW(serial::OBinaryFile file(name, compact, serial::OBinaryFile::Append), std::runtime_error);
+    ASSERT_THROW(serial::MappedOBinaryFile file(name, serial::OBinaryFile::Append), std::runtime_error);
+    ASSERT_THROW(serial::OBinaryBuffer out(bytes), std::runtime_error);
+    ASSERT_EQ(readBytes(name), bytes);
+
+    // An archive without header has the default ones
+    {
+        serial::OBinaryFile file(name);
+        file << uint32_t(1);
+    }
+    bytes = readBytes(name);
+    ASSERT_THROW(serial::OBinaryFile file(name, compressed, serial::OBinaryFile::Append), std::runtime_error);
+    ASSERT_THROW(serial::MappedOBinaryFile file(name, little, serial::OBinaryFile::Append), std::runtime_error);
+    ASSERT_THROW(serial::OBinaryBuffer out(bytes, compact), std::runtime_error);
+    ASSERT_EQ(readBytes(name), bytes);
+
+    // And so does a compressed one
+    {
+        serial::OBinaryFile file(name, compressed);
+        file << uint32_t(1);
+    }
+    ASSERT_THROW(serial::OBinaryFile file(name, serial::OBinaryFile::Append), std::runtime_error);
+    {
+        serial::OBinaryFile file(name, compressed, serial::OBinaryFile::Append);
+        file << uint32_t(2);
+    }
+    uint32_t read1, read2;
+    {
+        serial::IBinaryFile file(name);
+        file >> read1 >> read2;
+    }
+    ASSERT_EQ(read1, 1u);
+    ASSERT_EQ(read2, 2u);
+
+    deleteFile(name);
+}
+
+TEST(formatTest, UnknownFlags)
+{
+    std::vector<std::byte> buffer;
+    {
+        serial::Format format;
+        format.byte_order = serial::Format::LittleEndian;
+        serial::OBinaryBuffer out(buffer, format);
+    }
+    ASSERT_EQ(buffer.size(), 12u);
+    buffer[8] = std::byte(0x80);
+    ASSERT_THROW(serial::IBinaryBuffer in(buffer), std::runtime_error);
+}
+
+/**
+ * varint tests
+ */
+TEST(varintTest, Encoding)
+{
+    const std::vector<std::pair<uint64_t, std::vector<uint8_t>>> cases = {
+        {0, {0x00}},
+        {1, {0x01}},
+        {127, {0x7F}},
+        {128, {0x80, 0x01}},
+        {300, {0xAC, 0x02}},
+        {16383, {0xFF, 0x7F}},
+        {16384, {0x80, 0x80, 0x01}},
+        {(uint64_t(1) << 56) - 1, {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F}},
+        {uint64_t(1) << 56, {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01}},
+        {UINT64_MAX, {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01}},
+    };
+    for (auto &c : cases)
+    {
+        std::byte b[serial::detail::MaxVarintSize + 8] = {};
+        size_t n = serial::detail::encodeVarint(b, c.first);
+        ASSERT_EQ(n, c.second.size());
+        ASSERT_EQ(serial::detail::varintSize(c.first), n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            ASSERT_EQ(static_cast<uint8_t>(b[i]), c.second[i]);
+        }
+
+        // Garbage after the varint must be ignored
+        for (size_t i = n; i < sizeof(b); ++i)
+        {
+            b[i] = std::byte(0xFF);
+        }
+        uint64_t x;
+        ASSERT_EQ(serial::detail::decodeVarint(b, x), n);
+        ASSERT_EQ(x, c.first);
+    }
+}
+
+TEST(varintTest, Wrapper)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    uint32_t write1 = 300;
+    uint64_t write2 = UINT64_MAX;
+    uint16_t write3 = 5;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << serial::varint(write1) << serial::varint(write2) << serial::varint(uint16_t(5)) << write3;
+    }
+    ASSERT_EQ(buffer.size(), 2u + 10u + 1u + 2u);
+
+    // Reading the buffer
+    uint32_t read1;
+    uint64_t read2;
+    uint16_t read3, read4;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> serial::varint(read1) >> serial::varint(read2) >> serial::varint(read3) >> read4;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(read3, 5);
+    ASSERT_EQ(write3, read4);
+}
+
+TEST(varintTest, CompactFormat)
+{
+    fs::path name = createPathFile("test_varint_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.compact_integers = true;
+    uint16_t write1 = 0xFFFF;
+    uint32_t write2 = 127;
+    uint64_t write3 = uint64_t(1) << 56;
+    std::string write4 = "hello";
+    std::vector<uint32_t> write5 = {0, 1, 128, 0xFFFFFFFF};
+    std::map<uint64_t, std::string> write6 = {{1, "one"}, {1000, "thousand"}};
+    int32_t write7 = -2;
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3 << write4 << write5 << write6 << write7;
+    }
+    // header, 3 + 1 + 9 bytes, 1 + 5, 1 + 1 + (1 + 1 + 1 + 4), 1 + (1 + 1 + 3) + (2 + 1 + 8), 1
+    ASSERT_EQ(fs::file_size(name), 12u + 13u + 6u + 9u + 17u + 1u);
+
+    // Reading the file
+    uint16_t read1;
+    uint32_t read2;
+    uint64_t read3;
+    std::string read4;
+    std::vector<uint32_t> read5;
+    std::map<uint64_t, std::string> read6;
+    int32_t read7;
+    {
+        serial::IBinaryFile file(name);
+        ASSERT_TRUE(file.format().compact_integers);
+        file >> read1 >> read2 >> read3 >> read4 >> read5 >> read6 >> read7;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+    ASSERT_EQ(write6, read6);
+    ASSERT_EQ(write7, read7);
+
+    deleteFile(name);
+}
+
+TEST(varintTest, ZigZag)
+{
+    const std::vector<std::pair<int64_t, uint64_t>> cases = {
+        {0, 0},
+        {-1, 1},
+        {1, 2},
+        {-2, 3},
+        {63, 126},
+        {-64, 127},
+        {64, 128},
+        {INT32_MAX, 0xFFFFFFFEu},
+        {INT32_MIN, 0xFFFFFFFFu},
+        {INT64_MAX, UINT64_MAX - 1},
+        {INT64_MIN, UINT64_MAX},
+    };
+    for (auto &c : cases)
+    {
+        ASSERT_EQ(serial::detail::zigzagEncode(c.first), c.second);
+        ASSERT_EQ(serial::detail::zigzagDecode(c.second), c.first);
+    }
+}
+
+TEST(varintTest, SignedCompact)
+{
+    // Write to buffer
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    int16_t write1 = INT16_MIN;
+    int16_t write2 = INT16_MAX;
+    int32_t write3 = INT32_MIN;
+    int32_t write4 = INT32_MAX;
+    int64_t write5 = INT64_MIN;
+    int64_t write6 = INT64_MAX;
+    int64_t write7 = -1;
+    std::vector<int64_t> write8 = {0, -1, 1, INT64_MIN, INT64_MAX, -64, 64};
+    int32_t write9 = -300;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write1 << write2 << write3 << write4 << write5 << write6 << write7 << write8
+            << serial::varint(write9);
+    }
+    // header, 3 + 3, 5 + 5, 10 + 10, 1, 1 + 4 + (1 + 1 + 1 + 8 + 8 + 1 + 1), 2
+    ASSERT_EQ(buffer.size(), 12u + 6u + 10u + 20u + 1u + 26u + 2u);
+
+    // Reading the buffer
+    int16_t read1, read2;
+    int32_t read3, read4;
+    int64_t read5, read6, read7;
+    std::vector<int64_t> read8;
+    int32_t read9;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2 >> read3 >> read4 >> read5 >> read6 >> read7 >> read8
+           >> serial::varint(read9);
+        ASSERT_EQ(in.remaining(), 0u);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+    ASSERT_EQ(write6, read6);
+    ASSERT_EQ(write7, read7);
+    ASSERT_EQ(write8, read8);
+    ASSERT_EQ(write9, read9);
+}
+
+TEST(varintTest, SlowPath)
+{
+    // Write to buffer
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    std::vector<uint64_t> write(200);
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = (uint64_t(1) << (i % 64)) + i;
+    }
+    std::map<uint64_t, int64_t> write2;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        write2[(uint64_t(1) << (i % 64)) + i] = -static_cast<int64_t>(write[i]);
+    }
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write << write2;
+        for (uint64_t x : write)
+        {
+            out << serial::varint(x);
+        }
+    }
+
+    // Every value read through small read-ahead buffers, the vector by
+    // Stream VByte blocks and the others one varint at a time
+    std::vector<uint64_t> read;
+    std::map<uint64_t, int64_t> read2;
+    std::vector<uint64_t> read3(write.size());
+    fs::path name = createPathFile("test_varint_2.bin");
+    {
+        serial::OBinaryFile file(name);
+        file.write(buffer.data(), buffer.size());
+    }
+    {
+        serial::IBinaryFile file(name, 3);
+        file >> read >> read2;
+        for (uint64_t &x : read3)
+        {
+            file >> serial::varint(x);
+        }
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write, read);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write, read3);
+
+    deleteFile(name);
+}
+
+/**
+ * delta tests
+ */
+TEST(deltaTest, DenseSet)
+{
+    fs::path name = createPathFile("test_delta_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.delta_keys = true;
+    std::set<uint64_t> write;
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        write.insert((uint64_t(1) << 40) + i);
+    }
+    {
+        serial::OBinaryFile file(name, format);
+        file << write;
+    }
+    // header, size, first key, one byte per gap
+    ASSERT_EQ(fs::file_size(name), 12u + 8u + 8u + 999u);
+
+    // Reading the file
+    std::set<uint64_t> read;
+    {
+        serial::IBinaryFile file(name);
+        ASSERT_TRUE(file.format().delta_keys);
+        file >> read;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write, read);
+
+    deleteFile(name);
+}
+
+TEST(deltaTest, SignedKeys)
+{
+    // Write to buffer
+    serial::Format format;
+    format.delta_keys = true;
+    std::vector<std::byte> buffer;
+    std::set<int64_t> write1 = {INT64_MIN, -5, -1, 0, 7, INT64_MAX};
+    std::set<int16_t> write2 = {INT16_MIN, -1, INT16_MAX};
+    std::map<int32_t, std::string> write3 = {{-300, "a"}, {-2, "b"}, {INT32_MAX, "c"}};
+    std::set<int8_t> write4 = {-128, 0, 127};
+    std::set<uint16_t> write5;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write1 << write2 << write3 << write4 << write5;
+    }
+
+    // Reading the buffer
+    std::set<int64_t> read1;
+    std::set<int16_t> read2;
+    std::map<int32_t, std::string> read3;
+    std::set<int8_t> read4;
+    std::set<uint16_t> read5;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read1 >> read2 >> read3 >> read4 >> read5;
+        ASSERT_EQ(in.remaining(), 0u);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+}
+
+TEST(deltaTest, WithCompactIntegers)
+{
+    // Write to buffer
+    serial::Format format;
+    format.delta_keys = true;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    std::map<uint32_t, uint32_t> write1 = {{100000, 1}, {100001, 2}, {100300, 3}};
+    std::set<std::string> write2 = {"a", "b"};
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write1 << write2;
+    }
+    // header, 1 + (3 + 1) + (1 + 1) + (2 + 1), 1 + (1 + 1) + (1 + 1)
+    ASSERT_EQ(buffer.size(), 12u + 10u + 5u);
+
+    // Reading the buffer
+    std::map<uint32_t, uint32_t> read1;
+    std::set<std::string> read2;
+    {
+        serial::IBinaryBuffer in(buffer);
+        ASSERT_EQ(in.format(), format);
+        in >> read1 >> read2;
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+}
+
+/**
+ * Stream VByte tests
+ */
+TEST(streamVByteTest, Layout)
+{
+    std::vector<uint32_t> values32 = {1, 256, 65536, 0xFFFFFFFF, 5};
+    std::byte control[2], data[5 * 4];
+    ASSERT_EQ(serial::detail::encodeStreamVByte(control, data, values32.data(), values32.size()), 11u);
+    ASSERT_EQ(control[0], std::byte(0xE4));
+    ASSERT_EQ(control[1], std::byte(0x00));
+    const uint8_t expected32[] = {1, 0, 1, 0, 0, 1, 0xFF, 0xFF, 0xFF, 0xFF, 5};
+    for (size_t i = 0; i < sizeof(expected32); ++i)
+    {
+        ASSERT_EQ(static_cast<uint8_t>(data[i]), expected32[i]);
+    }
+    ASSERT_EQ(serial::detail::streamVByteDataSize<uint32_t>(control, values32.size()), 11u);
+
+    std::vector<uint64_t> values64 = {uint64_t(1) << 56, 0, 0x1234};
+    std::byte control64[2], data64[3 * 8];
+    ASSERT_EQ(serial::detail::encodeStreamVByte(control64, data64, values64.data(), values64.size()), 11u);
+    ASSERT_EQ(control64[0], std::byte(0x07));
+    ASSERT_EQ(control64[1], std::byte(0x01));
+    ASSERT_EQ(serial::detail::streamVByteDataSize<uint64_t>(control64, values64.size()), 11u);
+}
+
+namespace
+{
+    /**
+     * Check a Stream VByte decoding kernel against the encoder, for values of
+     * every length and for counts around the width of the vectors
+     */
+    template <typename T, typename Kernel>
+    void checkStreamVByte(Kernel kernel)
+    {
+        std::vector<T> values(700);
+        uint64_t seed = 88172645463325252u;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            // Random number of significant bits
+            values[i] = static_cast<T>(seed >> (seed % (8 * sizeof(T)) + (64 - 8 * sizeof(T))));
+        }
+        for (size_t count = 0; count < values.size(); count += (count < 40 ? 1 : 97))
+        {
+            std::vector<std::byte> control(serial::detail::streamVByteControlSize<T>(count));
+            std::vector<std::byte> data(count * sizeof(T));
+            size_t size = serial::detail::encodeStreamVByte(control.data(), data.data(), values.data(), count);
+            ASSERT_EQ(serial::detail::streamVByteDataSize<T>(control.data(), count), size);
+
+            // Exact data size, so that no kernel may read past it
+            std::vector<std::byte> exact(data.begin(), data.begin() + size);
+            std::vector<T> out(count + 1, T(0xAA));
+            kernel(out.data(), control.data(), exact.data(), size, count);
+            ASSERT_TRUE(std::equal(values.begin(), values.begin() + count, out.begin()));
+            ASSERT_EQ(out[count], T(0xAA));
+        }
+    }
+}
+
+TEST(streamVByteTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::StreamVByteKernels &kernels = serial::detail::streamVByteKernels(level);
+        checkStreamVByte<uint32_t>(kernels.decode32);
+        checkStreamVByte<uint64_t>(kernels.decode64);
+    }
+}
+
+TEST(streamVByteTest, CompactVectors)
+{
+    fs::path name = createPathFile("test_stream_v_byte_1.bin");
+
+    // Write to file, over several blocks
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<uint32_t> write1(2500);
+    std::vector<int32_t> write2(1500);
+    std::vector<uint64_t> write3(1025);
+    std::vector<int64_t> write4 = {0, -1, 1, INT64_MIN, INT64_MAX};
+    std::array<uint32_t, 6> write5 = {7, 70000, 0, 1, 2, 3};
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = static_cast<uint32_t>(i * i * 31);
+    }
+    for (size_t i = 0; i < write2.size(); ++i)
+    {
+        write2[i] = static_cast<int32_t>(i * 977) * (i % 2 == 0 ? 1 : -1);
+    }
+    for (size_t i = 0; i < write3.size(); ++i)
+    {
+        write3[i] = uint64_t(1) << (i % 64);
+    }
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3 << write4 << write5;
+    }
+
+    // Reading the file through a small read-ahead buffer
+    std::vector<uint32_t> read1;
+    std::vector<int32_t> read2;
+    std::vector<uint64_t> read3;
+    std::vector<int64_t> read4;
+    std::array<uint32_t, 6> read5;
+    {
+        serial::IBinaryFile file(name, 5);
+        file >> read1 >> read2 >> read3 >> read4 >> read5;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+
+    deleteFile(name);
+}
+
+TEST(streamVByteTest, Truncated)
+{
+    // Write to buffer
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    std::vector<uint32_t> write(1100, 300);
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write;
+    }
+
+    // The last values are missing and read as zeros
+    buffer.resize(buffer.size() - 10);
+    std::vector<uint32_t> read;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read;
+        ASSERT_EQ(in.remaining(), 0u);
+    }
+    ASSERT_EQ(read.size(), write.size());
+    ASSERT_TRUE(std::equal(write.begin(), write.end() - 5, read.begin()));
+    ASSERT_EQ(read.back(), 0u);
+}
+
+/**
+ * bit-packing tests
+ */
+namespace
+{
+    /**
+     * Check the bit-packing kernels of a level against the scalar ones, for
+     * every width
+     */
+    template <typename T, typename Pack, typename Unpack>
+    void checkBitPack(Pack pack, Unpack unpack, Pack scalarPack)
+    {
+        constexpr unsigned bits = 8 * sizeof(T);
+        std::vector<T> values(serial::detail::BitPackBlock);
+        uint64_t seed = 88172645463325252u;
+        for (unsigned width = 0; width <= bits; ++width)
+        {
+            T min = static_cast<T>(seed * 7);
+            for (auto &value : values)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                T delta = width == 0 ? 0 : static_cast<T>(static_cast<T>(seed) >> (bits - width));
+                value = static_cast<T>(min + delta);
+            }
+            std::vector<std::byte> expected(serial::detail::bitPackedSize(width) + 1, std::byte(0xAA));
+            std::vector<std::byte> packed(expected);
+            scalarPack(expected.data(), values.data(), min, width);
+            pack(packed.data(), values.data(), min, width);
+            ASSERT_EQ(expected, packed);
+
+            std::vector<std::byte> exact(packed.begin(), packed.end() - 1);
+            std::vector<T> unpacked(values.size());
+            unpack(unpacked.data(), exact.data(), min, width);
+            ASSERT_EQ(values, unpacked);
+        }
+    }
+}
+
+TEST(bitPackTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    const serial::detail::BitPackKernels &scalar = serial::detail::bitPackKernels(SimdLevel::Scalar);
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::BitPackKernels &kernels = serial::detail::bitPackKernels(level);
+        checkBitPack<uint32_t>(kernels.pack32, kernels.unpack32, scalar.pack32);
+        checkBitPack<uint64_t>(kernels.pack64, kernels.unpack64, scalar.pack64);
+    }
+}
+
+TEST(bitPackTest, Layout)
+{
+    // Value i in lane i % 4, 3 bits each
+    std::vector<uint32_t> values(serial::detail::BitPackBlock, 10);
+    values[0] = 11;
+    values[4] = 17;
+    values[5] = 12;
+    std::vector<std::byte> packed(serial::detail::bitPackedSize(3));
+    serial::detail::bitPack(packed.data(), values.data(), 10, 3);
+    ASSERT_EQ(packed[0], std::byte(0x39));
+    ASSERT_EQ(packed[4], std::byte(0x10));
+    ASSERT_EQ(packed[1], std::byte(0x00));
+
+    // The last block is packed value after value
+    std::byte tail[3] = {};
+    ASSERT_EQ(serial::detail::packBits(tail, values.data(), 6, 10, 3), 3u);
+    ASSERT_EQ(tail[0], std::byte(0x01));
+    ASSERT_EQ(tail[1], std::byte(0x70));
+    ASSERT_EQ(tail[2], std::byte(0x01));
+    std::vector<uint32_t> unpacked(6);
+    serial::detail::unpackBits(unpacked.data(), tail, 6, 10, 3);
+    ASSERT_TRUE(std::equal(unpacked.begin(), unpacked.end(), values.begin()));
+}
+
+TEST(bitPackTest, Vectors)
+{
+    fs::path name = createPathFile("test_bit_pack_1.bin");
+
+    // Write to file, over several blocks
+    serial::Format format;
+    format.bit_packing = true;
+    std::vector<uint32_t> write1(1000);
+    std::vector<int32_t> write2(300);
+    std::vector<uint64_t> write3(129, UINT64_MAX);
+    std::vector<int64_t> write4 = {INT64_MIN, INT64_MAX, -1, 0};
+    std::array<int32_t, 3> write5 = {-7, 5, -2};
+    std::vector<uint32_t> write6;
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = 1000000 + static_cast<uint32_t>(i * 7919 % 4096);
+    }
+    for (size_t i = 0; i < write2.size(); ++i)
+    {
+        write2[i] = static_cast<int32_t>(i) - 150;
+    }
+    write3[64] = 0;
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3 << write4 << write5 << write6;
+    }
+    // 12 bits per value in 7 full blocks and a block of 104 values
+    size_t size1 = 8 + 7 * (1 + 4 + 16 * 12) + (1 + 4 + 104 * 12 / 8);
+    // 7 bits per value in 2 full blocks, then 44 values on 6 bits
+    size_t size2 = 8 + 2 * (1 + 4 + 16 * 7) + (1 + 4 + 33);
+    size_t size3 = 8 + (1 + 8 + 16 * 64) + (1 + 8);
+    size_t size4 = 8 + (1 + 8 + 32);
+    size_t size5 = 8 + (1 + 4 + 2);
+    ASSERT_EQ(fs::file_size(name), 12u + size1 + size2 + size3 + size4 + size5 + 8u);
+
+    // Reading the file through a small read-ahead buffer
+    std::vector<uint32_t> read1;
+    std::vector<int32_t> read2;
+    std::vector<uint64_t> read3;
+    std::vector<int64_t> read4;
+    std::array<int32_t, 3> read5;
+    std::vector<uint32_t> read6 = {1};
+    {
+        serial::IBinaryFile file(name, 7);
+        ASSERT_TRUE(file.format().bit_packing);
+        file >> read1 >> read2 >> read3 >> read4 >> read5 >> read6;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+    ASSERT_EQ(write5, read5);
+    ASSERT_EQ(write6, read6);
+
+    deleteFile(name);
+}
+
+TEST(bitPackTest, Corrupted)
+{
+    // Write to buffer
+    serial::Format format;
+    format.bit_packing = true;
+    std::vector<std::byte> buffer;
+    std::vector<uint32_t> write(200);
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = static_cast<uint32_t>(i % 4);
+    }
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write;
+    }
+
+    // Truncated, the missing values are read as the minimum of their block
+    std::vector<std::byte> truncated(buffer.begin(), buffer.end() - 5);
+    std::vector<uint32_t> read;
+    {
+        serial::IBinaryBuffer in(truncated);
+        in >> read;
+    }
+    ASSERT_TRUE(std::equal(write.begin(), write.end() - 20, read.begin()));
+    ASSERT_EQ(read.back(), 0u);
+
+    // More bits than the values have
+    buffer[12 + 8] = std::byte(33);
+    {
+        serial::IBinaryBuffer in(buffer);
+        ASSERT_THROW(in >> read, std::runtime_error);
+    }
+}
+
+/**
+ * dictionary tests
+ */
+TEST(dictionaryTest, Strings)
+{
+    fs::path name = createPathFile("test_dictionary_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.string_dictionary = true;
+    const std::vector<std::string> labels = {"ok", "error", "", "timeout"};
+    std::vector<std::string> write1(1000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = labels[i * i % labels.size()];
+    }
+    std::vector<std::string> write2;
+    std::vector<std::vector<std::string>> write3 = {{"a", "b", "a"}, {}, {"c"}};
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3;
+    }
+    // "ok" and "error" only, then one byte per element
+    size_t size1 = 8 + 8 + (8 + 2) + (8 + 5) + 1000;
+    size_t size2 = 8 + 8;
+    size_t size3 = 8 + (8 + 8 + 18 + 3) + (8 + 8) + (8 + 8 + 9 + 1);
+    ASSERT_EQ(fs::file_size(name), 12u + size1 + size2 + size3);
+
+    // Reading the file
+    std::vector<std::string> read1, read2 = {"x"};
+    std::vector<std::vector<std::string>> read3;
+    {
+        serial::IBinaryFile file(name);
+        ASSERT_TRUE(file.format().string_dictionary);
+        file >> read1 >> read2 >> read3;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    deleteFile(name);
+}
+
+TEST(dictionaryTest, WithCompactIntegers)
+{
+    // Write to buffer
+    serial::Format format;
+    format.string_dictionary = true;
+    format.compact_integers = true;
+    std::vector<std::byte> buffer;
+    std::vector<std::string> write(300);
+    for (size_t i = 0; i < write.size(); ++i)
+    {
+        write[i] = "host-" + std::to_string(i % 150);
+    }
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write;
+    }
+    // 150 distinct strings, codes from 128 take two bytes
+    size_t strings = 10 * (1 + 6) + 90 * (1 + 7) + 50 * (1 + 8);
+    ASSERT_EQ(buffer.size(), 12u + 2u + 2u + strings + 2 * (128 + 22 * 2));
+
+    // Reading the buffer
+    std::vector<std::string> read;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read;
+        ASSERT_EQ(in.remaining(), 0u);
+    }
+    ASSERT_EQ(write, read);
+}
+
+TEST(dictionaryTest, UnknownCode)
+{
+    // Write to buffer
+    serial::Format format;
+    format.string_dictionary = true;
+    std::vector<std::byte> buffer;
+    std::vector<std::string> write = {"a", "b", "a"};
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write;
+    }
+    buffer.back() = std::byte(2);
+
+    // Reading the buffer
+    std::vector<std::string> read;
+    serial::IBinaryBuffer in(buffer);
+    ASSERT_THROW(in >> read, std::runtime_error);
+}
+
+/**
+ * Gorilla tests
+ */
+TEST(gorillaTest, BitStream)
+{
+    std::vector<std::byte> buffer;
+    {
+        serial::detail::BitWriter out(buffer);
+        out.write(true);
+        for (unsigned count = 0; count <= 64; ++count)
+        {
+            out.write(count == 64 ? UINT64_MAX : (uint64_t(1) << count) - 1 - (count > 1), count);
+        }
+        out.write(false);
+        out.flush();
+    }
+    // 1 + 64 * 65 / 2 + 1 bits
+    ASSERT_EQ(buffer.size(), 261u);
+    ASSERT_EQ(buffer[0], std::byte(0xED));
+
+    serial::detail::BitReader in(buffer.data(), buffer.size());
+    ASSERT_TRUE(in.readBit());
+    for (unsigned count = 0; count <= 64; ++count)
+    {
+        ASSERT_EQ(in.read(count), count == 64 ? UINT64_MAX : (uint64_t(1) << count) - 1 - (count > 1));
+    }
+    ASSERT_FALSE(in.readBit());
+    // Zeros past the end
+    ASSERT_EQ(in.read(64), 0u);
+}
+
+namespace
+{
+    /**
+     * Check that the Gorilla codec gives back the exact bits of `values`
+     */
+    template <typename T>
+    void checkGorilla(const std::vector<T> &values)
+    {
+        std::vector<std::byte> buffer;
+        serial::detail::BitWriter out(buffer);
+        serial::detail::encodeGorilla(out, values.data(), values.size());
+        out.flush();
+
+        std::vector<T> decoded(values.size());
+        serial::detail::BitReader in(buffer.data(), buffer.size());
+        serial::detail::decodeGorilla(decoded.data(), in, decoded.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            ASSERT_EQ(std::memcmp(&values[i], &decoded[i], sizeof(T)), 0);
+        }
+    }
+}
+
+TEST(gorillaTest, Codec)
+{
+    std::vector<double> doubles = {1.5, 1.5, 1.25, -0.0, 0.0, std::numeric_limits<double>::infinity(),
+                                   std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::denorm_min(),
+                                   std::numeric_limits<double>::max(), 1e-300, 1e300, 3.0, 3.0};
+    std::vector<float> floats = {1.5f, 1.5f, 1.25f, -0.0f, 0.0f, std::numeric_limits<float>::infinity(),
+                                 std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min(),
+                                 std::numeric_limits<float>::max(), 3.0f, 3.0f};
+    for (int i = 0; i < 1000; ++i)
+    {
+        doubles.push_back(20.0 + std::sin(i * 0.01) + (i % 7) * 0.001);
+        floats.push_back(20.0f + static_cast<float>(i % 13) * 0.25f);
+    }
+    checkGorilla(doubles);
+    checkGorilla(floats);
+    checkGorilla(std::vector<double>{});
+    checkGorilla(std::vector<double>{42.0});
+}
+
+TEST(gorillaTest, Vectors)
+{
+    fs::path name = createPathFile("test_gorilla_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.float_xor = true;
+    std::vector<double> write1(1000, 21.5);
+    std::vector<double> write2(10000);
+    std::vector<float> write3(5000);
+    std::array<double, 3> write4 = {1.0, -2.0, 1.0};
+    for (size_t i = 0; i < write2.size(); ++i)
+    {
+        write2[i] = 1000.0 + std::round(std::sin(i * 0.001) * 100.0) / 100.0;
+    }
+    for (size_t i = 0; i < write3.size(); ++i)
+    {
+        write3[i] = static_cast<float>(i / 10) * 0.5f;
+    }
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3 << write4;
+    }
+    // The first value raw, then one bit per repeated value
+    size_t size1 = 8 + 2 + (64 + 999 + 7) / 8;
+    ASSERT_LT(fs::file_size(name), 12u + size1 + (8 + 8 * 10000) / 2);
+
+    // Reading the file through a small read-ahead buffer
+    std::vector<double> read1, read2;
+    std::vector<float> read3;
+    std::array<double, 3> read4;
+    {
+        serial::IBinaryFile file(name, 7);
+        ASSERT_TRUE(file.format().float_xor);
+        file >> read1 >> read2 >> read3 >> read4;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+    ASSERT_EQ(write4, read4);
+
+    // Size of the constant vector
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write1;
+    }
+    ASSERT_EQ(buffer.size(), 12u + size1);
+
+    deleteFile(name);
+}
+
+TEST(gorillaTest, Corrupted)
+{
+    // Write to buffer
+    serial::Format format;
+    format.float_xor = true;
+    std::vector<std::byte> buffer;
+    std::vector<double> write = {1.0, 2.0, 3.0};
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << write;
+    }
+
+    // Truncated, the missing bits are read as zeros
+    std::vector<std::byte> truncated(buffer.begin(), buffer.end() - 1);
+    std::vector<double> read;
+    {
+        serial::IBinaryBuffer in(truncated);
+        in >> read;
+    }
+    ASSERT_EQ(read.size(), 3u);
+    ASSERT_EQ(read[0], 1.0);
+
+    // Block larger than its values can be
+    buffer[12 + 8] = std::byte(0x7F);
+    {
+        serial::IBinaryBuffer in(buffer);
+        ASSERT_THROW(in >> read, std::runtime_error);
+    }
+}
+
+/**
+ * Shuffle tests
+ */
+
+template <std::size_t size>
+void checkShuffle(void (*shuffle)(std::byte *, const std::byte *, std::size_t),
+                  void (*unshuffle)(std::byte *, const std::byte *, std::size_t))
+{
+    for (std::size_t count : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000})
+    {
+        std::vector<std::byte> values(count * size);
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            values[i] = static_cast<std::byte>(i * 7 + i / 13);
+        }
+        std::vector<std::byte> shuffled(values.size());
+        shuffle(shuffled.data(), values.data(), count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                ASSERT_EQ(shuffled[j * count + i], values[i * size + j]);
+            }
+        }
+        std::vector<std::byte> unshuffled(values.size());
+        unshuffle(unshuffled.data(), shuffled.data(), count);
+        ASSERT_EQ(values, unshuffled);
+    }
+}
+
+TEST(shuffleTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::ShuffleKernels &kernels = serial::detail::shuffleKernels(level);
+        checkShuffle<4>(kernels.shuffle32, kernels.unshuffle32);
+        checkShuffle<8>(kernels.shuffle64, kernels.unshuffle64);
+    }
+}
+
+TEST(shuffleTest, Layout)
+{
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    format.byte_shuffle = true;
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << std::vector<float>{1.0f, 2.0f};
+    }
+    // 0x3F800000 and 0x40000000, low bytes first
+    ASSERT_EQ(buffer.size(), 12u + 8u + 8u);
+    const std::byte expected[8] = {std::byte(0x00), std::byte(0x00), std::byte(0x00), std::byte(0x00),
+                                   std::byte(0x80), std::byte(0x00), std::byte(0x3F), std::byte(0x40)};
+    ASSERT_TRUE(std::equal(expected, expected + 8, buffer.begin() + 20));
+}
+
+TEST(shuffleTest, Vectors)
+{
+    fs::path name = createPathFile("test_shuffle_1.bin");
+
+    // Write to file
+    serial::Format format;
+    format.byte_shuffle = true;
+    std::vector<double> write1(5000);
+    std::vector<float> write2(4099);
+    std::array<double, 3> write3 = {1.0, -2.0, std::numeric_limits<double>::infinity()};
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = 1000.0 + std::sin(i * 0.001);
+    }
+    for (size_t i = 0; i < write2.size(); ++i)
+    {
+        write2[i] = static_cast<float>(i) * 0.25f;
+    }
+    {
+        serial::OBinaryFile file(name, format);
+        file << write1 << write2 << write3;
+    }
+    // Same size as the raw copy
+    ASSERT_EQ(fs::file_size(name), 12u + 8u + 8u * 5000u + 8u + 4u * 4099u + 8u + 8u * 3u);
+
+    // Reading the file through a small read-ahead buffer
+    std::vector<double> read1;
+    std::vector<float> read2;
+    std::array<double, 3> read3;
+    {
+        serial::IBinaryFile file(name, 7);
+        ASSERT_TRUE(file.format().byte_shuffle);
+        file >> read1 >> read2 >> read3;
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(write1, read1);
+    ASSERT_EQ(write2, read2);
+    ASSERT_EQ(write3, read3);
+
+    // Truncated, the missing bytes are read as zeros
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << std::vector<float>{1.0f, 2.0f};
+    }
+    buffer.pop_back();
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read2;
+    }
+    ASSERT_EQ(read2.size(), 2u);
+    ASSERT_EQ(read2[0], 1.0f);
+    ASSERT_EQ(read2[1], 0.0f);
+
+    deleteFile(name);
+}
+
+/**
+ * Half tests
+ */
+uint16_t halfOf(const serial::detail::HalfKernels &kernels, float x, bool brain)
+{
+    std::byte b[2];
+    (brain ? kernels.toBfloat16 : kernels.toHalf)(b, &x, 1);
+    uint16_t value;
+    std::memcpy(&value, b, 2);
+    return value;
+}
+
+TEST(halfTest, Rounding)
+{
+    const serial::detail::HalfKernels &kernels = serial::detail::halfKernels(serial::detail::SimdLevel::Scalar);
+    ASSERT_EQ(halfOf(kernels, 1.0f, false), 0x3C00);
+    ASSERT_EQ(halfOf(kernels, -2.0f, false), 0xC000);
+    ASSERT_EQ(halfOf(kernels, 65504.0f, false), 0x7BFF);
+    ASSERT_EQ(halfOf(kernels, 65519.0f, false), 0x7BFF);
+    ASSERT_EQ(halfOf(kernels, 65520.0f, false), 0x7C00);
+    ASSERT_EQ(halfOf(kernels, 0x1p-24f, false), 0x0001);
+    ASSERT_EQ(halfOf(kernels, 0x1p-25f, false), 0x0000);
+    ASSERT_EQ(halfOf(kernels, 0x3p-25f, false), 0x0002);
+    ASSERT_EQ(halfOf(kernels, 1.0f + 0x1p-11f, false), 0x3C00);
+    ASSERT_EQ(halfOf(kernels, 1.0f + 0x3p-11f, false), 0x3C02);
+    ASSERT_EQ(halfOf(kernels, std::numeric_limits<float>::infinity(), false), 0x7C00);
+    ASSERT_EQ(halfOf(kernels, std::numeric_limits<float>::quiet_NaN(), false) & 0x7E00, 0x7E00);
+
+    ASSERT_EQ(halfOf(kernels, 1.0f, true), 0x3F80);
+    ASSERT_EQ(halfOf(kernels, 1.0f + 0x1p-8f, true), 0x3F80);
+    ASSERT_EQ(halfOf(kernels, 1.0f + 0x3p-8f, true), 0x3F82);
+    ASSERT_EQ(halfOf(kernels, std::numeric_limits<float>::max(), true), 0x7F80);
+    ASSERT_EQ(halfOf(kernels, std::numeric_limits<float>::quiet_NaN(), true) & 0x7FC0, 0x7FC0);
+}
+
+TEST(halfTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    const serial::detail::HalfKernels &scalar = serial::detail::halfKernels(SimdLevel::Scalar);
+    // Every 16-bit pattern, then floats around the rounding boundaries
+    std::vector<std::byte> patterns(2 * 65536);
+    for (std::size_t i = 0; i < 65536; ++i)
+    {
+        uint16_t value = static_cast<uint16_t>(i);
+        std::memcpy(patterns.data() + 2 * i, &value, 2);
+    }
+    std::vector<float> floats;
+    for (uint32_t bits = 0; bits < 0x80000000u; bits += 0x1FFF)
+    {
+        float x;
+        std::memcpy(&x, &bits, 4);
+        floats.push_back(x);
+        floats.push_back(-x);
+    }
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::HalfKernels &kernels = serial::detail::halfKernels(level);
+        std::vector<float> expected(65536), widened(65536);
+        std::vector<std::byte> narrowed(patterns.size());
+        for (bool brain : {false, true})
+        {
+            (brain ? scalar.fromBfloat16 : scalar.fromHalf)(expected.data(), patterns.data(), 65536);
+            (brain ? kernels.fromBfloat16 : kernels.fromHalf)(widened.data(), patterns.data(), 65536);
+            ASSERT_EQ(std::memcmp(expected.data(), widened.data(), 4 * 65536), 0);
+
+            // Widening is exact, narrowing back gives the pattern except
+            // for the signaling NaNs, made quiet
+            (brain ? kernels.toBfloat16 : kernels.toHalf)(narrowed.data(), widened.data(), 65536);
+            for (std::size_t i = 0; i < 65536; ++i)
+            {
+                uint16_t value;
+                std::memcpy(&value, narrowed.data() + 2 * i, 2);
+                uint16_t quiet = brain ? 0x40 : 0x200;
+                if (std::isnan(widened[i]))
+                {
+                    ASSERT_EQ(value, static_cast<uint16_t>(i | quiet));
+                }
+                else
+                {
+                    ASSERT_EQ(value, i);
+                }
+            }
+
+            std::vector<std::byte> a(2 * floats.size()), b(2 * floats.size());
+            (brain ? scalar.toBfloat16 : scalar.toHalf)(a.data(), floats.data(), floats.size());
+            (brain ? kernels.toBfloat16 : kernels.toHalf)(b.data(), floats.data(), floats.size());
+            ASSERT_EQ(a, b);
+        }
+    }
+}
+
+TEST(halfTest, Vectors)
+{
+    fs::path name = createPathFile("test_half_1.bin");
+
+    // Write to file
+    std::vector<float> write1(10000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = std::sin(i * 0.01f) * 100.0f;
+    }
+    const std::vector<float> write2 = {1.0f, -0.5f, 3.0e38f};
+    {
+        serial::OBinaryFile file(name);
+        file << serial::half(write1) << serial::bfloat16(write1) << serial::bfloat16(write2);
+    }
+    ASSERT_EQ(fs::file_size(name), 8u + 2u * 10000u + 8u + 2u * 10000u + 8u + 2u * 3u);
+
+    // Reading the file through a small read-ahead buffer
+    std::vector<float> read1, read2, read3;
+    {
+        serial::IBinaryFile file(name, 7);
+        file >> serial::half(read1) >> serial::bfloat16(read2) >> serial::bfloat16(read3);
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+    ASSERT_EQ(read1.size(), write1.size());
+    ASSERT_EQ(read2.size(), write1.size());
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        ASSERT_LE(std::fabs(read1[i] - write1[i]), std::fabs(write1[i]) * 0x1p-11f);
+        ASSERT_LE(std::fabs(read2[i] - write1[i]), std::fabs(write1[i]) * 0x1p-8f);
+    }
+    ASSERT_EQ(read3[0], 1.0f);
+    ASSERT_EQ(read3[1], -0.5f);
+    ASSERT_LE(std::fabs(read3[2] - 3.0e38f), 3.0e38f * 0x1p-8f);
+
+    // Big endian by default, little endian on demand
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << serial::half(write2);
+    }
+    ASSERT_EQ(buffer[8], std::byte(0x3C));
+    ASSERT_EQ(buffer[9], std::byte(0x00));
+    serial::Format format;
+    format.byte_order = serial::Format::LittleEndian;
+    buffer.clear();
+    {
+        serial::OBinaryBuffer out(buffer, format);
+        out << serial::half(write2);
+    }
+    ASSERT_EQ(buffer[12 + 8], std::byte(0x00));
+    ASSERT_EQ(buffer[12 + 9], std::byte(0x3C));
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> serial::half(read1);
+    }
+    ASSERT_EQ(read1[0], 1.0f);
+    ASSERT_EQ(read1[1], -0.5f);
+    ASSERT_EQ(read1[2], std::numeric_limits<float>::infinity());
+
+    deleteFile(name);
+}
+
+/**
+ * Compression tests
+ */
+std::vector<std::vector<std::byte>> compressionSamples()
+{
+    std::vector<std::vector<std::byte>> samples(8);
+    samples[1] = {std::byte(42)};
+    for (char c : std::string("abcabcabcabcabcabcab"))
+    {
+        samples[2].push_back(static_cast<std::byte>(c));
+    }
+    samples[3].assign(100000, std::byte(0));
+    uint64_t seed = 88172645463325252ull;
+    for (int i = 0; i < 100000; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        samples[4].push_back(static_cast<std::byte>(seed));
+        samples[5].push_back(static_cast<std::byte>(i % 251 < 200 ? i % 7 : seed));
+    }
+    // Repeats further apart than the largest offset
+    for (int i = 0; i < 200000; ++i)
+    {
+        samples[6].push_back(static_cast<std::byte>((i % 70000) * 31 / 7));
+    }
+    for (int i = 0; i < 3000; ++i)
+    {
+        std::string line = "record " + std::to_string(i % 97) + " value " + std::to_string(i * 3) + "\n";
+        for (char c : line)
+        {
+            samples[7].push_back(static_cast<std::byte>(c));
+        }
+    }
+    return samples;
+}
+
+/**
+ * @brief Bytes of 100 values repeated with changes, between the redundant
+ * and the incompressible data
+ */
+std::vector<std::byte> mediumEntropySample()
+{
+    std::vector<std::byte> table(1500);
+    uint64_t seed = 2463534242ull;
+    for (std::byte &b : table)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        b = static_cast<std::byte>(seed % 100);
+    }
+    std::vector<std::byte> sample;
+    for (int i = 0; i < 40; ++i)
+    {
+        sample.insert(sample.end(), table.begin(), table.end());
+        table[i * 37 % table.size()] = static_cast<std::byte>(i);
+    }
+    return sample;
+}
+
+TEST(compressionTest, Codecs)
+{
+    ASSERT_TRUE(serial::compressionAvailable(serial::Compression::Lz));
+    ASSERT_FALSE(serial::compressionAvailable(serial::Compression::None));
+    ASSERT_TRUE(serial::compressionAvailable(serial::Compression::LzHigh));
+    for (serial::Compression compression : {serial::Compression::Lz, serial::Compression::LzHigh,
+                                            serial::Compression::Lz4, serial::Compression::Zstd})
+    {
+        const serial::detail::Codec *codec = serial::detail::findCodec(compression);
+        if (codec == nullptr)
+        {
+            continue;
+        }
+        std::vector<std::vector<std::byte>> samples = compressionSamples();
+        for (const std::vector<std::byte> &sample : samples)
+        {
+            std::vector<std::byte> packed(codec->bound(sample.size()));
+            std::size_t stored = codec->compress(packed.data(), packed.size(), sample.data(), sample.size());
+            ASSERT_GT(stored, 0u);
+            std::vector<std::byte> unpacked(sample.size());
+            ASSERT_TRUE(codec->decompress(unpacked.data(), unpacked.size(), packed.data(), stored));
+            ASSERT_EQ(sample, unpacked);
+            if (&sample == &samples[3] || &sample == &samples[6])
+            {
+                ASSERT_LT(stored, sample.size() / 10);
+            }
+        }
+    }
+}
+
+TEST(compressionTest, CorruptedCodec)
+{
+    const serial::detail::Codec *codec = serial::detail::findCodec(serial::Compression::Lz);
+    std::vector<std::byte> sample = compressionSamples()[7];
+    std::vector<std::byte> packed(codec->bound(sample.size()));
+    packed.resize(codec->compress(packed.data(), packed.size(), sample.data(), sample.size()));
+    std::vector<std::byte> unpacked(sample.size());
+
+    // Truncated streams and wrong sizes are rejected
+    for (std::size_t size = 0; size < packed.size(); size += packed.size() / 64 + 1)
+    {
+        ASSERT_FALSE(codec->decompress(unpacked.data(), unpacked.size(), packed.data(), size));
+    }
+    ASSERT_FALSE(codec->decompress(unpacked.data(), unpacked.size() - 1, packed.data(), packed.size()));
+
+    // Altered streams never write out of bounds
+    for (std::size_t i = 0; i < packed.size(); i += packed.size() / 64 + 1)
+    {
+        std::vector<std::byte> altered(packed);
+        altered[i] ^= std::byte(0x5A);
+        codec->decompress(unpacked.data(), unpacked.size(), altered.data(), altered.size());
+    }
+}
+
+TEST(compressionTest, Files)
+{
+    fs::path name = createPathFile("test_compression_1.bin");
+
+    // Write to file, by small blocks so that values straddle them
+    serial::Format format;
+    format.compression = serial::Compression::Lz;
+    format.compact_integers = true;
+    std::vector<uint32_t> write1(20000);
+    std::vector<double> write2(5000, 3.25);
+    std::map<std::string, int64_t> write3;
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = static_cast<uint32_t>(i % 300 * 1000);
+    }
+    for (int i = 0; i < 500; ++i)
+    {
+        write3["key" + std::to_string(i)] = -i;
+    }
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 1000);
+        file << write1 << write2 << write3 << std::string(10000, 'x');
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+    std::vector<std::byte> raw;
+    {
+        serial::Format uncompressed = format;
+        uncompressed.compression = serial::Compression::None;
+        serial::OBinaryBuffer out(raw, uncompressed);
+        out << write1 << write2 << write3 << std::string(10000, 'x');
+    }
+    ASSERT_LT(bytes.size(), raw.size() / 2);
+
+    // Every reader decompresses it
+    auto check = [&](auto &file)
+    {
+        ASSERT_EQ(file.format(), format);
+        std::vector<uint32_t> read1;
+        std::vector<double> read2;
+        std::map<std::string, int64_t> read3;
+        std::string read4;
+        file >> read1 >> read2 >> read3 >> read4;
+        ASSERT_EQ(write1, read1);
+        ASSERT_EQ(write2, read2);
+        ASSERT_EQ(write3, read3);
+        ASSERT_EQ(read4, std::string(10000, 'x'));
+        ASSERT_EQ(file.peek(1), nullptr);
+    };
+    {
+        serial::IBinaryFile file(name);
+        check(file);
+    }
+    {
+        serial::IBinaryFile file(name, 7);
+        check(file);
+    }
+    {
+        serial::IBinaryFile file(name, 0);
+        check(file);
+    }
+    {
+        serial::MappedIBinaryFile file(name);
+        check(file);
+    }
+    {
+        serial::IBinaryBuffer file(bytes);
+        check(file);
+    }
+
+    deleteFile(name);
+}
+
+TEST(compressionTest, Incompressible)
+{
+    fs::path name = createPathFile("test_compression_2.bin");
+
+    // Blocks that do not shrink are stored raw
+    std::vector<std::byte> random = compressionSamples()[4];
+    std::vector<uint8_t> sample(random.size());
+    std::memcpy(sample.data(), random.data(), random.size());
+    serial::Format format;
+    format.compression = serial::Compression::Lz;
+    {
+        serial::OBinaryFile file(name, format);
+        file << sample;
+    }
+    std::size_t size = 8 + sample.size();
+    std::size_t blocks = (size + serial::OBinaryFile::DefaultBufferSize - 1) / serial::OBinaryFile::DefaultBufferSize;
+    ASSERT_EQ(fs::file_size(name), 12 + size + 9 * blocks);
+    std::vector<std::byte> bytes = readBytes(name);
+    ASSERT_EQ(bytes[12], std::byte(0));
+
+    std::vector<uint8_t> read;
+    {
+        serial::IBinaryFile file(name);
+        file >> read;
+    }
+    ASSERT_EQ(sample, read);
+
+    deleteFile(name);
+}
+
+TEST(compressionTest, Errors)
+{
+    fs::path name = createPathFile("test_compression_3.bin");
+
+    // Only stdio files write compressed archives
+    serial::Format format;
+    format.compression = serial::Compression::Lz;
+    std::vector<std::byte> buffer;
+    ASSERT_THROW(serial::OBinaryBuffer out(buffer, format), std::runtime_error);
+    ASSERT_THROW(serial::MappedOBinaryFile out(name, format), std::runtime_error);
+    format.compression = static_cast<serial::Compression>(14);
+    ASSERT_THROW(serial::OBinaryFile out(name, format), std::runtime_error);
+
+    // Unknown codec and corrupted blocks
+    format.compression = serial::Compression::Lz;
+    {
+        serial::OBinaryFile file(name, format);
+        file << std::string(1000, 'a');
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+    std::vector<std::byte> unknown(bytes);
+    unknown[10] = std::byte(0x0E);
+    ASSERT_THROW(serial::IBinaryBuffer in(unknown), std::runtime_error);
+
+    std::string read;
+    std::vector<std::byte> oversized(bytes);
+    oversized[12 + 5] = std::byte(0x7F);
+    {
+        serial::IBinaryBuffer in(oversized);
+        ASSERT_THROW(in >> read, std::runtime_error);
+    }
+    std::vector<std::byte> corrupted(bytes);
+    corrupted[12 + 1 + 3] = std::byte(0xFF);
+    {
+        serial::IBinaryBuffer in(corrupted);
+        ASSERT_THROW(in >> read, std::runtime_error);
+    }
+
+    // A truncated block ends the archive
+    std::vector<std::byte> truncated(bytes.begin(), bytes.end() - 1);
+    {
+        serial::IBinaryBuffer in(truncated);
+        in >> read;
+        ASSERT_EQ(in.peek(1), nullptr);
+    }
+
+    deleteFile(name);
+}
+
+/**
+ * Automatic compression tests
+ */
+TEST(autoCompressionTest, Selection)
+{
+    using serial::Compression;
+    std::vector<std::vector<std::byte>> samples = compressionSamples();
+    ASSERT_EQ(serial::detail::sampleEntropy(samples[0].data(), 0), 0.0);
+    ASSERT_EQ(serial::detail::sampleEntropy(samples[3].data(), samples[3].size()), 0.0);
+    ASSERT_GT(serial::detail::sampleEntropy(samples[4].data(), samples[4].size()), 7.9);
+    ASSERT_NEAR(serial::detail::sampleEntropy(samples[2].data(), samples[2].size()), std::log2(3.0), 0.1);
+
+    Compression fast = serial::compressionAvailable(Compression::Lz4) ? Compression::Lz4 : Compression::Lz;
+    Compression strong = serial::compressionAvailable(Compression::Zstd) ? Compression::Zstd : Compression::LzHigh;
+    std::vector<std::byte> medium = mediumEntropySample();
+    ASSERT_EQ(serial::detail::selectCompression(samples[4].data(), samples[4].size()), Compression::None);
+    ASSERT_EQ(serial::detail::selectCompression(medium.data(), medium.size()), fast);
+    ASSERT_EQ(serial::detail::selectCompression(samples[3].data(), samples[3].size()), strong);
+    ASSERT_EQ(serial::detail::selectCompression(samples[7].data(), samples[7].size()), strong);
+
+    // The strong parse pays off on redundant data
+    const serial::detail::Codec *lz = serial::detail::findCodec(Compression::Lz);
+    const serial::detail::Codec *lz_high = serial::detail::findCodec(Compression::LzHigh);
+    std::vector<std::byte> packed(lz->bound(samples[7].size()));
+    std::size_t lz_size = lz->compress(packed.data(), packed.size(), samples[7].data(), samples[7].size());
+    std::size_t lz_high_size = lz_high->compress(packed.data(), packed.size(), samples[7].data(), samples[7].size());
+    ASSERT_LT(lz_high_size, lz_size);
+}
+
+TEST(autoCompressionTest, Files)
+{
+    fs::path name = createPathFile("test_auto_compression_1.bin");
+
+    std::vector<std::byte> noise = compressionSamples()[4];
+    std::vector<std::byte> medium = mediumEntropySample();
+    std::vector<uint32_t> ids(20000);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        ids[i] = static_cast<uint32_t>(i / 4 * 7);
+    }
+    serial::Format format;
+    format.compression = serial::Compression::Auto;
+    format.checksums = true;
+    std::vector<std::byte> single;
+    serial::BlockStats stats;
+    for (std::size_t threads : {1, 3})
+    {
+        {
+            serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 4096);
+            file.setThreads(threads);
+            file.write(noise.data(), noise.size());
+            file << ids;
+            file.write(medium.data(), medium.size());
+            file.close();
+            if (threads == 1)
+            {
+                stats = file.blockStats();
+                ASSERT_GT(stats.raw, 10u);
+                ASSERT_GT(stats.fast, 5u);
+                ASSERT_GT(stats.strong, 10u);
+            }
+            else
+            {
+                ASSERT_EQ(file.blockStats().raw, stats.raw);
+                ASSERT_EQ(file.blockStats().fast, stats.fast);
+                ASSERT_EQ(file.blockStats().strong, stats.strong);
+            }
+        }
+        std::vector<std::byte> bytes = readBytes(name);
+        if (threads == 1)
+        {
+            single = bytes;
+        }
+        ASSERT_EQ(bytes, single);
+
+        // The choice of each block is in its header, the last one ends the
+        // archive
+        serial::BlockStats recorded;
+        std::size_t blocks = 0;
+        for (std::size_t offset = 12; offset < bytes.size(); ++blocks)
+        {
+            auto method = static_cast<serial::Compression>(bytes[offset]);
+            ASSERT_TRUE(method == serial::Compression::None || serial::detail::findCodec(method) != nullptr);
+            recorded.raw += method == serial::Compression::None;
+            offset += 13 + serial::detail::loadBigEndian<uint32_t>(bytes.data() + offset + 5);
+        }
+        ASSERT_EQ(recorded.raw, stats.raw + 1);
+        ASSERT_EQ(blocks, stats.raw + stats.fast + stats.strong + 1);
+
+        serial::IBinaryFile file(name);
+        ASSERT_EQ(file.format().compression, serial::Compression::Auto);
+        std::vector<std::byte> read_noise(noise.size());
+        std::vector<uint32_t> read_ids;
+        std::vector<std::byte> read_medium(medium.size());
+        ASSERT_EQ(file.read(read_noise.data(), read_noise.size()), noise.size());
+        file >> read_ids;
+        ASSERT_EQ(file.read(read_medium.data(), read_medium.size()), medium.size());
+        ASSERT_EQ(read_noise, noise);
+        ASSERT_EQ(read_ids, ids);
+        ASSERT_EQ(read_medium, medium);
+    }
+
+    // A fixed codec is counted too
+    format.compression = serial::Compression::Lz;
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 4096);
+        file << ids;
+        file.flush();
+        ASSERT_EQ(file.blockStats().strong, 0u);
+        ASSERT_GT(file.blockStats().fast, 0u);
+    }
+
+    deleteFile(name);
+}
+
+/**
+ * Checksum tests
+ */
+TEST(crc32cTest, Kernels)
+{
+    using serial::detail::SimdLevel;
+    std::string check = "123456789";
+    std::vector<std::byte> data(10000);
+    for (std::size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<std::byte>(i * 2654435761u >> 24);
+    }
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        const serial::detail::Crc32cKernels &kernels = serial::detail::crc32cKernels(level);
+        ASSERT_EQ(kernels.update(0, nullptr, 0), 0u);
+        ASSERT_EQ(kernels.update(0, reinterpret_cast<const std::byte *>(check.data()), check.size()), 0xE3069283u);
+        std::vector<std::byte> zeros(32, std::byte(0));
+        ASSERT_EQ(kernels.update(0, zeros.data(), zeros.size()), 0x8A9136AAu);
+
+        // Any split and alignment gives the checksum of the whole
+        uint32_t whole = serial::detail::crc32cKernels(SimdLevel::Scalar).update(0, data.data(), data.size());
+        for (std::size_t split : {0, 1, 3, 7, 8, 13, 4096, 9999})
+        {
+            uint32_t crc = kernels.update(0, data.data(), split);
+            ASSERT_EQ(kernels.update(crc, data.data() + split, data.size() - split), whole);
+        }
+    }
+}
+
+TEST(checksumTest, Files)
+{
+    fs::path name = createPathFile("test_checksum_1.bin");
+
+    std::vector<uint32_t> write1(20000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = static_cast<uint32_t>(i * 7);
+    }
+    for (serial::Compression compression : {serial::Compression::None, serial::Compression::Lz})
+    {
+        serial::Format format;
+        format.compression = compression;
+        format.checksums = true;
+        {
+            serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 1000);
+            file << write1 << std::string("end");
+        }
+        std::vector<std::byte> bytes = readBytes(name);
+        if (compression == serial::Compression::None)
+        {
+            // Blocks of 1000 bytes, each with a header of 13 bytes, and the
+            // empty block at the end
+            std::size_t size = 8 + 4 * write1.size() + 8 + 3;
+            ASSERT_EQ(bytes.size(), 12 + size + 13 * ((size + 999) / 1000) + 13);
+        }
+
+        auto check = [&](auto &file)
+        {
+            ASSERT_EQ(file.format(), format);
+            std::vector<uint32_t> read1;
+            std::string read2;
+            file >> read1 >> read2;
+            ASSERT_EQ(write1, read1);
+            ASSERT_EQ(read2, "end");
+            ASSERT_EQ(file.peek(1), nullptr);
+        };
+        {
+            serial::IBinaryFile file(name);
+            check(file);
+        }
+        {
+            serial::IBinaryFile file(name, 7);
+            check(file);
+        }
+        {
+            serial::MappedIBinaryFile file(name);
+            check(file);
+        }
+        {
+            serial::IBinaryBuffer file(bytes);
+            check(file);
+        }
+    }
+
+    deleteFile(name);
+}
+
+TEST(checksumTest, Corrupted)
+{
+    fs::path name = createPathFile("test_checksum_2.bin");
+
+    serial::Format format;
+    format.checksums = true;
+    std::vector<uint32_t> write1(1000, 5);
+    std::vector<uint32_t> write2(1000, 6);
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 1000);
+        file << write1 << write2;
+    }
+
+    // A byte flipped in the last data block is only noticed when it is read
+    std::vector<std::byte> bytes = readBytes(name);
+    bytes[bytes.size() - 13 - 10] ^= std::byte(1);
+    {
+        std::ofstream f(name, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    }
+    {
+        serial::MappedIBinaryFile file(name);
+        std::vector<uint32_t> read1;
+        std::vector<uint32_t> read2;
+        file >> read1;
+        ASSERT_EQ(write1, read1);
+        ASSERT_THROW(file >> read2, std::runtime_error);
+    }
+    {
+        serial::IBinaryFile file(name);
+        std::vector<uint32_t> read;
+        file >> read;
+        ASSERT_THROW(file >> read, std::runtime_error);
+    }
+
+    // So is a corrupted checksum
+    bytes = readBytes(name);
+    bytes[bytes.size() - 13 - 10] ^= std::byte(1);
+    bytes[12 + 10] ^= std::byte(0x80);
+    {
+        serial::IBinaryBuffer file(bytes);
+        std::vector<uint32_t> read;
+        ASSERT_THROW(file >> read, std::runtime_error);
+    }
+
+    deleteFile(name);
+}
+
+TEST(checksumTest, Truncated)
+{
+    fs::path name = createPathFile("test_checksum_3.bin");
+
+    serial::Format format;
+    format.checksums = true;
+    format.compression = serial::Compression::Lz;
+    std::vector<uint64_t> write1(3000);
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = i * i;
+    }
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 4000);
+        file << write1;
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+
+    // Cut anywhere after the header, even between two blocks, the archive is
+    // rejected instead of ending early
+    for (std::size_t size = 12; size < bytes.size(); size += bytes.size() / 97 + 1)
+    {
+        std::vector<std::byte> truncated(bytes.begin(), bytes.begin() + size);
+        serial::IBinaryBuffer file(truncated);
+        std::vector<uint64_t> read;
+        ASSERT_THROW(file >> read, std::runtime_error);
+    }
+    std::vector<std::byte> unended(bytes.begin(), bytes.end() - 13);
+    {
+        serial::IBinaryBuffer file(unended);
+        std::vector<uint64_t> read;
+        file >> read;
+        ASSERT_EQ(write1, read);
+        ASSERT_THROW(file.peek(1), std::runtime_error);
+    }
+
+    // Appending goes on after the empty block
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Append);
+        file << std::string("more");
+    }
+    {
+        serial::IBinaryFile file(name);
+        std::vector<uint64_t> read1;
+        std::string read2;
+        file >> read1 >> read2;
+        ASSERT_EQ(write1, read1);
+        ASSERT_EQ(read2, "more");
+        ASSERT_EQ(file.peek(1), nullptr);
+    }
+
+    // Only stdio files write archives with checksums
+    std::vector<std::byte> buffer;
+    ASSERT_THROW(serial::OBinaryBuffer out(buffer, format), std::runtime_error);
+
+    deleteFile(name);
+}
+
+/**
+ * Thread tests
+ */
+TEST(threadsTest, Files)
+{
+    fs::path name1 = createPathFile("test_threads_1.bin");
+    fs::path name2 = createPathFile("test_threads_2.bin");
+
+    serial::Format format;
+    format.compression = serial::Compression::Lz;
+    format.checksums = true;
+    std::vector<uint64_t> write1(50000);
+    std::vector<std::byte> random = compressionSamples()[4];
+    std::vector<uint8_t> write2(random.size());
+    std::memcpy(write2.data(), random.data(), random.size());
+    for (size_t i = 0; i < write1.size(); ++i)
+    {
+        write1[i] = i % 1000 * i;
+    }
+
+    // The workers write the same blocks as the calling thread
+    {
+        serial::OBinaryFile file(name1, format, serial::OBinaryFile::Truncate, 4096);
+        file << write1 << write2;
+    }
+    {
+        serial::OBinaryFile file(name2, format, serial::OBinaryFile::Truncate, 4096);
+        file.setThreads(4);
+        file << write1;
+        file.setThreads(3);
+        file << write2;
+    }
+    std::vector<std::byte> bytes = readBytes(name1);
+    ASSERT_EQ(bytes, readBytes(name2));
+
+    // And read them ahead, for every reader
+    auto check = [&](auto &file, std::size_t threads)
+    {
+        file.setThreads(threads);
+        std::vector<uint64_t> read1;
+        std::vector<uint8_t> read2;
+        file >> read1;
+        file.setThreads(threads == 1 ? 2 : 1);
+        file >> read2;
+        ASSERT_EQ(write1, read1);
+        ASSERT_EQ(write2, read2);
+        ASSERT_EQ(file.peek(1), nullptr);
+    };
+    for (std::size_t threads : {1, 2, 5})
+    {
+        {
+            serial::IBinaryFile file(name1, threads);
+            check(file, threads);
+        }
+        {
+            serial::MappedIBinaryFile file(name1);
+            check(file, threads);
+        }
+        {
+            serial::IBinaryBuffer file(bytes);
+            check(file, threads);
+        }
+    }
+
+    deleteFile(name1);
+    deleteFile(name2);
+}
+
+TEST(threadsTest, Errors)
+{
+    fs::path name = createPathFile("test_threads_3.bin");
+
+    serial::Format format;
+    format.checksums = true;
+    std::vector<uint32_t> write1(1000, 5);
+    std::vector<uint32_t> write2(1000, 6);
+    {
+        serial::OBinaryFile file(name, format, serial::OBinaryFile::Truncate, 1000);
+        file.setThreads(2);
+        file << write1 << write2;
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+
+    // Blocks decompressed ahead only throw when they are reached
+    std::vector<std::byte> corrupted(bytes);
+    corrupted[corrupted.size() - 13 - 10] ^= std::byte(1);
+    {
+        serial::IBinaryBuffer file(corrupted);
+        file.setThreads(4);
+        std::vector<uint32_t> read;
+        file >> read;
+        ASSERT_EQ(write1, read);
+        ASSERT_THROW(file >> read, std::runtime_error);
+    }
+    std::vector<std::byte> truncated(bytes.begin(), bytes.begin() + bytes.size() / 2);
+    {
+        serial::IBinaryBuffer file(truncated);
+        file.setThreads(4);
+        std::vector<uint32_t> read;
+        ASSERT_THROW(file >> read, std::runtime_error);
+    }
+
+    deleteFile(name);
+}
+
+/**
+ * Record tests
+ */
+std::vector<std::map<std::string, std::string>> sampleRecords(std::size_t count)
+{
+    const char *kinds[] = {"customer", "supplier", "partner", "employee"};
+    std::vector<std::map<std::string, std::string>> records(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        records[i]["id"] = std::to_string(100000 + i * 37);
+        records[i]["kind"] = kinds[i % 4];
+        records[i]["status"] = i % 3 == 0 ? "inactive" : "active";
+        records[i]["email"] = "user" + std::to_string(i * 7919 % 100003) + "@example.com";
+        records[i]["created"] = "2024-0" + std::to_string(1 + i % 9) + "-1" + std::to_string(i % 10) + "T08:00:00Z";
+        records[i]["note"] = "Standard account with the default notification settings";
+    }
+    return records;
+}
+
+TEST(recordTest, Codec)
+{
+    std::vector<std::byte> content;
+    for (char c : std::string("the quick brown fox jumps over the lazy dog, "))
+    {
+        content.push_back(static_cast<std::byte>(c));
+    }
+    serial::Dictionary dictionary(content);
+    ASSERT_EQ(dictionary.id(), serial::detail::crc32c(content.data(), content.size()));
+
+    // Matches in the dictionary, some going on in the data
+    std::vector<std::byte> data(content.end() - 10, content.end());
+    data.insert(data.end(), data.begin(), data.end());
+    data.insert(data.end(), content.begin(), content.begin() + 20);
+    data.insert(data.end(), std::byte('!'));
+    data.insert(data.end(), content.begin(), content.end());
+    std::vector<std::byte> packed(dictionary.bound(data.size()));
+    std::size_t stored = dictionary.compress(packed.data(), packed.size(), data.data(), data.size());
+    ASSERT_GT(stored, 0u);
+    ASSERT_LT(stored, data.size() / 2);
+    std::vector<std::byte> unpacked(data.size());
+    ASSERT_TRUE(dictionary.decompress(unpacked.data(), unpacked.size(), packed.data(), stored));
+    ASSERT_EQ(data, unpacked);
+
+    // Without the dictionary, the matches reach too far back
+    serial::Dictionary empty;
+    ASSERT_EQ(empty.id(), 0u);
+    ASSERT_FALSE(empty.decompress(unpacked.data(), unpacked.size(), packed.data(), stored));
+    for (std::size_t size = 0; size < stored; ++size)
+    {
+        ASSERT_FALSE(dictionary.decompress(unpacked.data(), unpacked.size(), packed.data(), size));
+    }
+
+    // Every sample round trips against it
+    for (const std::vector<std::byte> &sample : compressionSamples())
+    {
+        std::vector<std::byte> out(dictionary.bound(sample.size()));
+        std::size_t size = dictionary.compress(out.data(), out.size(), sample.data(), sample.size());
+        std::vector<std::byte> back(sample.size());
+        ASSERT_TRUE(dictionary.decompress(back.data(), back.size(), out.data(), size));
+        ASSERT_EQ(sample, back);
+    }
+    ASSERT_THROW(serial::Dictionary(std::vector<std::byte>(serial::Dictionary::MaxCapacity + 1)), std::runtime_error);
+}
+
+TEST(recordTest, Train)
+{
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::map<std::string, std::string>> records = sampleRecords(2000);
+    serial::Dictionary dictionary = serial::trainDictionary(records, format, 4096);
+    ASSERT_GT(dictionary.content().size(), 1000u);
+    ASSERT_LE(dictionary.content().size(), 4096u);
+
+    // Records compress much better against it than alone
+    serial::Dictionary empty;
+    std::size_t raw = 0, alone = 0, trained = 0;
+    for (std::size_t i = 0; i < records.size(); i += 7)
+    {
+        std::vector<std::byte> bytes;
+        {
+            serial::OBinaryBuffer out(bytes, format);
+            out << records[i];
+        }
+        std::vector<std::byte> packed(dictionary.bound(bytes.size()));
+        raw += bytes.size();
+        alone += empty.compress(packed.data(), packed.size(), bytes.data(), bytes.size());
+        trained += dictionary.compress(packed.data(), packed.size(), bytes.data(), bytes.size());
+    }
+    ASSERT_LT(trained, raw / 3);
+    ASSERT_LT(trained, alone / 2);
+
+    // Few samples make the dictionary
+    std::vector<std::vector<std::byte>> samples = {{std::byte(1), std::byte(2)}, {std::byte(3)}};
+    ASSERT_EQ(serial::Dictionary::train(samples).content(), (std::vector<std::byte>{std::byte(1), std::byte(2), std::byte(3)}));
+
+    // Dictionaries are serializable
+    std::vector<std::byte> buffer;
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << dictionary;
+    }
+    serial::Dictionary read;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> read;
+    }
+    ASSERT_EQ(read.id(), dictionary.id());
+    ASSERT_EQ(read.content(), dictionary.content());
+}
+
+TEST(recordTest, Files)
+{
+    fs::path name = createPathFile("test_record_1.bin");
+
+    serial::Format format;
+    format.compact_integers = true;
+    std::vector<std::map<std::string, std::string>> records = sampleRecords(500);
+    serial::Dictionary dictionary = serial::trainDictionary(records, format);
+    std::size_t raw = 0;
+    for (bool embed : {true, false})
+    {
+        {
+            serial::ORecordFile file(name, dictionary, format, embed);
+            for (const auto &record : records)
+            {
+                file.write(record);
+            }
+            std::vector<std::byte> incompressible = compressionSamples()[4];
+            file.writeRecord(incompressible.data(), 1000);
+            file.writeRecord(nullptr, 0);
+            ASSERT_EQ(file.size(), records.size() + 2);
+            raw = 0;
+            for (const auto &record : records)
+            {
+                std::vector<std::byte> bytes;
+                serial::OBinaryBuffer out(bytes, format);
+                out << record;
+                out.close();
+                raw += bytes.size();
+            }
+        }
+        std::size_t embedded = embed ? dictionary.content().size() : 0;
+        ASSERT_LT(fs::file_size(name) - embedded - 1000, raw / 3);
+
+        // Any record is read on its own
+        auto check = [&](serial::IRecordFile &file)
+        {
+            ASSERT_EQ(file.size(), records.size() + 2);
+            ASSERT_EQ(file.dictionary().id(), dictionary.id());
+            ASSERT_EQ(file.format(), format);
+
+            // The options are in the header of the file, not in the records
+            std::vector<std::byte> first;
+            {
+                serial::OBinaryBuffer out = serial::detail::recordWriter(first, format);
+                out << records[0];
+            }
+            ASSERT_EQ(file.readRecord(0), first);
+            for (std::size_t i = records.size(); i-- > 0;)
+            {
+                std::map<std::string, std::string> record;
+                file.read(i, record);
+                ASSERT_EQ(record, records[i]);
+            }
+            ASSERT_EQ(file.readRecord(records.size()).size(), 1000u);
+            ASSERT_EQ(file.readRecord(records.size() + 1).size(), 0u);
+            ASSERT_THROW(file.readRecord(records.size() + 2), std::runtime_error);
+        };
+        {
+            serial::IRecordFile file(name, dictionary);
+            check(file);
+        }
+        if (embed)
+        {
+            serial::IRecordFile file(name);
+            check(file);
+        }
+        else
+        {
+            // The dictionary is only named
+            ASSERT_THROW(serial::IRecordFile file(name), std::runtime_error);
+            serial::Dictionary other = serial::trainDictionary(sampleRecords(10));
+            ASSERT_THROW(serial::IRecordFile file(name, other), std::runtime_error);
+        }
+    }
+
+    // Records are archives of their own, they cannot be compressed by blocks
+    format.compression = serial::Compression::Lz;
+    ASSERT_THROW(serial::ORecordFile file(name, dictionary, format), std::runtime_error);
+
+    deleteFile(name);
+}
+
+TEST(recordTest, Corrupted)
+{
+    fs::path name = createPathFile("test_record_2.bin");
+
+    std::vector<std::map<std::string, std::string>> records = sampleRecords(50);
+    serial::Dictionary dictionary = serial::trainDictionary(records);
+    {
+        serial::ORecordFile file(name, dictionary);
+        for (const auto &record : records)
+        {
+            file.write(record);
+        }
+    }
+    std::vector<std::byte> bytes = readBytes(name);
+    auto rewrite = [&](const std::vector<std::byte> &content)
+    {
+        std::ofstream f(name, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char *>(content.data()), content.size());
+    };
+
+    // A truncated file has no footer
+    rewrite(std::vector<std::byte>(bytes.begin(), bytes.end() - 3));
+    ASSERT_THROW(serial::IRecordFile file(name), std::runtime_error);
+    rewrite({});
+    ASSERT_THROW(serial::IRecordFile file(name), std::runtime_error);
+
+    // Nor can the embedded dictionary change
+    std::vector<std::byte> altered(bytes);
+    altered[20 + 5] ^= std::byte(1);
+    rewrite(altered);
+    ASSERT_THROW(serial::IRecordFile file(name), std::runtime_error);
+
+    // A corrupted offset or record throws only when it is read
+    altered = bytes;
+    std::size_t index = bytes.size() - 16 - 8 * records.size();
+    altered[index + 8 * 3] = std::byte(0xFF);
+    std::size_t second = static_cast<std::size_t>(serial::detail::loadBigEndian<uint64_t>(bytes.data() + index + 8));
+    altered[second + 4] = std::byte(0x7F);
+    rewrite(altered);
+    {
+        serial::IRecordFile file(name);
+        std::map<std::string, std::string> first, third, record;
+        file.read(0, first);
+        ASSERT_EQ(first, records[0]);
+        ASSERT_THROW(file.read(1, record), std::runtime_error);
+        file.read(2, third);
+        ASSERT_EQ(third, records[2]);
+        ASSERT_THROW(file.read(3, record), std::runtime_error);
+    }
+
+    deleteFile(name);
+}
+
+/**
+ * use test
+ */
+struct Foo
+{
+    int16_t i;
+    double d;
+    std::string s;
+};
+
+serial::OBinaryFile &operator<<(serial::OBinaryFile &file, const Foo &foo)
+{
+    return file << foo.i << foo.d << foo.s;
+}
+serial::IBinaryFile &operator>>(serial::IBinaryFile &file, Foo &foo)
+{
+    return file >> foo.i >> foo.d >> foo.s;
+}
+
+TEST(useTest, Default)
+{
+    fs::path name = createPathFile("test_use.bin");
+
+    // Write to file
+    Foo foo;
+    foo.i = 42;
+    foo.d = 69.0;
+    foo.s = "Hello";
+    {
+        serial::OBinaryFile out(name);
+        out << foo;
+    }
+
+    // Reading the file
+    struct Foo copy;
+    {
+        serial::IBinaryFile in(name);
+        in >> copy;
+    }
+    ASSERT_EQ(foo.i, copy.i);
+    ASSERT_EQ(foo.d, copy.d);
+    ASSERT_EQ(foo.s, copy.s);
+
+    deleteFile(name);
+}
+
+TEST(useTest, Mapped)
+{
+    fs::path name = createPathFile("test_use_mapped.bin");
+
+    // Write to file
+    std::vector<Foo> foos = {{42, 69.0, "Hello"}, {-1, 0.5, "World"}};
+    {
+        serial::OBinaryFile out(name);
+        out << foos;
+    }
+
+    // Reading the file
+    std::vector<Foo> copies;
+    {
+        serial::MappedIBinaryFile in(name);
+        in >> copies;
+    }
+    ASSERT_EQ(foos.size(), copies.size());
+    for (size_t i = 0; i < foos.size(); ++i)
+    {
+        ASSERT_EQ(foos[i].i, copies[i].i);
+        ASSERT_EQ(foos[i].d, copies[i].d);
+        ASSERT_EQ(foos[i].s, copies[i].s);
+    }
+
+    deleteFile(name);
+}
+
+TEST(useTest, MemoryBuffer)
+{
+    // Write to buffer
+    std::vector<std::byte> buffer;
+    Foo foo;
+    foo.i = 42;
+    foo.d = 69.0;
+    foo.s = "Hello";
+    {
+        serial::OBinaryBuffer out(buffer);
+        out << foo;
+    }
+
+    // Reading the buffer
+    struct Foo copy;
+    {
+        serial::IBinaryBuffer in(buffer);
+        in >> copy;
+    }
+    ASSERT_EQ(foo.i, copy.i);
+    ASSERT_EQ(foo.d, copy.d);
+    ASSERT_EQ(foo.s, copy.s);
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);